@@ -0,0 +1,471 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// Generates OBJ files shaped like production input, for measuring parser
+// throughput and correctness on more than tidy hand-written strings. The
+// output only depends on the seed and the options, on every platform: the
+// random numbers come from a fixed generator (not std::*_distribution) and
+// all values are formatted with fixed printf formats.
+//
+// Usage: thinks_obj_io_corpus_generator out.obj [options]
+//   --seed N           Random seed (default 1).
+//   --size N[K|M|G]    Approximate output size in bytes (default 64M).
+//   --features LIST    Comma separated features, each optionally with the
+//                      fraction of lines (or faces) it applies to, e.g.
+//                      "crlf=1,sci=0.2,polygons". Default: all but noise.
+//   --check            Read the output back with thinks::ReadObj, compare
+//                      the counts with the manifest and report throughput.
+//
+// Features:
+//   whitespace  tabs and runs of spaces between tokens
+//   crlf        CRLF line endings
+//   sci         values in scientific notation
+//   long        values with up to 17 significant digits
+//   comments    comment-heavy headers and comments between lines
+//   forms       mixed p, p/t, p//n and p/t/n index groups
+//   polygons    quads and polygons with up to 100 corners
+//   smoothing   smoothing group ('s') lines
+//   noise       o, g, usemtl and mtllib lines, which ReadObj rejects
+//
+// Next to out.obj a manifest, out.obj.manifest.json, holds the seed, the
+// features and the expected counts.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+// SplitMix64, small and with the same sequence everywhere.
+class Random {
+ public:
+  explicit Random(const std::uint64_t seed) : state_(seed) {}
+
+  std::uint64_t Next() {
+    auto z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in [0, n).
+  std::uint64_t Below(const std::uint64_t n) { return Next() % n; }
+
+  // Uniform in [0, 1).
+  double Unit() {
+    return static_cast<double>(Next() >> 11) / 9007199254740992.0;
+  }
+
+  bool Chance(const double p) { return p > 0.0 && Unit() < p; }
+
+ private:
+  std::uint64_t state_;
+};
+
+const char* const kFeatureNames[] = {"whitespace", "crlf",     "sci",
+                                     "long",       "comments", "forms",
+                                     "polygons",   "smoothing", "noise"};
+
+// Default fraction of lines (or faces) each feature applies to.
+std::map<std::string, double> DefaultFeatures() {
+  return {{"whitespace", 0.1}, {"crlf", 0.5},     {"sci", 0.05},
+          {"long", 0.2},       {"comments", 0.01}, {"forms", 1.0},
+          {"polygons", 0.1},   {"smoothing", 0.01}};
+}
+
+std::map<std::string, double> ParseFeatures(const std::string& list) {
+  const auto defaults = DefaultFeatures();
+  auto features = std::map<std::string, double>{};
+  auto iss = std::istringstream(list);
+  auto item = std::string{};
+  while (std::getline(iss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto eq = item.find('=');
+    const auto name = item.substr(0, eq);
+    if (std::find(std::begin(kFeatureNames), std::end(kFeatureNames), name) ==
+        std::end(kFeatureNames)) {
+      throw std::runtime_error("unknown feature '" + name + "'");
+    }
+    const auto it = defaults.find(name);
+    features[name] = eq != std::string::npos
+                         ? std::atof(item.c_str() + eq + 1)
+                         : (it != defaults.end() ? it->second : 0.01);
+  }
+  return features;
+}
+
+std::uint64_t ParseSize(const std::string& str) {
+  auto size =
+      static_cast<std::uint64_t>(std::strtoull(str.c_str(), nullptr, 10));
+  switch (str.empty() ? '\0' : str.back()) {
+    case 'G':
+    case 'g':
+      size <<= 10;
+      // Fall through.
+    case 'M':
+    case 'm':
+      size <<= 10;
+      // Fall through.
+    case 'K':
+    case 'k':
+      size <<= 10;
+      break;
+    default:
+      break;
+  }
+  return size;
+}
+
+// Expected counts, written to the manifest.
+struct Manifest {
+  std::uint64_t bytes = 0;
+  std::uint64_t lines = 0;
+  std::uint64_t position_count = 0;
+  std::uint64_t tex_coord_count = 0;
+  std::uint64_t normal_count = 0;
+  std::uint64_t face_count = 0;
+  std::uint64_t face_index_count = 0;
+  std::uint64_t max_face_size = 0;
+  std::uint64_t comment_lines = 0;
+  std::uint64_t blank_lines = 0;
+  std::uint64_t smoothing_group_lines = 0;
+  std::uint64_t noise_lines = 0;
+  std::uint64_t crlf_lines = 0;
+};
+
+class Generator {
+ public:
+  Generator(std::ostream* const os, const std::uint64_t seed,
+            const std::map<std::string, double>& features)
+      : os_(os), random_(seed), features_(features) {}
+
+  void Generate(const std::uint64_t target_size) {
+    Header();
+    auto object = 0;
+    while (manifest_.bytes + buffer_.size() < target_size) {
+      Object(object++);
+    }
+    Flush();
+  }
+
+  const Manifest& manifest() const { return manifest_; }
+
+ private:
+  double Feature(const char* const name) const {
+    const auto it = features_.find(name);
+    return it != features_.end() ? it->second : 0.0;
+  }
+
+  bool Use(const char* const name) { return random_.Chance(Feature(name)); }
+
+  // Token separator.
+  const char* Space() {
+    if (!Use("whitespace")) {
+      return " ";
+    }
+    static const char* const kSpaces[] = {"\t", "  ", " \t ", "    "};
+    return kSpaces[random_.Below(4)];
+  }
+
+  void EndLine() {
+    ++manifest_.lines;
+    if (Use("crlf")) {
+      ++manifest_.crlf_lines;
+      buffer_ += "\r\n";
+    } else {
+      buffer_ += "\n";
+    }
+    if (buffer_.size() >= (std::size_t{1} << 20)) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    os_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    manifest_.bytes += buffer_.size();
+    buffer_.clear();
+  }
+
+  void Value(const double value) {
+    char str[64];
+    if (Use("sci")) {
+      std::snprintf(str, sizeof(str), "%.6e", value);
+    } else if (Use("long")) {
+      std::snprintf(str, sizeof(str), "%.*g",
+                    static_cast<int>(9 + random_.Below(9)), value);
+    } else {
+      std::snprintf(str, sizeof(str), "%.4f", value);
+    }
+    buffer_ += str;
+  }
+
+  void Comment(const std::string& text) {
+    buffer_ += "# ";
+    buffer_ += text;
+    ++manifest_.comment_lines;
+    EndLine();
+  }
+
+  void Header() {
+    Comment("Generated by thinks_obj_io_corpus_generator");
+    if (Feature("comments") > 0.0) {
+      // Exporters like to write a lot up front.
+      for (auto i = 0; i < 40; ++i) {
+        Comment("Exporter setting " + std::to_string(i) + " = " +
+                std::to_string(random_.Below(1000)));
+      }
+      buffer_ += "#";
+      ++manifest_.comment_lines;
+      EndLine();
+      ++manifest_.blank_lines;
+      EndLine();
+    }
+    if (Feature("noise") > 0.0) {
+      buffer_ += "mtllib corpus.mtl";
+      ++manifest_.noise_lines;
+      EndLine();
+    }
+  }
+
+  void Interleave() {
+    if (Use("comments")) {
+      if (random_.Below(2) == 0) {
+        Comment("vertex " + std::to_string(manifest_.position_count));
+      } else {
+        ++manifest_.blank_lines;
+        EndLine();
+      }
+    }
+  }
+
+  void Noise(const int object) {
+    if (!Use("noise")) {
+      return;
+    }
+    static const char* const kNoise[] = {"o object", "g group",
+                                         "usemtl material"};
+    buffer_ += kNoise[random_.Below(3)];
+    buffer_ += "_" + std::to_string(object);
+    ++manifest_.noise_lines;
+    EndLine();
+  }
+
+  // A patch of vertices followed by faces that reference them.
+  void Object(const int object) {
+    const auto position_base = manifest_.position_count;
+    const auto tex_coord_base = manifest_.tex_coord_count;
+    const auto normal_base = manifest_.normal_count;
+    const auto vertex_count = 500 + random_.Below(5000);
+    Noise(object);
+
+    const auto center_x = random_.Unit() * 100.0 - 50.0;
+    for (auto i = std::uint64_t{0}; i < vertex_count; ++i) {
+      buffer_ += "v";
+      for (auto c = 0; c < 3; ++c) {
+        buffer_ += Space();
+        Value((c == 0 ? center_x : 0.0) + random_.Unit() * 2.0 - 1.0);
+      }
+      ++manifest_.position_count;
+      EndLine();
+      Interleave();
+    }
+    for (auto i = std::uint64_t{0}; i < vertex_count; ++i) {
+      buffer_ += "vt";
+      for (auto c = 0; c < 2; ++c) {
+        buffer_ += Space();
+        Value(random_.Unit());
+      }
+      ++manifest_.tex_coord_count;
+      EndLine();
+    }
+    for (auto i = std::uint64_t{0}; i < vertex_count; ++i) {
+      buffer_ += "vn";
+      for (auto c = 0; c < 3; ++c) {
+        buffer_ += Space();
+        Value(c == 2 ? 1.0 : 0.0);
+      }
+      ++manifest_.normal_count;
+      EndLine();
+    }
+
+    Noise(object);
+    const auto face_count = 2 * vertex_count;
+    for (auto i = std::uint64_t{0}; i < face_count; ++i) {
+      if (Use("smoothing")) {
+        buffer_ += random_.Below(4) == 0
+                       ? std::string("s off")
+                       : "s " + std::to_string(1 + random_.Below(8));
+        ++manifest_.smoothing_group_lines;
+        EndLine();
+      }
+      if (i % 1000 == 0) {
+        Noise(object);
+      }
+
+      auto size = std::uint64_t{3};
+      if (Use("polygons")) {
+        size = random_.Below(10) == 0 ? 5 + random_.Below(96) : 4;
+      }
+      const auto form = Use("forms") ? random_.Below(4) : 3;
+      buffer_ += "f";
+      for (auto corner = std::uint64_t{0}; corner < size; ++corner) {
+        const auto local = random_.Below(vertex_count);
+        buffer_ += Space();
+        buffer_ += std::to_string(position_base + local + 1);
+        if (form == 1 || form == 3) {
+          buffer_ += "/" + std::to_string(tex_coord_base + local + 1);
+        } else if (form == 2) {
+          buffer_ += "/";
+        }
+        if (form == 2 || form == 3) {
+          buffer_ += "/" + std::to_string(normal_base + local + 1);
+        }
+      }
+      ++manifest_.face_count;
+      manifest_.face_index_count += size;
+      manifest_.max_face_size = std::max(manifest_.max_face_size, size);
+      EndLine();
+    }
+  }
+
+  std::ostream* os_;
+  Random random_;
+  std::map<std::string, double> features_;
+  std::string buffer_;
+  Manifest manifest_;
+};
+
+void WriteManifest(const std::string& path, const std::uint64_t seed,
+                   const std::map<std::string, double>& features,
+                   const Manifest& manifest) {
+  auto ofs = std::ofstream(path, std::ios::binary);
+  ofs << "{\n  \"seed\": " << seed << ",\n  \"features\": {";
+  auto first = true;
+  for (const auto& feature : features) {
+    ofs << (first ? "" : ",") << "\n    \"" << feature.first
+        << "\": " << feature.second;
+    first = false;
+  }
+  ofs << "\n  },\n"
+      << "  \"bytes\": " << manifest.bytes << ",\n"
+      << "  \"lines\": " << manifest.lines << ",\n"
+      << "  \"position_count\": " << manifest.position_count << ",\n"
+      << "  \"tex_coord_count\": " << manifest.tex_coord_count << ",\n"
+      << "  \"normal_count\": " << manifest.normal_count << ",\n"
+      << "  \"face_count\": " << manifest.face_count << ",\n"
+      << "  \"face_index_count\": " << manifest.face_index_count << ",\n"
+      << "  \"max_face_size\": " << manifest.max_face_size << ",\n"
+      << "  \"comment_lines\": " << manifest.comment_lines << ",\n"
+      << "  \"blank_lines\": " << manifest.blank_lines << ",\n"
+      << "  \"smoothing_group_lines\": " << manifest.smoothing_group_lines
+      << ",\n"
+      << "  \"noise_lines\": " << manifest.noise_lines << ",\n"
+      << "  \"crlf_lines\": " << manifest.crlf_lines << "\n}\n";
+}
+
+// Reads |path| back and compares the counts with |manifest|.
+bool Check(const std::string& path, const Manifest& manifest) {
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+  using ObjNormalType = thinks::ObjNormal<float>;
+  using ObjFaceType =
+      thinks::ObjPolygonFace<thinks::ObjIndexGroup<std::uint32_t>>;
+
+  auto face_index_count = std::uint64_t{0};
+  auto ifs = std::ifstream(path, std::ios::binary);
+  const auto start = std::chrono::steady_clock::now();
+  auto result = thinks::ObjReadResult{};
+  try {
+    result = thinks::ReadObj(
+        ifs, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>(
+            [&face_index_count](const auto& face) {
+              face_index_count += face.values.size();
+            }),
+        thinks::MakeObjAddFunc<ObjTexCoordType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjNormalType>([](const auto&) {}));
+  } catch (const std::exception& e) {
+    std::cerr << "check failed: " << e.what() << "\n";
+    return false;
+  }
+  const auto seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+  const auto ok = result.position_count == manifest.position_count &&
+                  result.tex_coord_count == manifest.tex_coord_count &&
+                  result.normal_count == manifest.normal_count &&
+                  result.face_count == manifest.face_count &&
+                  face_index_count == manifest.face_index_count;
+  std::cout << "check " << (ok ? "passed" : "failed") << ": "
+            << static_cast<double>(manifest.bytes) / (1 << 20) / seconds
+            << " MB/s\n";
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argv[1][0] == '-') {
+    std::cerr << "usage: " << argv[0]
+              << " out.obj [--seed N] [--size N[K|M|G]] [--features LIST]"
+                 " [--check]\n";
+    return 2;
+  }
+
+  const auto path = std::string(argv[1]);
+  auto seed = std::uint64_t{1};
+  auto size = std::uint64_t{64} << 20;
+  auto features = DefaultFeatures();
+  auto check = false;
+  try {
+    for (auto i = 2; i < argc; ++i) {
+      const auto arg = std::string(argv[i]);
+      const auto has_value = i + 1 < argc;
+      if (arg == "--seed" && has_value) {
+        seed = std::strtoull(argv[++i], nullptr, 10);
+      } else if (arg == "--size" && has_value) {
+        size = ParseSize(argv[++i]);
+      } else if (arg == "--features" && has_value) {
+        features = ParseFeatures(argv[++i]);
+      } else if (arg == "--check") {
+        check = true;
+      } else {
+        throw std::runtime_error("unknown argument '" + arg + "'");
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 2;
+  }
+
+  auto ofs = std::ofstream(path, std::ios::binary);
+  if (!ofs) {
+    std::cerr << "failed to open file '" << path << "'\n";
+    return 1;
+  }
+  auto generator = Generator(&ofs, seed, features);
+  generator.Generate(size);
+  ofs.close();
+  const auto& manifest = generator.manifest();
+  WriteManifest(path + ".manifest.json", seed, features, manifest);
+  std::cout << "wrote " << manifest.bytes << " bytes, "
+            << manifest.position_count << " positions, "
+            << manifest.face_count << " faces\n";
+
+  return check && !Check(path, manifest) ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// Compares the ways of reading an OBJ file from disk with a cold page cache:
+// buffered std::ifstream (with and without a separate reading thread), mmap,
+// pread and io_uring. Files are dropped from the page cache with
+// posix_fadvise(POSIX_FADV_DONTNEED) before each run. For reference, the
+// raw device throughput is measured with O_DIRECT reads (where supported)
+// without parsing.
+//
+// Usage: thinks_obj_io_file_io_benchmark [file.obj] [runs]
+// Without a file, a file of about 60 MB is generated in the working
+// directory and removed afterwards.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "thinks/obj_io/obj_io_file.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+void GenerateFile(const std::string& path) {
+  auto ofs = std::ofstream(path, std::ios::binary);
+  const auto kSize = 1000;
+  for (auto i = 0; i < kSize; ++i) {
+    for (auto j = 0; j < kSize; ++j) {
+      ofs << "v " << i * 0.001 << " " << j * 0.001 << " 0.5\n";
+    }
+  }
+  for (auto i = 0; i + 1 < kSize; ++i) {
+    for (auto j = 0; j + 1 < kSize; ++j) {
+      const auto a = i * kSize + j + 1;
+      ofs << "f " << a << " " << a + kSize << " " << a + 1 << "\n";
+      ofs << "f " << a + 1 << " " << a + kSize << " " << a + kSize + 1
+          << "\n";
+    }
+  }
+}
+
+// Writes back and drops the pages of the file from the page cache.
+void DropFromCache(const std::string& path) {
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  ::fsync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+std::uint64_t FileSize(const std::string& path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0
+             ? static_cast<std::uint64_t>(st.st_size)
+             : 0;
+}
+
+struct Counts {
+  std::uint64_t positions = 0;
+  std::uint64_t faces = 0;
+};
+
+auto MakeAddPosition(Counts* const counts) {
+  return thinks::MakeObjAddFunc<ObjPositionType>(
+      [counts](const auto&) { ++counts->positions; });
+}
+
+auto MakeAddFace(Counts* const counts) {
+  return thinks::MakeObjAddFunc<ObjFaceType>(
+      [counts](const auto&) { ++counts->faces; });
+}
+
+std::uint64_t ReadBuffered(const std::string& path, const bool pipelined) {
+  auto counts = Counts{};
+  auto options = thinks::ObjReadOptions{};
+  options.pipelined = pipelined;
+  auto ifs = std::ifstream(path, std::ios::binary);
+  if (!ifs) {
+    throw std::runtime_error("failed to open file '" + path + "'");
+  }
+  thinks::ReadObj(ifs, MakeAddPosition(&counts), MakeAddFace(&counts),
+                  nullptr, nullptr, options);
+  return counts.faces;
+}
+
+std::uint64_t ReadMmap(const std::string& path) {
+  auto counts = Counts{};
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open file '" + path + "'");
+  }
+  const auto size = static_cast<std::size_t>(FileSize(path));
+  void* const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("failed to map file '" + path + "'");
+  }
+  ::madvise(data, size, MADV_SEQUENTIAL);
+  auto parser = thinks::MakeObjStreamParser(MakeAddPosition(&counts),
+                                            MakeAddFace(&counts));
+  try {
+    parser.Feed(static_cast<const char*>(data), size);
+    parser.Finish();
+  } catch (...) {
+    ::munmap(data, size);
+    throw;
+  }
+  ::munmap(data, size);
+  return counts.faces;
+}
+
+std::uint64_t ReadFile(const std::string& path,
+                       const thinks::ObjFileIo file_io) {
+  auto counts = Counts{};
+  auto options = thinks::ObjReadOptions{};
+  options.file_io = file_io;
+  thinks::ReadObjFile(path, MakeAddPosition(&counts), MakeAddFace(&counts),
+                      nullptr, nullptr, options);
+  return counts.faces;
+}
+
+// Reads the file with O_DIRECT, bypassing the page cache, without parsing.
+std::uint64_t ReadDirect(const std::string& path) {
+#if defined(O_DIRECT)
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+  if (fd < 0) {
+    return 0;
+  }
+  constexpr auto kBlockSize = std::size_t{1} << 20;
+  void* buffer = nullptr;
+  auto total = std::uint64_t{0};
+  if (::posix_memalign(&buffer, 4096, kBlockSize) == 0) {
+    for (;;) {
+      const auto n = ::read(fd, buffer, kBlockSize);
+      if (n <= 0) {
+        break;
+      }
+      total += static_cast<std::uint64_t>(n);
+    }
+    std::free(buffer);
+  }
+  ::close(fd);
+  return total;
+#else
+  return 0;
+#endif
+}
+
+void Run(const std::string& name, const std::string& path, const int runs,
+         const std::function<std::uint64_t()>& read) {
+  const auto size_mb = static_cast<double>(FileSize(path)) / (1 << 20);
+  auto best = 0.0;
+  auto result = std::uint64_t{0};
+  for (auto run = 0; run < runs; ++run) {
+    DropFromCache(path);
+    const auto start = std::chrono::steady_clock::now();
+    result = read();
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    best = run == 0 ? seconds : std::min(best, seconds);
+  }
+  std::cout << name << ": " << best * 1000.0 << " ms, "
+            << size_mb / best << " MB/s (" << result << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const auto generated = argc < 2;
+  const auto path =
+      generated ? std::string("file_io_benchmark.obj") : std::string(argv[1]);
+  const auto runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+  if (generated) {
+    GenerateFile(path);
+  }
+
+  try {
+    Run("buffered ifstream", path, runs,
+        [&] { return ReadBuffered(path, false); });
+    Run("buffered ifstream, pipelined", path, runs,
+        [&] { return ReadBuffered(path, true); });
+    Run("mmap", path, runs, [&] { return ReadMmap(path); });
+    Run("pread", path, runs,
+        [&] { return ReadFile(path, thinks::ObjFileIo::kPread); });
+    if (thinks::ObjIoUringAvailable()) {
+      Run("io_uring", path, runs,
+          [&] { return ReadFile(path, thinks::ObjFileIo::kIoUring); });
+    } else {
+      std::cout << "io_uring: not available\n";
+    }
+    Run("O_DIRECT (no parsing)", path, runs, [&] { return ReadDirect(path); });
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+  }
+
+  if (generated) {
+    std::remove(path.c_str());
+  }
+  return 0;
+}
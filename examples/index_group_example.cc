@@ -68,6 +68,61 @@ Mesh ReadMesh(const std::string& filename) {
   return mesh;
 }
 
+// Vertex layout expected by most graphics APIs: a single index per vertex.
+struct Vertex {
+  Vec3 position;
+  Vec3 normal;
+};
+
+struct UnifiedMesh {
+  std::vector<Vertex> vertices;
+  std::vector<std::uint16_t> indices;
+};
+
+UnifiedMesh ReadUnifiedMesh(const std::string& filename) {
+  auto positions = std::vector<Vec3>{};
+  auto normals = std::vector<Vec3>{};
+
+  auto add_position = thinks::MakeObjAddFunc<
+      thinks::ObjPosition<float, 3>>([&positions](const auto& pos) {
+    positions.push_back(Vec3{pos.values[0], pos.values[1], pos.values[2]});
+  });
+
+  auto add_normal = thinks::MakeObjAddFunc<
+      thinks::ObjNormal<float>>([&normals](const auto& nml) {
+    normals.push_back(Vec3{nml.values[0], nml.values[1], nml.values[2]});
+  });
+
+  // Faces are fed straight into the unifier, which assigns a single index
+  // to each unique (position, tex coord, normal) combination.
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndexGroup<uint16_t>>;
+  auto unifier = thinks::ObjIndexGroupUnifier<uint16_t>{};
+  auto add_face = thinks::MakeObjUnifyingAddFunc<ObjFaceType>(&unifier);
+
+  auto ifs = std::ifstream(filename);
+  assert(ifs);
+  const auto result = thinks::ReadObj(ifs, add_position, add_face,
+                                      nullptr,  // no texture coordinates.
+                                      add_normal);
+  ifs.close();
+
+  // Gather vertex attributes for each unique index group.
+  const auto unified = unifier.Release();
+  assert(unified.indices.size() == 3 * result.face_count && "bad face count");
+  (void)result;  // Only used by assert.
+  auto mesh = UnifiedMesh{};
+  mesh.vertices.reserve(unified.index_groups.size());
+  for (const auto& index_group : unified.index_groups) {
+    assert(index_group.normal_index.second && "index group must have normal");
+    mesh.vertices.push_back(
+        Vertex{positions[index_group.position_index.value],
+               normals[index_group.normal_index.first.value]});
+  }
+  mesh.indices = unified.indices;
+
+  return mesh;
+}
+
 void WriteMesh(const std::string& filename, const Mesh& mesh) {
   // Positions.
   const auto pos_iend = std::end(mesh.positions);
@@ -157,6 +212,7 @@ void IndexGroupExample(const std::string& filename) {
 
   WriteMesh(filename, mesh);
   const auto mesh2 = ReadMesh(filename);
+  const auto unified_mesh = ReadUnifiedMesh(filename);
 }
 
 }  // namespace examples
@@ -4,14 +4,65 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+// The C++20 coroutine adaptor for element reading is only available if
+// the compiler supports coroutines.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#if defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define THINKS_OBJ_IO_HAS_COROUTINES 1
+#endif
+#endif
+#endif
+
+// Real values are parsed in the "C" locale, so that the decimal point is
+// '.' whatever LC_NUMERIC is set to. This needs the strtod_l family, other
+// platforms fall back to the locale dependent strtod.
+#if defined(_WIN32)
+#include <locale.h>
+#define THINKS_OBJ_IO_HAS_STRTOD_L 1
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <xlocale.h>
+#define THINKS_OBJ_IO_HAS_STRTOD_L 1
+#elif defined(__GLIBC__) && defined(_GNU_SOURCE)
+#include <locale.h>
+#define THINKS_OBJ_IO_HAS_STRTOD_L 1
+#endif
+
+// Define THINKS_OBJ_IO_TRACE to let reads and writes record trace events,
+// see EnableObjTrace. Without it the trace hooks compile to nothing. The
+// definition must be the same in all translation units.
+
 namespace thinks {
 
 template <typename ArithT, std::size_t N>
@@ -203,6 +254,231 @@ ObjAddFunc<ParseT, typename std::decay<Func>::type> MakeObjAddFunc(
   return {std::forward<Func>(func)};
 }
 
+enum class ObjTriangulation {
+  // Faces are delivered as they appear in the file.
+  kNone,
+  // Faces are split into triangles (0, i, i + 1). Fast, but only correct
+  // for convex faces.
+  kFan,
+  // Faces are split by ear clipping in the plane of the face, using the
+  // positions parsed so far. Handles non-convex (simple) faces; degenerate
+  // faces fall back to fan triangulation.
+  kEarClip
+};
+
+enum class ObjNormalGeneration {
+  // Normals are only delivered if present in the file.
+  kNone,
+  // Corner normals are the average of adjacent face normals weighted by
+  // face area.
+  kAreaWeighted,
+  // Corner normals are the average of adjacent face normals weighted by
+  // the face angle at the corner.
+  kAngleWeighted
+};
+
+// Progress of a read or write, passed to progress callbacks.
+struct ObjProgress {
+  // Bytes read or written so far.
+  std::uint64_t bytes_done;
+  // Total number of bytes to read, zero if unknown (streams that cannot
+  // seek, and writes).
+  std::uint64_t bytes_total;
+  // Positions, texture coordinates, normals and faces so far.
+  std::uint64_t elements_done;
+  // Number of elements extrapolated from the bytes read so far, zero if
+  // unknown.
+  std::uint64_t elements_total;
+};
+
+// Lets one thread ask a read or write running on another thread to stop.
+// The request is noticed at the next progress check.
+class ObjCancellationToken {
+ public:
+  void Cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+
+  bool cancelled() const noexcept {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+};
+
+enum class ObjFileIo {
+  // io_uring if available at build and run time, otherwise kPread.
+  kAuto,
+  // One blocking read at a time (pread on POSIX systems, fread elsewhere).
+  kPread,
+  // Linux io_uring, keeping several block reads in flight. Reads throw if
+  // io_uring is not available, see ObjIoUringAvailable.
+  kIoUring
+};
+
+struct ObjReadOptions {
+  // Triangulation of faces with more than three indices. Requires the face
+  // callback to take ObjTriangleFace. Triangulated faces are counted per
+  // delivered triangle in ObjReadResult::face_count.
+  ObjTriangulation triangulation = ObjTriangulation::kNone;
+
+  // Drop position and texture coordinate values that the parse type has no
+  // room for, e.g. the w of "v x y z w" when reading ObjPosition<T, 3>,
+  // instead of failing the read.
+  bool drop_extra_values = false;
+
+  // Merge each position into the first previously read position within
+  // |weld_epsilon| (Euclidean distance), using a grid-based spatial hash.
+  // Merged positions are not passed to the position callback and face
+  // position indices are remapped accordingly, which requires positions to
+  // be read before the faces referencing them. ObjReadResult::position_count
+  // holds the number of positions after welding.
+  bool weld_positions = false;
+  double weld_epsilon = 0.0;
+
+  // If not null, receives the welded (zero-based) index of each position in
+  // the input, in input order. A cancelled read delivers the indices of the
+  // positions read before it stopped.
+  std::vector<std::uint32_t>* weld_map = nullptr;
+
+  // Generate normals for files without normals ('vn' lines). Corners in
+  // the same smoothing group ('s' lines) that share a position share a
+  // normal, corners outside smoothing groups ('s off' or 's 0') get the face
+  // normal. Requires index group faces and a normal callback; faces are
+  // delivered at the end of the read, after the generated normals, with
+  // normal indices set. Files that have normals are read as usual: the
+  // faces before the first 'vn' line are delivered when it is reached.
+  ObjNormalGeneration generate_normals = ObjNormalGeneration::kNone;
+
+  // Number of threads used for normal generation, zero means one thread per
+  // hardware thread.
+  std::uint32_t thread_count = 1;
+
+  // How ReadObjFile and ReadObjFiles (see obj_io_file.h) read from files.
+  ObjFileIo file_io = ObjFileIo::kAuto;
+
+  // Let ReadObj read the stream on a separate thread that fills a ring of
+  // blocks ahead of the parser, which overlaps I/O (or decompression in
+  // the stream buffer) with parsing. Only the stream buffer is accessed
+  // from the reading thread.
+  bool pipelined = false;
+
+  // Let ReadObj run the callbacks on a separate thread, so that expensive
+  // callbacks overlap with parsing. Parsed elements are passed on in
+  // batches of |callback_batch_size| elements through a queue of
+  // |callback_queue_size| batches, and parsing waits while the queue is
+  // full. The callbacks are called from one thread, in file order, and
+  // exceptions thrown by them are re-thrown from ReadObj.
+  bool callback_thread = false;
+  std::uint32_t callback_batch_size = 4096;
+  std::uint32_t callback_queue_size = 4;
+
+  // If set, called by ReadObj and ReadObjFile with the progress of the
+  // read, about every |progress_interval| bytes and once at the end.
+  // Progress is checked between blocks of input, never per element.
+  std::function<void(const ObjProgress&)> progress;
+  std::uint64_t progress_interval = std::uint64_t{1} << 20;
+
+  // If not null, polled at the same points as progress. A cancelled read
+  // stops after the current block and returns the counts so far with
+  // ObjReadResult::cancelled set. Faces held back for normal generation are
+  // not delivered, and the weld map covers the positions read so far.
+  const ObjCancellationToken* cancellation = nullptr;
+
+  // If not null, trace events are recorded during the read and written to
+  // |trace| as Chrome trace event JSON when it returns, see WriteObjTrace.
+  // Events of other threads recording at the same time are included.
+  // Ignored unless THINKS_OBJ_IO_TRACE is defined.
+  std::ostream* trace = nullptr;
+};
+
+struct ObjReadResult {
+  std::uint32_t position_count;
+  std::uint32_t face_count;
+  std::uint32_t tex_coord_count;
+  std::uint32_t normal_count;
+  bool cancelled;
+};
+
+// Kind of error reported by TryReadObj.
+enum class ObjReadErrorKind {
+  kNone = 0,
+  kInvalidValue,        // Value, index or smoothing group not parsed.
+  kValueCount,          // Too few or too many values on a line.
+  kIndexRange,          // Index zero, too large or not yet read.
+  kIndexGroup,          // Malformed index group, e.g. "1/2/3/4" or "1//".
+  kUnrecognizedPrefix,  // Line prefix is not known.
+  kInvalidOptions,      // Read options do not fit the callbacks.
+  kException            // Thrown by a callback or the stream, or no memory.
+};
+
+// Describes why TryReadObj failed. |line| is one-based and |byte_offset|
+// is the offset of the offending token, or of the start of the line, from
+// where reading began; both are zero if the error is not tied to a line.
+// |excerpt| holds at most 32 bytes of the offending token, or of the line
+// if there is no single offending token. |message| is the message that
+// ReadObj throws for the same input; for ObjReadErrorKind::kException it
+// may be empty if there was no memory left to copy it.
+struct ObjReadError {
+  ObjReadErrorKind kind;
+  std::uint64_t line;
+  std::uint64_t byte_offset;
+  std::string excerpt;
+  std::string message;
+};
+
+struct ObjTryReadResult {
+  bool ok() const noexcept { return error.kind == ObjReadErrorKind::kNone; }
+
+  ObjReadResult result;
+  ObjReadError error;
+};
+
+// Statistics of a read, filled by the ReadObj overload that takes a
+// pointer to them. Reads without statistics do none of this work.
+struct ObjReadStats {
+  std::uint64_t bytes;
+
+  // Lines per prefix, including lines skipped for lack of a callback.
+  std::uint64_t position_lines;
+  std::uint64_t face_lines;
+  std::uint64_t tex_coord_lines;
+  std::uint64_t normal_lines;
+  std::uint64_t smoothing_group_lines;
+  std::uint64_t comment_lines;
+  std::uint64_t blank_lines;
+
+  // Longest line in bytes, without the newline.
+  std::uint64_t longest_line;
+
+  // Wall clock time spent waiting for input, parsing and in the callbacks.
+  // With ObjReadOptions::callback_thread the callback time is the time
+  // spent handing elements to the callback thread. Callbacks that append
+  // to ObjCsrFaceBuilder or ObjLazyFaces are counted as parsing.
+  std::uint64_t io_ns;
+  std::uint64_t parse_ns;
+  std::uint64_t callback_ns;
+
+  // Number of times the line and face index buffers of the reader grew,
+  // which is where the reader allocates once it is warmed up.
+  std::uint64_t buffer_growths;
+};
+
+struct ObjWriteOptions {
+  // If set, called by WriteObj with the progress of the write, every
+  // |progress_interval| elements and once at the end. Bytes are counted
+  // only if the stream reports its position.
+  std::function<void(const ObjProgress&)> progress;
+  std::uint32_t progress_interval = 1u << 16;
+
+  // If not null, polled at the same points as progress. A cancelled write
+  // stops after a complete line and returns the counts so far with
+  // ObjWriteResult::cancelled set.
+  const ObjCancellationToken* cancellation = nullptr;
+
+  // As ObjReadOptions::trace, for the write.
+  std::ostream* trace = nullptr;
+};
+
 namespace obj_io_internal {
 
 template <typename T>
@@ -272,22 +548,116 @@ struct FaceTraitsImpl<ObjPolygonFace<IndexT>> {
 template <typename T>
 using FaceTraits = FaceTraitsImpl<typename std::decay<T>::type>;
 
+template <typename T>
+struct IsTriangleFaceImpl : std::false_type {};
+
+template <typename IndexT>
+struct IsTriangleFaceImpl<ObjTriangleFace<IndexT>> : std::true_type {};
+
+template <typename T>
+using IsTriangleFace = IsTriangleFaceImpl<typename std::decay<T>::type>;
+
+template <typename FaceT>
+using FaceIndexType = typename decltype(
+    std::declval<typename std::decay<FaceT>::type>().values)::value_type;
+
+template <typename T>
+struct IsIndexGroupImpl : std::false_type {};
+
+template <typename IntT>
+struct IsIndexGroupImpl<ObjIndexGroup<IntT>> : std::true_type {};
+
+template <typename T>
+using IsIndexGroup = IsIndexGroupImpl<typename std::decay<T>::type>;
+
+template <typename IntT>
+IntT PositionIndexValue(const ObjIndex<IntT>& index) noexcept {
+  return index.value;
+}
+
+template <typename IntT>
+IntT PositionIndexValue(const ObjIndexGroup<IntT>& index_group) noexcept {
+  return index_group.position_index.value;
+}
+
+template <typename IntT>
+void SetPositionIndexValue(const IntT value, ObjIndex<IntT>* const index) {
+  index->value = value;
+}
+
+template <typename IntT>
+void SetPositionIndexValue(const IntT value,
+                           ObjIndexGroup<IntT>* const index_group) {
+  index_group->position_index.value = value;
+}
+
+// Indices without a normal index are left as they are.
+template <typename IntT>
+void SetNormalIndexValue(const IntT, ObjIndex<IntT>* const) {}
+
+template <typename IntT>
+void SetNormalIndexValue(const IntT value,
+                         ObjIndexGroup<IntT>* const index_group) {
+  index_group->normal_index = std::make_pair(ObjIndex<IntT>(value), true);
+}
+
 // Tag dispatch for optional vertex attributes, e.g. tex coords and normals.
 struct FuncTag {};
 struct NoOpFuncTag {};
 
 template <typename T>
-struct FuncTraits {
+struct FuncTraitsImpl {
   using FuncCategory = FuncTag;
 };
 
 template <>
-struct FuncTraits<std::nullptr_t> {
+struct FuncTraitsImpl<std::nullptr_t> {
   using FuncCategory = NoOpFuncTag;
 };
 
+// Decayed, so that stored (lvalue) null callbacks are also recognized.
+template <typename T>
+using FuncTraits = FuncTraitsImpl<typename std::decay<T>::type>;
+
+// Tag dispatch for face add functions that append indices to compressed
+// sparse row arrays (see MakeObjCsrAddFunc), which lets the reader skip
+// building a face object.
+struct FaceAddTag {};
+struct CsrAddTag {};
+
+template <typename IndexT>
+class CsrAddFunc;
+
+template <typename T>
+struct AddFaceTraitsImpl {
+  using AddCategory = FaceAddTag;
+};
+
+template <typename IndexT>
+struct AddFaceTraitsImpl<
+    ObjAddFunc<ObjPolygonFace<IndexT>, CsrAddFunc<IndexT>>> {
+  using AddCategory = CsrAddTag;
+};
+
+// Tag dispatch for face add functions that keep the text of face lines,
+// to be parsed later (see MakeObjLazyFaceAddFunc).
+struct LazyAddTag {};
+
+class LazyFaceAddFunc;
+
+template <>
+struct AddFaceTraitsImpl<
+    ObjAddFunc<ObjPolygonFace<ObjIndex<std::uint32_t>>, LazyFaceAddFunc>> {
+  using AddCategory = LazyAddTag;
+};
+
+template <typename T>
+using AddFaceTraits = AddFaceTraitsImpl<typename std::decay<T>::type>;
+
+// Returns false, with the reason in |message|, if a value is out of range.
 template <typename FloatT, std::size_t N>
-void ValidateObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord) {
+bool CheckObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord,
+                      std::string* const message) {
   using ValueType = typename decltype(tex_coord.values)::value_type;
 
   for (const auto v : tex_coord.values) {
@@ -295,9 +665,19 @@ void ValidateObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord) {
       auto oss = std::ostringstream{};
       oss << "texture coordinate values must be in range [0, 1] (found " << v
           << ")";
-      throw std::runtime_error(oss.str());
+      *message = oss.str();
+      return false;
     }
   }
+  return true;
+}
+
+template <typename FloatT, std::size_t N>
+void ValidateObjTexCoord(const ObjTexCoord<FloatT, N>& tex_coord) {
+  auto message = std::string{};
+  if (!CheckObjTexCoord(tex_coord, &message)) {
+    throw std::runtime_error(message);
+  }
 }
 
 template <typename FaceT>
@@ -321,511 +701,6172 @@ constexpr inline const char* FacePrefix() { return "f"; }
 constexpr inline const char* ObjTexCoordPrefix() { return "vt"; }
 constexpr inline const char* NormalPrefix() { return "vn"; }
 constexpr inline const char* IndexGroupSeparator() { return "/"; }
+constexpr inline const char* SmoothingGroupPrefix() { return "s"; }
+
+// Steady clock time in nanoseconds, for durations.
+inline std::uint64_t NowNs() {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
 
-namespace read {
+inline std::uint32_t ThreadCount(const std::uint32_t requested) {
+  if (requested > 0) {
+    return requested;
+  }
+  const auto hw = std::thread::hardware_concurrency();
+  return hw > 0 ? hw : 1;
+}
 
-inline std::vector<std::string> Tokenize(const std::string& str,
-                                         const char* const delimiters) {
-  auto tokens = std::vector<std::string>{};
-  auto prev = std::size_t{0};
-  auto pos = std::size_t{0};
-  while ((pos = str.find_first_of(delimiters, prev)) != std::string::npos) {
-    if (pos == prev) {
-      tokens.push_back(std::string{});
-    }
-    if (pos > prev) {
-      tokens.push_back(str.substr(prev, pos - prev));
-    }
-    prev = pos + 1;  // Skip delimiter.
+// Splits [0, count) into at most |thread_count| contiguous chunks and calls
+// |func(chunk_begin, chunk_end, chunk_index)| for each chunk, one thread per
+// chunk. Chunk boundaries only depend on |count| and |thread_count|, which
+// lets callers merge per-chunk results in a deterministic order. The first
+// exception thrown by any chunk is re-thrown on the calling thread. If a
+// thread cannot be created, the remaining chunks run on the calling thread.
+template <typename FuncT>
+void ParallelFor(const std::size_t count, const std::uint32_t thread_count,
+                 FuncT&& func) {
+  const auto chunk_count = std::max<std::size_t>(
+      1, std::min<std::size_t>(thread_count, count));
+  const auto chunk_size = (count + chunk_count - 1) / chunk_count;
+  if (chunk_count == 1) {
+    func(std::size_t{0}, count, std::size_t{0});
+    return;
   }
 
-  // Check for characters after last delimiter.
-  if (prev == str.length()) {
-    tokens.push_back(std::string{});
+  auto errors = std::vector<std::exception_ptr>(chunk_count);
+  auto threads = std::vector<std::thread>{};
+  threads.reserve(chunk_count);
+  auto inline_chunks = false;
+  for (auto chunk = std::size_t{0}; chunk < chunk_count; ++chunk) {
+    const auto begin = std::min(count, chunk * chunk_size);
+    const auto end = std::min(count, begin + chunk_size);
+    const auto run = [&func, &errors, begin, end, chunk]() {
+      try {
+        func(begin, end, chunk);
+      } catch (...) {
+        errors[chunk] = std::current_exception();
+      }
+    };
+    if (!inline_chunks) {
+      try {
+        threads.emplace_back(run);
+        continue;
+      } catch (const std::system_error&) {
+        inline_chunks = true;
+      }
+    }
+    run();
   }
-  if (prev < str.length()) {
-    tokens.push_back(str.substr(prev, std::string::npos));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
   }
-
-  return tokens;
 }
 
-inline std::vector<std::string> TokenizeIndexGroup(
-    const std::string& index_group_str) {
-  return Tokenize(index_group_str, IndexGroupSeparator());
-}
+namespace trace {
 
-template <typename T>
-bool ParseValue(std::istream* const is, T* const value) {
-  if (*is >> *value || !is->eof()) {
-    if (is->fail()) {
-      is->clear();  // Clear status bits.
-      auto dummy = std::string{};
-      *is >> dummy;
-      auto oss = std::ostringstream{};
-      oss << "failed parsing '" << dummy << "'";
-      throw std::runtime_error(oss.str());
+#if defined(THINKS_OBJ_IO_TRACE)
+
+struct Event {
+  const char* name;
+  std::uint64_t begin_ns;
+  std::uint64_t end_ns;
+  const char* arg_name;  // Null if the event has no argument.
+  std::uint64_t arg;
+};
+
+struct EventBlock {
+  static constexpr std::size_t kCapacity = 1024;
+
+  Event events[kCapacity];
+  std::atomic<std::size_t> size{0};
+  std::atomic<EventBlock*> next{nullptr};
+};
+
+// Events recorded by one thread, in a list of fixed size blocks. Only the
+// owning thread appends and each event is published by a release store of
+// the block size, so that the buffers of running threads can be written
+// out without the threads taking locks. Blocks are freed by the writer
+// once the owner has moved on to the next block.
+class ThreadBuffer {
+ public:
+  explicit ThreadBuffer(const std::uint32_t tid)
+      : tid_(tid), head_(new EventBlock), tail_(head_) {}
+
+  ThreadBuffer(const ThreadBuffer&) = delete;
+  ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+  ~ThreadBuffer() {
+    while (head_ != nullptr) {
+      auto* const next = head_->next.load(std::memory_order_relaxed);
+      delete head_;
+      head_ = next;
     }
-    return true;
   }
-  return false;
-}
 
-template <typename IntT>
-std::istream& operator>>(std::istream& is, ObjIndex<IntT>& index) {
-  if (ParseValue(&is, &index.value)) {
-    // Check for underflow.
-    if (!(index.value > 0)) {
-      throw std::runtime_error("parsed index must be greater than zero");
+  std::uint32_t tid() const noexcept { return tid_; }
+
+  // Owning thread only. Events are dropped if a block cannot be allocated.
+  void Append(const Event& event) noexcept {
+    auto size = tail_->size.load(std::memory_order_relaxed);
+    if (size == EventBlock::kCapacity) {
+      auto* const block = new (std::nothrow) EventBlock;
+      if (block == nullptr) {
+        return;
+      }
+      tail_->next.store(block, std::memory_order_release);
+      tail_ = block;
+      size = 0;
     }
+    tail_->events[size] = event;
+    tail_->size.store(size + 1, std::memory_order_release);
+  }
 
-    // Convert to zero-based index.
-    --index.value;
+  // Calls |func(event)| for the events published since the previous call.
+  // Callers must not consume the same buffer concurrently.
+  template <typename FuncT>
+  void Consume(FuncT&& func) {
+    for (;;) {
+      // A block is full once it has a next block.
+      auto* const next = head_->next.load(std::memory_order_acquire);
+      const auto size = head_->size.load(std::memory_order_acquire);
+      for (; consumed_ < size; ++consumed_) {
+        func(head_->events[consumed_]);
+      }
+      if (next == nullptr) {
+        return;
+      }
+      delete head_;
+      head_ = next;
+      consumed_ = 0;
+    }
   }
 
-  return is;
+ private:
+  std::uint32_t tid_;
+  EventBlock* head_;  // Consumer side.
+  std::size_t consumed_ = 0;
+  EventBlock* tail_;  // Owner side.
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  std::uint32_t next_tid = 1;
+  std::uint64_t epoch_ns = NowNs();
+};
+
+inline Registry& GlobalRegistry() {
+  static Registry registry;
+  return registry;
 }
 
-template <typename IntT>
-std::istream& operator>>(std::istream& is, ObjIndexGroup<IntT>& index_group) {
-  // Read index group as the string leading up to the
-  // following whitespace/newline.
-  auto index_group_str = std::string{};
-  if (!ParseValue(&is, &index_group_str)) {
-    return is;
-  }
+// The buffer of the calling thread, registered on first use. The registry
+// keeps buffers of finished threads until their events are written.
+inline ThreadBuffer* LocalBuffer() {
+  thread_local const auto buffer = []() {
+    auto& registry = GlobalRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(
+        std::make_shared<ThreadBuffer>(registry.next_tid++));
+    return registry.buffers.back();
+  }();
+  return buffer.get();
+}
 
-  const auto tokens = TokenizeIndexGroup(index_group_str);
-  if (tokens.empty()) {
-    throw std::runtime_error("empty index group tokens");
-  }
+// Events are recorded while EnableObjTrace is on or while a call with a
+// trace stream in its options is running.
+inline std::atomic<bool>& GloballyEnabled() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
 
-  if (tokens.size() > 3) {
-    auto oss = std::stringstream{};
-    oss << "index group can have at most 3 tokens ('" << index_group_str
-        << "')";
-    throw std::runtime_error(oss.str());
-  }
+inline std::atomic<std::uint32_t>& RecordingCount() {
+  static std::atomic<std::uint32_t> count{0};
+  return count;
+}
 
-  // ObjPosition index.
-  if (tokens[0].empty()) {
-    auto oss = std::stringstream{};
-    oss << "empty position index ('" << index_group_str << "')";
-    throw std::runtime_error(oss.str());
-  }
-  auto iss_pos = std::istringstream(tokens[0]);
-  iss_pos >> index_group.position_index;
+inline bool Recording() noexcept {
+  return RecordingCount().load(std::memory_order_relaxed) > 0;
+}
 
-  // Texture coordinate index, may be empty.
-  if (tokens.size() > 1 && !tokens[1].empty()) {
-    auto iss_tex = std::istringstream(tokens[1]);
-    iss_tex >> index_group.tex_coord_index.first;
-    index_group.tex_coord_index.second = true;
+inline void WriteEvents(std::ostream& os) {
+  auto& registry = GlobalRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  const auto to_us = [&registry](const std::uint64_t ns) {
+    return static_cast<double>(ns - std::min(ns, registry.epoch_ns)) / 1000.0;
+  };
+  auto first = true;
+  os << "{\"traceEvents\":[";
+  for (const auto& buffer : registry.buffers) {
+    buffer->Consume([&](const Event& event) {
+      char times[64];
+      std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                    to_us(event.begin_ns),
+                    to_us(event.end_ns) - to_us(event.begin_ns));
+      os << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+         << "\",\"cat\":\"obj_io\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+         << buffer->tid() << "," << times;
+      if (event.arg_name != nullptr) {
+        os << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << "}";
+      }
+      os << "}";
+      first = false;
+    });
   }
+  os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+  // Buffers of finished threads are only referenced by the registry.
+  registry.buffers.erase(
+      std::remove_if(registry.buffers.begin(), registry.buffers.end(),
+                     [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                       return buffer.use_count() == 1;
+                     }),
+      registry.buffers.end());
+}
 
-  // ObjNormal index.
-  if (tokens.size() > 2) {
-    if (tokens[2].empty()) {
-      auto oss = std::stringstream{};
-      oss << "empty normal index ('" << index_group_str << "')";
-      throw std::runtime_error(oss.str());
+// Records the time from construction to destruction as a complete event
+// on the buffer of the calling thread. |name| must outlive the trace, in
+// practice it is a string literal.
+class Span {
+ public:
+  explicit Span(const char* const name)
+      : buffer_(Recording() ? LocalBuffer() : nullptr),
+        event_{name, buffer_ != nullptr ? NowNs() : 0, 0, nullptr, 0} {}
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+  ~Span() {
+    if (buffer_ != nullptr) {
+      event_.end_ns = NowNs();
+      buffer_->Append(event_);
     }
-    auto iss_nml = std::istringstream(tokens[2]);
-    iss_nml >> index_group.normal_index.first;
-    index_group.normal_index.second = true;
   }
 
-  return is;
+  void Arg(const char* const name, const std::uint64_t value) noexcept {
+    event_.arg_name = name;
+    event_.arg = value;
+  }
+
+ private:
+  ThreadBuffer* buffer_;
+  Event event_;
+};
+
+inline std::uint32_t& CallDepth() {
+  thread_local auto depth = std::uint32_t{0};
+  return depth;
 }
 
-template <typename T, std::size_t N>
-std::uint32_t ParseValues(std::istringstream* const iss,
-                          std::array<T, N>* const values) {
-  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
-  using ValueType = typename ContainerType::value_type;
+// Records events during a call that has a trace stream in its options and
+// writes them to the stream when the outermost such call on this thread
+// returns.
+class CallScope {
+ public:
+  explicit CallScope(std::ostream* const os)
+      : os_(CallDepth() == 0 ? os : nullptr) {
+    if (os_ != nullptr) {
+      ++CallDepth();
+      RecordingCount().fetch_add(1, std::memory_order_relaxed);
+    }
+  }
 
-  constexpr auto kValueCount = std::tuple_size<ContainerType>::value;
-  static_assert(kValueCount > 0, "empty array");
+  CallScope(const CallScope&) = delete;
+  CallScope& operator=(const CallScope&) = delete;
 
-  auto parse_count = std::uint32_t{0};
-  auto value = ValueType{};
-  while (ParseValue(iss, &value)) {
-    if (parse_count >= kValueCount) {
-      auto oss = std::ostringstream{};
-      oss << "expected to parse at most " << kValueCount << " values";
-      throw std::runtime_error(oss.str());
+  ~CallScope() {
+    if (os_ == nullptr) {
+      return;
+    }
+    RecordingCount().fetch_sub(1, std::memory_order_relaxed);
+    --CallDepth();
+    try {
+      WriteEvents(*os_);
+    } catch (...) {
+      // A failed trace must not replace the outcome of the call.
     }
-    (*values)[parse_count++] = value;
   }
 
-  return parse_count;
-}
+ private:
+  std::ostream* os_;
+};
 
-template <typename T>
-std::uint32_t ParseValues(std::istringstream* const iss,
-                          std::vector<T>* const values) {
-  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
-  using ValueType = typename ContainerType::value_type;
+#else  // THINKS_OBJ_IO_TRACE
 
-  auto value = ValueType{};
-  while (ParseValue(iss, &value)) {
-    values->push_back(value);
+// Trace hooks that compile to nothing.
+class Span {
+ public:
+  explicit Span(const char* const) noexcept {}
+  void Arg(const char* const, const std::uint64_t) noexcept {}
+};
+
+class CallScope {
+ public:
+  explicit CallScope(std::ostream* const) noexcept {}
+};
+
+#endif  // THINKS_OBJ_IO_TRACE
+
+}  // namespace trace
+}  // namespace obj_io_internal
+
+// Turns recording of trace events on or off for all threads. Events are
+// kept in per-thread buffers until written by WriteObjTrace. Tracing is
+// only available if THINKS_OBJ_IO_TRACE is defined, otherwise this does
+// nothing.
+inline void EnableObjTrace(const bool enable) {
+#if defined(THINKS_OBJ_IO_TRACE)
+  using obj_io_internal::trace::GloballyEnabled;
+  using obj_io_internal::trace::RecordingCount;
+  if (GloballyEnabled().exchange(enable) != enable) {
+    if (enable) {
+      RecordingCount().fetch_add(1, std::memory_order_relaxed);
+    } else {
+      RecordingCount().fetch_sub(1, std::memory_order_relaxed);
+    }
   }
+#else
+  static_cast<void>(enable);
+#endif
+}
 
-  return static_cast<std::uint32_t>(values->size());
+// Writes the trace events recorded since the previous write, from all
+// threads, as Chrome trace event JSON (for chrome://tracing or Perfetto)
+// and drops them. Without THINKS_OBJ_IO_TRACE the trace is empty.
+inline void WriteObjTrace(std::ostream& os) {
+#if defined(THINKS_OBJ_IO_TRACE)
+  obj_io_internal::trace::WriteEvents(os);
+#else
+  os << "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\"}\n";
+#endif
 }
 
-template <typename AddPositionFuncT>
-void ParsePosition(std::istringstream* const iss, AddPositionFuncT&& add_position,
-                   std::uint32_t* const count) {
-  using ParseType = typename std::decay<AddPositionFuncT>::type::ParseType;
-  static_assert(IsPosition<ParseType>::value,
-                "parse type must be a ObjPosition type");
+namespace obj_io_internal {
 
-  auto position = ParseType{};
-  const auto parse_count = ParseValues(iss, &position.values);
+// Reports progress to an optional callback and polls an optional
+// cancellation token. Callers decide how often, typically once per block.
+class ProgressMonitor {
+ public:
+  ProgressMonitor(const std::function<void(const ObjProgress&)>& callback,
+                  const ObjCancellationToken* const cancellation,
+                  const std::uint64_t bytes_total)
+      : callback_(callback),
+        cancellation_(cancellation),
+        bytes_total_(bytes_total) {}
+
+  bool enabled() const noexcept {
+    return callback_ || cancellation_ != nullptr;
+  }
 
-  if (parse_count < 3) {
-    auto oss = std::ostringstream{};
-    oss << "positions must have 3 or 4 values (found " << parse_count << ")";
-    throw std::runtime_error(oss.str());
+  void Report(const std::uint64_t bytes_done,
+              const std::uint64_t elements_done) const {
+    if (!callback_) {
+      return;
+    }
+    auto progress = ObjProgress{};
+    progress.bytes_done = bytes_done;
+    progress.bytes_total = bytes_total_;
+    progress.elements_done = elements_done;
+    progress.elements_total =
+        bytes_done > 0 && bytes_total_ > 0
+            ? static_cast<std::uint64_t>(static_cast<double>(elements_done) *
+                                         static_cast<double>(bytes_total_) /
+                                         static_cast<double>(bytes_done))
+            : 0;
+    callback_(progress);
   }
 
-  // Fourth position value (if any) defaults to 1.
-  using ArrayType = decltype(position.values);
-  if (std::tuple_size<ArrayType>::value == 4 && parse_count == 3) {
-    position.values[3] = typename ArrayType::value_type{1};
+  // Reports progress and returns true if cancellation was requested.
+  bool Update(const std::uint64_t bytes_done,
+              const std::uint64_t elements_done) const {
+    Report(bytes_done, elements_done);
+    return cancellation_ != nullptr && cancellation_->cancelled();
   }
 
-  add_position.func(position);
-  ++(*count);
+ private:
+  const std::function<void(const ObjProgress&)>& callback_;
+  const ObjCancellationToken* cancellation_;
+  std::uint64_t bytes_total_;
+};
+
+template <typename ResultT>
+std::uint64_t ElementCount(const ResultT& result) noexcept {
+  return std::uint64_t{result.position_count} + result.face_count +
+         result.tex_coord_count + result.normal_count;
 }
 
-template <typename AddFaceFuncT>
-void ParseFace(std::istringstream* const iss, 
-               AddFaceFuncT&& add_face,
-               std::uint32_t* const count) {
-  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
-  static_assert(IsFace<ParseType>::value, "parse type must be a Face type");
+namespace weld {
 
-  auto face = ParseType{};
-  const auto parse_count = ParseValues(iss, &face.values);
+using Cell = std::array<std::int64_t, 3>;
 
-  // Works for both std::array and std::vector.
-  // This is never an issue for polygons.
-  if (parse_count != face.values.size()) {
-    auto oss = std::ostringstream{};
-    oss << "expected " << face.values.size() << " face indices (found "
-        << parse_count << ")";
-    throw std::runtime_error(oss.str());
+// Marks empty table slots and list ends.
+constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+// Open-addressing (linear probing) hash table mapping grid cells to values.
+class CellTable {
+ public:
+  explicit CellTable(const std::size_t expected_count = 0) {
+    auto capacity = std::size_t{16};
+    while (capacity < 2 * expected_count) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity);
   }
 
-  ValidateFace(face, typename FaceTraits<ParseType>::FaceCategory{});
-  add_face.func(face);
-  ++(*count);
-}
+  // Returns a pointer to the value of |cell|, or null if there is none.
+  const std::uint32_t* Find(const Cell& cell) const {
+    const auto mask = slots_.size() - 1;
+    for (auto i = Hash(cell) & mask; slots_[i].value != kNone;
+         i = (i + 1) & mask) {
+      if (slots_[i].cell == cell) {
+        return &slots_[i].value;
+      }
+    }
+    return nullptr;
+  }
 
-template <typename AddObjTexCoordFuncT>
-void ParseObjTexCoord(std::istringstream* const iss,
-                   AddObjTexCoordFuncT&& add_tex_coord, 
-                   std::uint32_t* const count,
-                   FuncTag) {
-  using ParseType = typename std::decay<AddObjTexCoordFuncT>::type::ParseType;
-  static_assert(IsObjTexCoord<ParseType>::value,
-                "parse type must be a ObjTexCoord type");
+  std::uint32_t* Find(const Cell& cell) {
+    return const_cast<std::uint32_t*>(
+        static_cast<const CellTable*>(this)->Find(cell));
+  }
 
-  auto tex_coord = ParseType{};
-  const auto parse_count = ParseValues(iss, &tex_coord.values);
+  // Returns the value of |cell|, inserting |value| if there is none.
+  std::uint32_t Insert(const Cell& cell, const std::uint32_t value) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      Grow();
+    }
+    const auto mask = slots_.size() - 1;
+    auto i = Hash(cell) & mask;
+    for (; slots_[i].value != kNone; i = (i + 1) & mask) {
+      if (slots_[i].cell == cell) {
+        return slots_[i].value;
+      }
+    }
+    slots_[i].cell = cell;
+    slots_[i].value = value;
+    ++size_;
+    return value;
+  }
 
-  if (parse_count < 2) {
-    auto oss = std::ostringstream{};
-    oss << "texture coordinates must have 2 or 3 values (found " << parse_count
-        << ")";
-    throw std::runtime_error(oss.str());
+  // Removes all cells, keeping the allocated slots.
+  void Clear() {
+    for (auto& slot : slots_) {
+      slot.value = kNone;
+    }
+    size_ = 0;
   }
 
-  // Third texture coordinate value (if any) defaults to 1.
-  using ArrayType = decltype(tex_coord.values);
-  if (std::tuple_size<ArrayType>::value == 3 && parse_count == 2) {
-    tex_coord.values[2] = typename ArrayType::value_type{1};
+ private:
+  struct Slot {
+    Cell cell;
+    std::uint32_t value = kNone;
+  };
+
+  static std::size_t Hash(const Cell& cell) noexcept {
+    auto h = static_cast<std::uint64_t>(cell[0]) * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ static_cast<std::uint64_t>(cell[1])) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ static_cast<std::uint64_t>(cell[2])) * 0x94d049bb133111ebULL;
+    return static_cast<std::size_t>(h ^ (h >> 31));
   }
 
-  ValidateObjTexCoord(tex_coord);
-  add_tex_coord.func(tex_coord);
-  ++(*count);
-}
+  void Grow() {
+    auto old_slots = std::vector<Slot>(2 * slots_.size());
+    old_slots.swap(slots_);
+    size_ = 0;
+    for (const auto& slot : old_slots) {
+      if (slot.value != kNone) {
+        Insert(slot.cell, slot.value);
+      }
+    }
+  }
 
-// Dummy.
-template <typename AddObjTexCoordFuncT>
-void ParseObjTexCoord(std::istringstream* const, AddObjTexCoordFuncT&&,
-                   std::uint32_t* const, NoOpFuncTag) {}
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+};
 
-template <typename AddNormalFuncT>
-void ParseNormal(std::istringstream* const iss, 
-                 AddNormalFuncT&& add_normal,
-                 std::uint32_t* const count, 
-                 FuncTag) {
-  using ParseType = typename std::decay<AddNormalFuncT>::type::ParseType;
-  static_assert(IsNormal<ParseType>::value, "parse type must be a ObjNormal type");
+// Grid with cells of size epsilon: positions within epsilon of each other
+// are always in the same or in adjacent cells. An epsilon of zero only
+// merges identical positions.
+class Grid {
+ public:
+  explicit Grid(const double epsilon)
+      : epsilon_squared_(epsilon * epsilon),
+        inv_cell_size_(epsilon > 0.0 ? 1.0 / epsilon : 1.0),
+        radius_(epsilon > 0.0 ? 1 : 0) {
+    if (!(epsilon >= 0.0)) {
+      throw std::runtime_error("weld epsilon must be non-negative");
+    }
+  }
 
-  auto normal = ParseType{};
-  const auto parse_count = ParseValues(iss, &normal.values);
+  Cell CellOf(const std::array<double, 3>& p) const noexcept {
+    constexpr auto kMax = double{std::int64_t{1} << 62};
+    auto cell = Cell{};
+    for (auto k = std::size_t{0}; k < 3; ++k) {
+      const auto c = std::floor(p[k] * inv_cell_size_);
+      cell[k] = static_cast<std::int64_t>(std::max(-kMax, std::min(kMax, c)));
+    }
+    return cell;
+  }
 
-  if (parse_count < 3) {
-    auto oss = std::ostringstream{};
-    oss << "normals must have 3 values (found " << parse_count << ")";
-    throw std::runtime_error(oss.str());
+  bool Near(const std::array<double, 3>& a,
+            const std::array<double, 3>& b) const noexcept {
+    const auto dx = a[0] - b[0];
+    const auto dy = a[1] - b[1];
+    const auto dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz <= epsilon_squared_;
   }
 
-  add_normal.func(normal);
-  ++(*count);
-}
+  // Calls |func(neighbor_cell)| for |cell| and, for non-zero epsilon, the
+  // 26 cells surrounding it.
+  template <typename FuncT>
+  void ForEachNeighbor(const Cell& cell, FuncT&& func) const {
+    for (auto dz = -radius_; dz <= radius_; ++dz) {
+      for (auto dy = -radius_; dy <= radius_; ++dy) {
+        for (auto dx = -radius_; dx <= radius_; ++dx) {
+          func(Cell{{cell[0] + dx, cell[1] + dy, cell[2] + dz}});
+        }
+      }
+    }
+  }
 
-// Dummy.
-template <typename AddNormalFuncT>
-void ParseNormal(std::istringstream* const, AddNormalFuncT&&,
-                 std::uint32_t* const, NoOpFuncTag) {}
+ private:
+  double epsilon_squared_;
+  double inv_cell_size_;
+  std::int64_t radius_;
+};
 
-template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
-          typename AddNormalFuncT, typename AddFaceFuncT>
-void ParseLine(const std::string& line, 
-               AddPositionFuncT&& add_position,
-               AddFaceFuncT&& add_face, 
-               AddObjTexCoordFuncT&& add_tex_coord,
-               AddNormalFuncT&& add_normal, 
-               std::uint32_t* const position_count,
-               std::uint32_t* const face_count,
-               std::uint32_t* const tex_coord_count,
-               std::uint32_t* const normal_count) {
-  auto iss = std::istringstream(line);
+// Incremental welder. Each added position is merged into the earliest
+// previously kept position within epsilon, if any, otherwise it is kept.
+class PositionWelder {
+ public:
+  explicit PositionWelder(const double epsilon) : grid_(epsilon) {}
+
+  // Returns the welded index of |p| and whether |p| was kept, i.e. is the
+  // first position of its group.
+  std::pair<std::uint32_t, bool> Add(const std::array<double, 3>& p) {
+    const auto cell = grid_.CellOf(p);
+    auto best = kNone;
+    grid_.ForEachNeighbor(cell, [this, &p, &best](const Cell& neighbor) {
+      const auto head = cells_.Find(neighbor);
+      if (head == nullptr) {
+        return;
+      }
+      for (auto i = *head; i != kNone; i = next_[i]) {
+        if (i < best && grid_.Near(p, kept_[i])) {
+          best = i;
+        }
+      }
+    });
+    if (best != kNone) {
+      return std::make_pair(best, false);
+    }
 
-  // Prefix is first non-whitespace token.
-  auto prefix = std::string{};
-  iss >> prefix;
+    const auto index = static_cast<std::uint32_t>(kept_.size());
+    kept_.push_back(p);
+    next_.push_back(kNone);
+    const auto head = cells_.Insert(cell, index);
+    if (head != index) {
+      // Link into the cell's list, right after its head.
+      auto* const head_value = cells_.Find(cell);
+      next_[index] = next_[*head_value];
+      next_[*head_value] = index;
+    }
+    return std::make_pair(index, true);
+  }
 
-  // Parse the rest of the line depending on prefix.
-  if (prefix.empty() || prefix == CommentPrefix()) {
-    return;  // Ignore empty lines and comments.
-  } else if (prefix == PositionPrefix()) {
-    ParsePosition(&iss, std::forward<AddPositionFuncT>(add_position),
-                  position_count);
-  } else if (prefix == FacePrefix()) {
-    ParseFace(&iss, std::forward<AddFaceFuncT>(add_face), face_count);
-  } else if (prefix == ObjTexCoordPrefix()) {
-    ParseObjTexCoord(&iss, std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-                     tex_coord_count,
-                     typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
-  } else if (prefix == NormalPrefix()) {
-    ParseNormal(&iss, std::forward<AddNormalFuncT>(add_normal), normal_count,
-                typename FuncTraits<AddNormalFuncT>::FuncCategory{});
-  } else {
-    auto oss = std::ostringstream{};
-    oss << "unrecognized line prefix '" << prefix << "'";
-    throw std::runtime_error(oss.str());
+  void Clear() {
+    cells_.Clear();
+    kept_.clear();
+    next_.clear();
   }
-}
 
-template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
-          typename AddNormalFuncT, typename AddFaceFuncT>
-void ParseLines(std::istream& is, 
-                AddPositionFuncT&& add_position,
-                AddFaceFuncT&& add_face, 
-                AddObjTexCoordFuncT&& add_tex_coord,
-                AddNormalFuncT&& add_normal,
-                std::uint32_t* const position_count,
-                std::uint32_t* const face_count,
-                std::uint32_t* const tex_coord_count,
-                std::uint32_t* const normal_count) {
-  auto line = std::string{};
-  while (std::getline(is, line)) {
-    obj_io_internal::read::ParseLine(
-        line, 
-        std::forward<AddPositionFuncT>(add_position),
-        std::forward<AddFaceFuncT>(add_face),
-        std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-        std::forward<AddNormalFuncT>(add_normal), 
-        position_count, face_count,
-        tex_coord_count, normal_count);
+ private:
+  Grid grid_;
+  CellTable cells_;
+  std::vector<std::array<double, 3>> kept_;
+  std::vector<std::uint32_t> next_;  // Next kept position in the same cell.
+};
+
+}  // namespace weld
+
+namespace triangulate {
+
+// Calls |emit(a, b, c)| with corner indices of a fan over |corner_count|
+// corners.
+template <typename EmitT>
+void Fan(const std::size_t corner_count, EmitT&& emit) {
+  for (auto i = std::size_t{1}; i + 1 < corner_count; ++i) {
+    emit(std::size_t{0}, i, i + 1);
   }
 }
 
-}  // namespace read
+// Buffers reused across faces.
+struct EarClipScratch {
+  std::vector<std::array<double, 3>> positions;
+  std::vector<double> u;
+  std::vector<double> v;
+  std::vector<std::size_t> prev;
+  std::vector<std::size_t> next;
+};
 
-namespace write {
+inline double Cross2(const double ax, const double ay, const double bx,
+                     const double by) noexcept {
+  return ax * by - ay * bx;
+}
 
-template <typename IntT>
-std::ostream& operator<<(std::ostream& os, const ObjIndex<IntT>& index) {
-  using ValueType = decltype(index.value);
+// Calls |emit(a, b, c)| with corner indices of triangles covering the
+// polygon given by |scratch->positions|. The polygon is projected onto the
+// coordinate plane most aligned with its (Newell) normal and clipped one
+// convex ear at a time. Triangles keep the winding of the input polygon.
+template <typename EmitT>
+void EarClip(EarClipScratch* const scratch, EmitT&& emit) {
+  const auto& pos = scratch->positions;
+  const auto n = pos.size();
+
+  auto normal = std::array<double, 3>{{0.0, 0.0, 0.0}};
+  for (auto i = std::size_t{0}; i < n; ++i) {
+    const auto& a = pos[i];
+    const auto& b = pos[(i + 1) % n];
+    normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+    normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+    normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+  }
+  auto axis = std::size_t{0};
+  for (auto k = std::size_t{1}; k < 3; ++k) {
+    if (std::abs(normal[k]) > std::abs(normal[axis])) {
+      axis = k;
+    }
+  }
+  if (!(std::abs(normal[axis]) > 0.0)) {
+    Fan(n, std::forward<EmitT>(emit));  // Degenerate polygon.
+    return;
+  }
 
-  // Note that the valid range allows increment of one.
-  if (!(ValueType{0} <= index.value &&
-        index.value < std::numeric_limits<ValueType>::max())) {
-    auto oss = std::ostringstream{};
-    oss << "invalid index: " << static_cast<std::int64_t>(index.value);
-    throw std::runtime_error(oss.str());
+  // Project onto the plane orthogonal to |axis|, keeping the cyclic axis
+  // order so that the polygon is counter-clockwise in the plane.
+  const auto iu = (axis + 1) % 3;
+  const auto iv = (axis + 2) % 3;
+  const auto flip = normal[axis] < 0.0 ? -1.0 : 1.0;
+  scratch->u.resize(n);
+  scratch->v.resize(n);
+  scratch->prev.resize(n);
+  scratch->next.resize(n);
+  for (auto i = std::size_t{0}; i < n; ++i) {
+    scratch->u[i] = pos[i][iu];
+    scratch->v[i] = flip * pos[i][iv];
+    scratch->prev[i] = (i + n - 1) % n;
+    scratch->next[i] = (i + 1) % n;
   }
+  const auto& u = scratch->u;
+  const auto& v = scratch->v;
+  auto& prev = scratch->prev;
+  auto& next = scratch->next;
+
+  const auto is_ear = [&u, &v, &next](const std::size_t a, const std::size_t b,
+                                      const std::size_t c) {
+    // Convex corner.
+    if (!(Cross2(u[b] - u[a], v[b] - v[a], u[c] - u[b], v[c] - v[b]) > 0.0)) {
+      return false;
+    }
 
-  // Input indices are assumed to be zero-based.
-  // OBJ format uses one-based indexing.
-  os << index.value + 1;
-  return os;
+    // No other remaining corner inside (or on the boundary of) the ear.
+    for (auto p = next[c]; p != a; p = next[p]) {
+      if ((u[p] == u[a] && v[p] == v[a]) || (u[p] == u[b] && v[p] == v[b]) ||
+          (u[p] == u[c] && v[p] == v[c])) {
+        continue;
+      }
+      if (Cross2(u[b] - u[a], v[b] - v[a], u[p] - u[a], v[p] - v[a]) >= 0.0 &&
+          Cross2(u[c] - u[b], v[c] - v[b], u[p] - u[b], v[p] - v[b]) >= 0.0 &&
+          Cross2(u[a] - u[c], v[a] - v[c], u[p] - u[c], v[p] - v[c]) >= 0.0) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  auto remaining = n;
+  auto i = std::size_t{0};
+  auto attempts = std::size_t{0};
+  while (remaining > 3) {
+    const auto a = prev[i];
+    const auto c = next[i];
+
+    // If a full lap finds no ear the remaining polygon is degenerate (or
+    // self-intersecting), clip anyway to guarantee progress.
+    if (is_ear(a, i, c) || attempts >= remaining) {
+      emit(a, i, c);
+      next[a] = c;
+      prev[c] = a;
+      --remaining;
+      attempts = 0;
+      i = c;
+    } else {
+      ++attempts;
+      i = c;
+    }
+  }
+  emit(prev[i], i, next[i]);
 }
 
-template <typename IntT>
-std::ostream& operator<<(std::ostream& os,
-                         const ObjIndexGroup<IntT>& index_group) {
-  os << index_group.position_index;
-  if (index_group.tex_coord_index.second && index_group.normal_index.second) {
-    os << IndexGroupSeparator() << index_group.tex_coord_index.first
-       << IndexGroupSeparator() << index_group.normal_index.first;
-  } else if (index_group.tex_coord_index.second) {
-    os << IndexGroupSeparator() << index_group.tex_coord_index.first;
-  } else if (index_group.normal_index.second) {
-    os << IndexGroupSeparator() << IndexGroupSeparator()
-       << index_group.normal_index.first;
-  }
-  return os;
+}  // namespace triangulate
+
+namespace normals {
+
+inline std::array<double, 3> Sub(const std::array<double, 3>& a,
+                                 const std::array<double, 3>& b) noexcept {
+  return {{a[0] - b[0], a[1] - b[1], a[2] - b[2]}};
 }
 
-inline void WriteHeader(std::ostream& os, const std::string& newline) {
-  os << CommentPrefix() << " Written by https://github.com/thinks/obj-io"
-     << newline;
+inline double Dot(const std::array<double, 3>& a,
+                  const std::array<double, 3>& b) noexcept {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
 }
 
-template <template <typename> class MappedTypeCheckerT, typename MapperT,
-          typename ValidatorT>
-std::uint32_t WriteMappedLines(std::ostream& os, const std::string& line_prefix,
-                               MapperT&& mapper, ValidatorT validator,
-                               const std::string& newline) {
-  auto count = std::uint32_t{0};
-  auto map_result = mapper();
-  while (!map_result.is_end) {
-    static_assert(MappedTypeCheckerT<decltype(map_result.value)>::value,
-                  "incorrect mapped type");
+inline std::array<double, 3> Normalized(const std::array<double, 3>& a) {
+  const auto length = std::sqrt(Dot(a, a));
+  return length > 0.0
+             ? std::array<double, 3>{{a[0] / length, a[1] / length,
+                                      a[2] / length}}
+             : a;
+}
 
-    validator(map_result.value);
+// Generates vertex normals for faces given as flat corner position indices
+// and face offsets. Corners of faces in smoothing group zero (off) get the
+// face normal, other corners share one normal per (position, smoothing
+// group). Normals are numbered by first occurrence, |corner_normals|
+// receives the normal index of each corner.
+//
+// Per-corner weighted face normals are computed in parallel over face
+// chunks, after which each normal gathers the contributions of its corners
+// in parallel over normal chunks. Neither pass scatters into shared memory,
+// so no synchronization is needed and results do not depend on the
+// number of threads.
+inline void Generate(const std::vector<std::array<double, 3>>& positions,
+                     const std::vector<std::uint32_t>& corner_positions,
+                     const std::vector<std::size_t>& face_offsets,
+                     const std::vector<std::uint32_t>& face_groups,
+                     const bool angle_weighted,
+                     const std::uint32_t thread_count,
+                     std::vector<std::array<double, 3>>* const normals,
+                     std::vector<std::uint32_t>* const corner_normals) {
+  const auto face_count = face_groups.size();
+  const auto corner_count = corner_positions.size();
+  for (const auto p : corner_positions) {
+    if (!(p < positions.size())) {
+      auto oss = std::ostringstream{};
+      oss << "position index " << p + 1 << " out of range (found "
+          << positions.size() << " positions)";
+      throw std::runtime_error(oss.str());
+    }
+  }
 
-    // Write line.
-    os << line_prefix;
-    for (const auto& element : map_result.value.values) {
-      os << " " << element;
+  // Weighted face normal per corner (parallel over faces).
+  auto contributions = std::vector<std::array<double, 3>>(corner_count);
+  ParallelFor(
+      face_count, thread_count,
+      [&](const std::size_t begin, const std::size_t end, const std::size_t) {
+        for (auto f = begin; f < end; ++f) {
+          const auto first = face_offsets[f];
+          const auto n = face_offsets[f + 1] - first;
+
+          // Newell normal, its length is twice the face area.
+          auto face_normal = std::array<double, 3>{{0.0, 0.0, 0.0}};
+          for (auto i = std::size_t{0}; i < n; ++i) {
+            const auto& a = positions[corner_positions[first + i]];
+            const auto& b = positions[corner_positions[first + (i + 1) % n]];
+            face_normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+            face_normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+            face_normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+          }
+
+          if (!angle_weighted) {
+            for (auto i = std::size_t{0}; i < n; ++i) {
+              contributions[first + i] = face_normal;
+            }
+            continue;
+          }
+
+          const auto unit = Normalized(face_normal);
+          for (auto i = std::size_t{0}; i < n; ++i) {
+            const auto& p = positions[corner_positions[first + i]];
+            const auto e0 = Normalized(
+                Sub(positions[corner_positions[first + (i + n - 1) % n]], p));
+            const auto e1 = Normalized(
+                Sub(positions[corner_positions[first + (i + 1) % n]], p));
+            const auto angle =
+                std::acos(std::max(-1.0, std::min(1.0, Dot(e0, e1))));
+            contributions[first + i] = {
+                {angle * unit[0], angle * unit[1], angle * unit[2]}};
+          }
+        }
+      });
+
+  // Normal index per corner, in order of first occurrence.
+  corner_normals->resize(corner_count);
+  auto table = weld::CellTable(corner_count / 4);
+  auto normal_count = std::uint32_t{0};
+  for (auto f = std::size_t{0}; f < face_count; ++f) {
+    const auto group = face_groups[f];
+    const auto flat_normal = normal_count;
+    if (group == 0) {
+      ++normal_count;
     }
-    os << newline;
+    for (auto c = face_offsets[f]; c < face_offsets[f + 1]; ++c) {
+      if (group == 0) {
+        (*corner_normals)[c] = flat_normal;
+        continue;
+      }
+      const auto key = weld::Cell{{std::int64_t{corner_positions[c]},
+                                   std::int64_t{group}, 0}};
+      const auto index = table.Insert(key, normal_count);
+      if (index == normal_count) {
+        ++normal_count;
+      }
+      (*corner_normals)[c] = index;
+    }
+  }
 
-    ++count;
-    map_result = mapper();
+  // Corners per normal, in compressed row form.
+  auto offsets = std::vector<std::size_t>(normal_count + 1, 0);
+  for (const auto index : *corner_normals) {
+    ++offsets[index + 1];
   }
-  return count;
+  for (auto i = std::size_t{1}; i < offsets.size(); ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+  auto members = std::vector<std::size_t>(corner_count);
+  {
+    auto fill = std::vector<std::size_t>(offsets.begin(), offsets.end() - 1);
+    for (auto c = std::size_t{0}; c < corner_count; ++c) {
+      members[fill[(*corner_normals)[c]]++] = c;
+    }
+  }
+
+  // Gather (parallel over normals).
+  normals->resize(normal_count);
+  ParallelFor(
+      normal_count, thread_count,
+      [&](const std::size_t begin, const std::size_t end, const std::size_t) {
+        for (auto i = begin; i < end; ++i) {
+          auto sum = std::array<double, 3>{{0.0, 0.0, 0.0}};
+          for (auto m = offsets[i]; m < offsets[i + 1]; ++m) {
+            const auto& contribution = contributions[members[m]];
+            sum[0] += contribution[0];
+            sum[1] += contribution[1];
+            sum[2] += contribution[2];
+          }
+          (*normals)[i] = Normalized(sum);
+        }
+      });
 }
 
-template <typename MapperT>
-std::uint32_t WritePositions(std::ostream& os, MapperT&& mapper,
-                             const std::string& newline) {
-  return WriteMappedLines<IsPosition>(os, PositionPrefix(),
-                                      std::forward<MapperT>(mapper),
-                                      [](const auto&) {},  // No validation.
-                                      newline);
+}  // namespace normals
+
+namespace read {
+
+// A whitespace separated token, held in a fixed buffer unless it is very
+// long so that extracting tokens does not allocate. The text is always
+// null-terminated.
+class Token {
+ public:
+  Token() noexcept { fixed_[0] = '\0'; }
+
+  const char* data() const noexcept {
+    return long_.empty() ? fixed_ : long_.c_str();
+  }
+  const char* begin() const noexcept { return data(); }
+  const char* end() const noexcept { return data() + size_; }
+  std::size_t size() const noexcept { return size_; }
+  char back() const noexcept { return data()[size_ - 1]; }
+  std::string str() const { return std::string(begin(), end()); }
+
+  void push_back(const char c) {
+    if (long_.empty() && size_ + 1 < kFixedSize) {
+      fixed_[size_] = c;
+      fixed_[size_ + 1] = '\0';
+    } else {
+      if (long_.empty()) {
+        long_.assign(fixed_, size_);
+      }
+      long_.push_back(c);
+    }
+    ++size_;
+  }
+
+ private:
+  static constexpr auto kFixedSize = std::size_t{64};
+
+  char fixed_[kFixedSize];
+  std::string long_;
+  std::size_t size_ = 0;
+};
+
+inline std::istream& operator>>(std::istream& is, Token& token) {
+  const std::istream::sentry sentry(is);  // Skips leading whitespace.
+  if (!sentry) {
+    return is;
+  }
+  auto* const buf = is.rdbuf();
+  auto c = buf->sgetc();
+  for (; c != std::istream::traits_type::eof() &&
+         std::isspace(static_cast<unsigned char>(c)) == 0;
+       c = buf->snextc()) {
+    token.push_back(static_cast<char>(c));
+  }
+  if (c == std::istream::traits_type::eof()) {
+    is.setstate(std::ios_base::eofbit);
+  }
+  if (token.size() == 0) {
+    is.setstate(std::ios_base::failbit);
+  }
+  return is;
 }
 
-template <typename MapperT>
-std::uint32_t WriteObjTexCoords(std::ostream& os, MapperT&& mapper,
-                                const std::string& newline, FuncTag) {
-  return WriteMappedLines<IsObjTexCoord>(
-      os, ObjTexCoordPrefix(), std::forward<MapperT>(mapper),
-      [](const auto& tex_coord) { ValidateObjTexCoord(tex_coord); }, newline);
+#if defined(THINKS_OBJ_IO_HAS_STRTOD_L)
+#if defined(_WIN32)
+using LocaleHandle = _locale_t;
+#else
+using LocaleHandle = locale_t;
+#endif
+
+// The "C" locale, created on first use and kept for the lifetime of the
+// process.
+inline LocaleHandle CLocale() {
+#if defined(_WIN32)
+  static const auto locale = _create_locale(LC_NUMERIC, "C");
+#else
+  static const auto locale =
+      newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+#endif
+  return locale;
+}
+#endif  // THINKS_OBJ_IO_HAS_STRTOD_L
+
+inline float StringToReal(const char* const str, char** const end, float) {
+#if defined(_WIN32)
+  return _strtof_l(str, end, CLocale());
+#elif defined(THINKS_OBJ_IO_HAS_STRTOD_L)
+  return strtof_l(str, end, CLocale());
+#else
+  return std::strtof(str, end);
+#endif
 }
 
-// Dummy.
-template <typename MapperT>
-std::uint32_t WriteObjTexCoords(std::ostream&, MapperT&&, const std::string&,
-                                NoOpFuncTag) {
-  return 0;
+inline double StringToReal(const char* const str, char** const end, double) {
+#if defined(_WIN32)
+  return _strtod_l(str, end, CLocale());
+#elif defined(THINKS_OBJ_IO_HAS_STRTOD_L)
+  return strtod_l(str, end, CLocale());
+#else
+  return std::strtod(str, end);
+#endif
 }
 
-template <typename MapperT>
-std::uint32_t WriteNormals(std::ostream& os, MapperT&& mapper,
-                           const std::string& newline, FuncTag) {
-  return WriteMappedLines<IsNormal>(os, NormalPrefix(),
-                                    std::forward<MapperT>(mapper),
-                                    [](const auto&) {},  // No validation.
-                                    newline);
+inline long double StringToReal(const char* const str, char** const end,
+                                long double) {
+#if defined(_WIN32)
+  return _strtold_l(str, end, CLocale());
+#elif defined(THINKS_OBJ_IO_HAS_STRTOD_L)
+  return strtold_l(str, end, CLocale());
+#else
+  return std::strtold(str, end);
+#endif
 }
 
-// Dummy.
-template <typename MapperT>
-std::uint32_t WriteNormals(std::ostream&, MapperT&&, const std::string&,
-                           NoOpFuncTag) {
-  return 0;
+// Accepts the characters of a real value one at a time, the same characters
+// as std::num_get consumes: a sign, digits, a decimal point and an exponent.
+// Shared by the stream and the in-memory parsers, so that both accept the
+// same values.
+class RealText {
+ public:
+  bool Accept(const char c) noexcept {
+    if (c >= '0' && c <= '9') {
+      found_mantissa_ = true;
+    } else if (c == '.' && !found_point_ && !found_exponent_) {
+      found_point_ = true;
+    } else if ((c == 'e' || c == 'E') && found_mantissa_ && !found_exponent_) {
+      found_exponent_ = true;
+    } else if (!((c == '+' || c == '-') &&
+                 (previous_ == '\0' || previous_ == 'e' ||
+                  previous_ == 'E'))) {
+      return false;
+    }
+    previous_ = c;
+    return true;
+  }
+
+ private:
+  bool found_mantissa_ = false;
+  bool found_point_ = false;
+  bool found_exponent_ = false;
+  char previous_ = '\0';
+};
+
+// Converts [first, last), text accepted by RealText. The character at
+// |last| must end the conversion, e.g. whitespace or a null. Returns false
+// if the text is not a complete real value, or if the value is out of
+// range for T, in which case |*value| is clamped.
+template <typename T>
+bool ConvertReal(const char* const first, const char* const last,
+                 T* const value) {
+  char* end = nullptr;
+  errno = 0;
+  const auto parsed = StringToReal(first, &end, T{});
+  if (first == last || end != last) {
+    *value = T{0};
+    return false;
+  }
+  if (errno == ERANGE && std::isinf(parsed)) {
+    *value = parsed > 0 ? std::numeric_limits<T>::max()
+                        : std::numeric_limits<T>::lowest();
+    return false;
+  }
+  *value = parsed;
+  return true;
 }
 
-template <typename MapperT>
-std::uint32_t WriteFaces(std::ostream& os, MapperT&& mapper,
-                         const std::string& newline) {
-  return WriteMappedLines<IsFace>(
-      os, FacePrefix(), std::forward<MapperT>(mapper),
-      [](const auto& face) {
-        ValidateFace(face, typename FaceTraits<decltype(face)>::FaceCategory{});
-      },
-      newline);
+// Extracts a real value, consuming the same characters as std::num_get.
+// Used instead of operator>>, since std::num_get may allocate a temporary
+// string for every value.
+template <typename T>
+std::istream& ExtractReal(std::istream& is, T* const value) {
+  const std::istream::sentry sentry(is);  // Skips leading whitespace.
+  if (!sentry) {
+    return is;
+  }
+
+  auto text = Token{};
+  auto real_text = RealText{};
+  auto* const buf = is.rdbuf();
+  auto c = buf->sgetc();
+  for (; c != std::istream::traits_type::eof() &&
+         real_text.Accept(static_cast<char>(c));
+       c = buf->snextc()) {
+    text.push_back(static_cast<char>(c));
+  }
+  if (c == std::istream::traits_type::eof()) {
+    is.setstate(std::ios_base::eofbit);
+  }
+  if (!ConvertReal(text.begin(), text.end(), value)) {
+    is.setstate(std::ios_base::failbit);
+  }
+  return is;
 }
 
-}  // namespace write
-}  // namespace obj_io_internal
+// First error on a line. Parse functions record it and return false instead
+// of throwing, so that the parse loop needs no exception handling per line.
+// |token_end| is the offset in the line just past the offending token, or
+// zero if no single token is at fault.
+struct LineError {
+  bool failed() const noexcept { return kind != ObjReadErrorKind::kNone; }
 
-struct ObjReadResult {
-  std::uint32_t position_count;
-  std::uint32_t face_count;
-  std::uint32_t tex_coord_count;
-  std::uint32_t normal_count;
+  ObjReadErrorKind kind = ObjReadErrorKind::kNone;
+  std::string message;
+  std::size_t token_end = 0;
 };
 
-template <typename AddPositionFuncT, typename AddFaceFuncT,
-          typename AddObjTexCoordFuncT = std::nullptr_t,
-          typename AddNormalFuncT = std::nullptr_t>
-ObjReadResult ReadObj(std::istream& is, 
-                      AddPositionFuncT&& add_position,
-                      AddFaceFuncT&& add_face,
-                      AddObjTexCoordFuncT&& add_tex_coord = nullptr,
-                      AddNormalFuncT&& add_normal = nullptr) {
-  ObjReadResult result = {};
-  obj_io_internal::read::ParseLines(
-      is, std::forward<AddPositionFuncT>(add_position),
-      std::forward<AddFaceFuncT>(add_face),
-      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
-      std::forward<AddNormalFuncT>(add_normal), &result.position_count,
-      &result.face_count, &result.tex_coord_count, &result.normal_count);
-  return result;
+// Records an error, for use as "return Fail(...);".
+inline bool Fail(LineError* const error, const ObjReadErrorKind kind,
+                 const std::string& message, const std::size_t token_end = 0) {
+  error->kind = kind;
+  error->message = message;
+  error->token_end = token_end;
+  return false;
 }
 
-struct ObjWriteResult {
-  std::uint32_t position_count;
-  std::uint32_t face_count;
-  std::uint32_t tex_coord_count;
-  std::uint32_t normal_count;
-};
+// Offset of the next character in |is|, also after a failed extraction.
+inline std::size_t StreamOffset(std::istream* const is) {
+  const auto pos =
+      is->rdbuf()->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+  return pos == std::streampos(-1)
+             ? 0
+             : static_cast<std::size_t>(static_cast<std::streamoff>(pos));
+}
 
-template <typename PositionMapperT, typename FaceMapperT,
-          typename ObjTexCoordMapperT = std::nullptr_t,
-          typename NormalMapperT = std::nullptr_t>
-ObjWriteResult WriteObj(std::ostream& os, 
-                        PositionMapperT&& position_mapper,
-                        FaceMapperT&& face_mapper,
-                        ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
-                        NormalMapperT&& normal_mapper = nullptr,
-                        const std::string& newline = "\n") {
-  ObjWriteResult result = {};
-  obj_io_internal::write::WriteHeader(os, newline);
-  result.position_count += obj_io_internal::write::WritePositions(
-      os, std::forward<PositionMapperT>(position_mapper), newline);
-  result.tex_coord_count += obj_io_internal::write::WriteObjTexCoords(
-      os, std::forward<ObjTexCoordMapperT>(tex_coord_mapper), newline,
-      typename obj_io_internal::FuncTraits<ObjTexCoordMapperT>::FuncCategory{});
-  result.normal_count += obj_io_internal::write::WriteNormals(
-      os, std::forward<NormalMapperT>(normal_mapper), newline,
-      typename obj_io_internal::FuncTraits<NormalMapperT>::FuncCategory{});
-  result.face_count += obj_io_internal::write::WriteFaces(
-      os, std::forward<FaceMapperT>(face_mapper), newline);
-  return result;
+template <typename T>
+std::istream& ExtractValue(std::istream& is, T* const value, std::false_type) {
+  return is >> *value;
+}
+
+template <typename T>
+std::istream& ExtractValue(std::istream& is, T* const value, std::true_type) {
+  return ExtractReal(is, value);
+}
+
+// Returns false at the end of the line, and on errors, which are recorded
+// in |error|.
+template <typename T>
+bool ParseValue(std::istream* const is, T* const value,
+                LineError* const error) {
+  if (ExtractValue(*is, value, std::is_floating_point<T>{}) || !is->eof()) {
+    if (is->fail()) {
+      is->clear();  // Clear status bits.
+      auto dummy = std::string{};
+      *is >> dummy;
+      auto oss = std::ostringstream{};
+      oss << "failed parsing '" << dummy << "'";
+      return Fail(error, ObjReadErrorKind::kInvalidValue, oss.str(),
+                  StreamOffset(is));
+    }
+    return true;
+  }
+  return false;
 }
 
+template <typename IntT>
+bool ToZeroBasedIndex(const std::int64_t value, IntT* const index,
+                      LineError* const error) {
+  // Check for underflow.
+  if (!(value > 0)) {
+    return Fail(error, ObjReadErrorKind::kIndexRange,
+                "parsed index must be greater than zero");
+  }
+
+  // Check for overflow, the index type must hold the one-based value.
+  const auto max_value =
+      static_cast<std::uint64_t>(std::numeric_limits<IntT>::max());
+  if (static_cast<std::uint64_t>(value) > max_value) {
+    auto oss = std::ostringstream{};
+    oss << "parsed index " << value << " does not fit index type (max "
+        << max_value << ")";
+    return Fail(error, ObjReadErrorKind::kIndexRange, oss.str());
+  }
+
+  // Convert to zero-based index.
+  *index = static_cast<IntT>(value - 1);
+  return true;
+}
+
+template <typename IntT>
+IntT ToZeroBasedIndex(const std::int64_t value) {
+  auto index = IntT{0};
+  auto error = LineError{};
+  if (!ToZeroBasedIndex(value, &index, &error)) {
+    throw std::runtime_error(error.message);
+  }
+  return index;
+}
+
+// Parses the leading integer in [first, last). Returns a pointer past the
+// integer, or null if there is none or it does not fit 64 bits.
+inline const char* ParseInteger(const char* const first,
+                                const char* const last,
+                                std::int64_t* const value) noexcept {
+  auto p = first;
+  const auto negative = p != last && *p == '-';
+  if (p != last && (*p == '+' || *p == '-')) {
+    ++p;
+  }
+  constexpr auto kMaxValue =
+      static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+  const auto* const digits = p;
+  auto magnitude = std::uint64_t{0};
+  for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+    const auto digit = static_cast<std::uint64_t>(*p - '0');
+    if (magnitude > (kMaxValue - digit) / 10) {
+      return nullptr;
+    }
+    magnitude = magnitude * 10 + digit;
+  }
+  if (p == digits) {
+    return nullptr;
+  }
+  const auto signed_value = static_cast<std::int64_t>(magnitude);
+  *value = negative ? -signed_value : signed_value;
+  return p;
+}
+
+// Parses the leading integer in [first, last), an index group field.
+// Characters after the integer are ignored.
+inline bool ParseIndexField(const char* const first, const char* const last,
+                            std::int64_t* const value, LineError* const error) {
+  if (ParseInteger(first, last, value) == nullptr) {
+    auto oss = std::ostringstream{};
+    oss << "failed parsing '" << std::string(first, last) << "'";
+    return Fail(error, ObjReadErrorKind::kInvalidValue, oss.str());
+  }
+  return true;
+}
+
+template <typename IntT>
+bool ParseIndexField(const char* const first, const char* const last,
+                     ObjIndex<IntT>* const index, LineError* const error) {
+  auto value = std::int64_t{0};
+  return ParseIndexField(first, last, &value, error) &&
+         ToZeroBasedIndex(value, &index->value, error);
+}
+
+template <typename IntT>
+bool ParseIndexGroup(const Token& token,
+                     ObjIndexGroup<IntT>* const index_group,
+                     LineError* const error) {
+  // Split into at most three fields on the separator, without copying.
+  constexpr auto kMaxFieldCount = std::size_t{3};
+  const char* fields[kMaxFieldCount + 1] = {token.begin()};
+  auto field_count = std::size_t{1};
+  for (auto p = token.begin(); p != token.end(); ++p) {
+    if (*p == *IndexGroupSeparator()) {
+      if (field_count == kMaxFieldCount) {
+        auto oss = std::stringstream{};
+        oss << "index group can have at most 3 tokens ('" << token.str()
+            << "')";
+        return Fail(error, ObjReadErrorKind::kIndexGroup, oss.str());
+      }
+      fields[field_count++] = p + 1;
+    }
+  }
+  fields[field_count] = token.end() + 1;
+  const auto field_end = [&fields](const std::size_t i) {
+    return fields[i + 1] - 1;
+  };
+
+  // ObjPosition index.
+  if (fields[0] == field_end(0)) {
+    auto oss = std::stringstream{};
+    oss << "empty position index ('" << token.str() << "')";
+    return Fail(error, ObjReadErrorKind::kIndexGroup, oss.str());
+  }
+  if (!ParseIndexField(fields[0], field_end(0), &index_group->position_index,
+                       error)) {
+    return false;
+  }
+
+  // Texture coordinate index, may be empty.
+  if (field_count > 1 && fields[1] != field_end(1)) {
+    if (!ParseIndexField(fields[1], field_end(1),
+                         &index_group->tex_coord_index.first, error)) {
+      return false;
+    }
+    index_group->tex_coord_index.second = true;
+  }
+
+  // ObjNormal index.
+  if (field_count > 2) {
+    if (fields[2] == field_end(2)) {
+      auto oss = std::stringstream{};
+      oss << "empty normal index ('" << token.str() << "')";
+      return Fail(error, ObjReadErrorKind::kIndexGroup, oss.str());
+    }
+    if (!ParseIndexField(fields[2], field_end(2),
+                         &index_group->normal_index.first, error)) {
+      return false;
+    }
+    index_group->normal_index.second = true;
+  }
+  return true;
+}
+
+template <typename IntT>
+bool ParseValue(std::istream* const is,
+                ObjIndexGroup<IntT>* const index_group,
+                LineError* const error) {
+  // Read index group as the token leading up to the
+  // following whitespace/newline.
+  auto token = Token{};
+  if (!ParseValue(is, &token, error)) {
+    return false;
+  }
+  if (!ParseIndexGroup(token, index_group, error)) {
+    error->token_end = StreamOffset(is);
+    return false;
+  }
+  return true;
+}
+
+template <typename IntT>
+bool ParseValue(std::istream* const is, ObjIndex<IntT>* const index,
+                LineError* const error) {
+  auto token = Token{};
+  if (!ParseValue(is, &token, error)) {
+    return false;
+  }
+
+  // A plain index only holds the position index, texture coordinate and
+  // normal indices of an index group ("1/2/3") are validated and dropped.
+  // Indices are parsed as wide signed integers, so that out of range values
+  // are detected instead of wrapping.
+  auto parsed = false;
+  if (std::find(token.begin(), token.end(), *IndexGroupSeparator()) !=
+      token.end()) {
+    auto index_group = ObjIndexGroup<IntT>{};
+    parsed = ParseIndexGroup(token, &index_group, error);
+    *index = index_group.position_index;
+  } else {
+    auto value = std::int64_t{0};
+    if (ParseInteger(token.begin(), token.end(), &value) != token.end()) {
+      auto oss = std::ostringstream{};
+      oss << "failed parsing '" << token.str() << "'";
+      Fail(error, ObjReadErrorKind::kInvalidValue, oss.str());
+    } else {
+      parsed = ToZeroBasedIndex(value, &index->value, error);
+    }
+  }
+  if (!parsed) {
+    error->token_end = StreamOffset(is);
+  }
+  return parsed;
+}
+
+// Values beyond the size of the array are parsed but dropped, up to
+// |max_count| values in total. Returns the number of values parsed, errors
+// are recorded in |error|.
+template <typename T, std::size_t N>
+std::uint32_t ParseValues(std::istringstream* const iss,
+                          std::array<T, N>* const values,
+                          LineError* const error,
+                          const std::size_t max_count = N) {
+  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
+  using ValueType = typename ContainerType::value_type;
+
+  constexpr auto kValueCount = std::tuple_size<ContainerType>::value;
+  static_assert(kValueCount > 0, "empty array");
+
+  auto parse_count = std::uint32_t{0};
+  auto value = ValueType{};
+  while (ParseValue(iss, &value, error)) {
+    if (parse_count >= max_count) {
+      auto oss = std::ostringstream{};
+      oss << "expected to parse at most " << max_count << " values";
+      Fail(error, ObjReadErrorKind::kValueCount, oss.str(), StreamOffset(iss));
+      break;
+    }
+    if (parse_count < kValueCount) {
+      (*values)[parse_count] = value;
+    }
+    ++parse_count;
+  }
+
+  return parse_count;
+}
+
+template <typename T>
+std::uint32_t ParseValues(std::istringstream* const iss,
+                          std::vector<T>* const values,
+                          LineError* const error) {
+  using ContainerType = typename std::remove_pointer<decltype(values)>::type;
+  using ValueType = typename ContainerType::value_type;
+
+  auto value = ValueType{};
+  while (ParseValue(iss, &value, error)) {
+    values->push_back(value);
+  }
+
+  return static_cast<std::uint32_t>(values->size());
+}
+
+// State kept across the lines of a single read. Buffers are reused so that
+// parsing does not allocate per face once they have grown to fit the largest
+// face in the input.
+template <typename IndexT>
+struct ReadState {
+  explicit ReadState(const ObjReadOptions& read_options)
+      : options(read_options), welder(read_options.weld_epsilon) {}
+
+  bool GeneratesNormals() const noexcept {
+    return options.generate_normals != ObjNormalGeneration::kNone;
+  }
+
+  // Faces are held back until the end of the input when generating normals,
+  // unless the input turns out to have normals.
+  bool DefersFaces() const noexcept {
+    return GeneratesNormals() && !has_normals;
+  }
+
+  // Prepares for reading another input with the same options, keeping the
+  // buffers.
+  void Reset() {
+    error = LineError{};
+    face_indices.clear();
+    positions.clear();
+    welder.Clear();
+    weld_map.clear();
+    smoothing_group = 0;
+    has_normals = false;
+    deferred_indices.clear();
+    deferred_offsets.assign(1, 0);
+    deferred_groups.clear();
+  }
+
+  ObjReadOptions options;
+  LineError error;
+  std::istringstream line_stream;
+  std::vector<IndexT> face_indices;
+  ObjPolygonFace<IndexT> polygon_face;
+
+  // Only for ear clipping and normal generation.
+  std::vector<std::array<double, 3>> positions;
+  triangulate::EarClipScratch ear_clip;
+  weld::PositionWelder welder;
+  std::vector<std::uint32_t> weld_map;
+
+  // Faces are held back until all normals are known when generating
+  // normals, stored as flat indices with offsets per face.
+  std::uint32_t smoothing_group = 0;
+  bool has_normals = false;
+  std::vector<IndexT> deferred_indices;
+  std::vector<std::size_t> deferred_offsets = {0};
+  std::vector<std::uint32_t> deferred_groups;
+};
+
+template <typename PositionT>
+std::array<double, 3> ToDouble3(const PositionT& position) noexcept {
+  return {{static_cast<double>(position.values[0]),
+           static_cast<double>(position.values[1]),
+           static_cast<double>(position.values[2])}};
+}
+
+// Returns true if |position| should be passed on to the position callback,
+// i.e. if welding is disabled or |position| was not merged.
+template <typename PositionT, typename IndexT>
+bool WeldPosition(const PositionT& position, ReadState<IndexT>* const state) {
+  if (!state->options.weld_positions) {
+    return true;
+  }
+  const auto welded = state->welder.Add(ToDouble3(position));
+  state->weld_map.push_back(welded.first);
+  return welded.second;
+}
+
+template <typename ContainerT, typename IndexT>
+bool WeldFaceIndices(ContainerT* const values, ReadState<IndexT>* const state) {
+  if (!state->options.weld_positions) {
+    return true;
+  }
+  for (auto& index : *values) {
+    const auto position_index =
+        static_cast<std::size_t>(PositionIndexValue(index));
+    if (!(position_index < state->weld_map.size())) {
+      auto oss = std::ostringstream{};
+      oss << "welding requires positions before faces (position index "
+          << position_index + 1 << " not yet read)";
+      return Fail(&state->error, ObjReadErrorKind::kIndexRange, oss.str());
+    }
+    SetPositionIndexValue(
+        static_cast<decltype(PositionIndexValue(index))>(
+            state->weld_map[position_index]),
+        &index);
+  }
+  return true;
+}
+
+template <typename PositionT, typename IndexT>
+void StorePosition(const PositionT& position, ReadState<IndexT>* const state) {
+  if (state->options.triangulation == ObjTriangulation::kEarClip ||
+      state->DefersFaces()) {
+    state->positions.push_back(ToDouble3(position));
+  }
+}
+
+template <typename AddPositionFuncT, typename StateT>
+bool ParsePosition(std::istringstream* const iss, AddPositionFuncT&& add_position,
+                   StateT* const state, std::uint32_t* const count) {
+  using ParseType = typename std::decay<AddPositionFuncT>::type::ParseType;
+  static_assert(IsPosition<ParseType>::value,
+                "parse type must be a ObjPosition type");
+
+  auto position = ParseType{};
+  const auto parse_count = ParseValues(
+      iss, &position.values, &state->error,
+      state->options.drop_extra_values ? 4 : position.values.size());
+  if (state->error.failed()) {
+    return false;
+  }
+
+  if (parse_count < 3) {
+    auto oss = std::ostringstream{};
+    oss << "positions must have 3 or 4 values (found " << parse_count << ")";
+    return Fail(&state->error, ObjReadErrorKind::kValueCount, oss.str());
+  }
+
+  // Fourth position value (if any) defaults to 1.
+  using ArrayType = decltype(position.values);
+  if (std::tuple_size<ArrayType>::value == 4 && parse_count == 3) {
+    position.values[3] = typename ArrayType::value_type{1};
+  }
+
+  if (!WeldPosition(position, state)) {
+    return true;  // Merged into a previous position.
+  }
+
+  StorePosition(position, state);
+  add_position.func(position);
+  ++(*count);
+  return true;
+}
+
+// Passes |face| on to the face callback, or holds it back if normals are
+// generated.
+template <typename AddFaceFuncT, typename FaceT, typename StateT>
+void AddFace(AddFaceFuncT&& add_face, const FaceT& face, StateT* const state,
+             std::uint32_t* const count) {
+  if (state->DefersFaces()) {
+    state->deferred_indices.insert(state->deferred_indices.end(),
+                                   std::begin(face.values),
+                                   std::end(face.values));
+    state->deferred_offsets.push_back(state->deferred_indices.size());
+    state->deferred_groups.push_back(state->smoothing_group);
+    return;
+  }
+  add_face.func(face);
+  ++(*count);
+}
+
+// Passes a face that was parsed ahead of time, e.g. on another thread, on
+// to |add_face| as the parser would have. Lazy add functions have no
+// overload, they cannot take parsed faces.
+template <typename AddFaceFuncT, typename FaceT>
+void DeliverFace(AddFaceFuncT&& add_face, const FaceT& face, FaceAddTag) {
+  add_face.func(face);
+}
+
+template <typename AddFaceFuncT, typename FaceT>
+void DeliverFace(AddFaceFuncT&& add_face, const FaceT& face, CsrAddTag) {
+  add_face.func.Append(face.values.data(),
+                       face.values.data() + face.values.size());
+}
+
+template <typename StateT>
+bool FailFaceSize(const std::size_t size, StateT* const state) {
+  auto oss = std::ostringstream{};
+  oss << "faces must have at least 3 indices (found " << size << ")";
+  return Fail(&state->error, ObjReadErrorKind::kValueCount, oss.str());
+}
+
+template <typename AddFaceFuncT, typename StateT>
+bool ParseTriangulatedFace(std::istringstream* const iss,
+                           AddFaceFuncT&& add_face, StateT* const state,
+                           std::uint32_t* const count, std::true_type) {
+  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
+
+  auto& indices = state->face_indices;
+  indices.clear();
+  ParseValues(iss, &indices, &state->error);
+  if (state->error.failed()) {
+    return false;
+  }
+  if (!(indices.size() >= 3)) {
+    return FailFaceSize(indices.size(), state);
+  }
+  if (!WeldFaceIndices(&indices, state)) {
+    return false;
+  }
+
+  const auto emit = [&add_face, &indices, state, count](
+                        const std::size_t a, const std::size_t b,
+                        const std::size_t c) {
+    AddFace(add_face, ParseType(indices[a], indices[b], indices[c]), state,
+            count);
+  };
+
+  if (indices.size() == 3 ||
+      state->options.triangulation == ObjTriangulation::kFan) {
+    triangulate::Fan(indices.size(), emit);
+    return true;
+  }
+
+  auto& positions = state->ear_clip.positions;
+  positions.clear();
+  for (const auto& index : indices) {
+    const auto position_index =
+        static_cast<std::size_t>(PositionIndexValue(index));
+    if (!(position_index < state->positions.size())) {
+      auto oss = std::ostringstream{};
+      oss << "ear clipping requires positions before faces (position index "
+          << position_index + 1 << " not yet read)";
+      return Fail(&state->error, ObjReadErrorKind::kIndexRange, oss.str());
+    }
+    positions.push_back(state->positions[position_index]);
+  }
+  triangulate::EarClip(&state->ear_clip, emit);
+  return true;
+}
+
+template <typename AddFaceFuncT, typename StateT>
+bool ParseTriangulatedFace(std::istringstream* const, AddFaceFuncT&&,
+                           StateT* const state, std::uint32_t* const,
+                           std::false_type) {
+  return Fail(&state->error, ObjReadErrorKind::kInvalidOptions,
+              "triangulation requires triangle faces");
+}
+
+// Returns a face to parse into. Polygon faces reuse the indices of the
+// previous face, so that parsing does not allocate per face.
+template <typename FaceT, typename StateT>
+FaceT ParseFaceBuffer(StateT* const, StaticFaceTag) {
+  return FaceT{};
+}
+
+template <typename FaceT, typename StateT>
+FaceT& ParseFaceBuffer(StateT* const state, DynamicFaceTag) {
+  state->polygon_face.values.clear();
+  return state->polygon_face;
+}
+
+template <typename AddFaceFuncT, typename StateT>
+bool ParseUntriangulatedFace(std::istringstream* const iss,
+                             AddFaceFuncT&& add_face, StateT* const state,
+                             std::uint32_t* const count, FaceAddTag) {
+  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
+
+  auto&& face = ParseFaceBuffer<ParseType>(
+      state, typename FaceTraits<ParseType>::FaceCategory{});
+  const auto parse_count = ParseValues(iss, &face.values, &state->error);
+  if (state->error.failed()) {
+    return false;
+  }
+
+  // Works for both std::array and std::vector.
+  // This is never an issue for polygons.
+  if (parse_count != face.values.size()) {
+    auto oss = std::ostringstream{};
+    oss << "expected " << face.values.size() << " face indices (found "
+        << parse_count << ")";
+    return Fail(&state->error, ObjReadErrorKind::kValueCount, oss.str());
+  }
+
+  // Only polygons can have too few indices, see ValidateFace.
+  if (!(face.values.size() >= 3)) {
+    return FailFaceSize(face.values.size(), state);
+  }
+  if (!WeldFaceIndices(&face.values, state)) {
+    return false;
+  }
+  AddFace(add_face, face, state, count);
+  return true;
+}
+
+// Parses the face indices into a reused buffer and appends them to the
+// compressed sparse row arrays, so that no face object is allocated.
+template <typename AddFaceFuncT, typename StateT>
+bool ParseUntriangulatedFace(std::istringstream* const iss,
+                             AddFaceFuncT&& add_face, StateT* const state,
+                             std::uint32_t* const count, CsrAddTag) {
+  if (state->DefersFaces()) {
+    // Faces are held back and delivered as face objects.
+    return ParseUntriangulatedFace(iss, std::forward<AddFaceFuncT>(add_face),
+                                   state, count, FaceAddTag{});
+  }
+
+  auto& indices = state->face_indices;
+  indices.clear();
+  ParseValues(iss, &indices, &state->error);
+  if (state->error.failed()) {
+    return false;
+  }
+  if (!(indices.size() >= 3)) {
+    return FailFaceSize(indices.size(), state);
+  }
+  if (!WeldFaceIndices(&indices, state)) {
+    return false;
+  }
+  add_face.func.Append(indices.data(), indices.data() + indices.size());
+  ++(*count);
+  return true;
+}
+
+template <typename AddFaceFuncT, typename StateT, typename AddTagT>
+bool ParseFace(std::istringstream* const iss, 
+               AddFaceFuncT&& add_face,
+               StateT* const state,
+               std::uint32_t* const count,
+               AddTagT) {
+  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
+
+  if (state->options.triangulation != ObjTriangulation::kNone) {
+    return ParseTriangulatedFace(iss, std::forward<AddFaceFuncT>(add_face),
+                                 state, count, IsTriangleFace<ParseType>{});
+  }
+
+  return ParseUntriangulatedFace(iss, std::forward<AddFaceFuncT>(add_face),
+                                 state, count, AddTagT{});
+}
+
+// Keeps the rest of the line as it is.
+template <typename AddFaceFuncT, typename StateT>
+bool ParseFace(std::istringstream* const iss, AddFaceFuncT&& add_face,
+               StateT* const, std::uint32_t* const count, LazyAddTag) {
+  const auto text = std::string(std::istreambuf_iterator<char>(*iss),
+                                std::istreambuf_iterator<char>());
+  add_face.func.Append(text.data(), text.data() + text.size());
+  ++(*count);
+  return true;
+}
+
+// Returns false on errors, which are recorded in the state.
+template <typename AddFaceFuncT, typename StateT>
+bool ParseFace(std::istringstream* const iss, 
+               AddFaceFuncT&& add_face,
+               StateT* const state,
+               std::uint32_t* const count) {
+  using ParseType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  static_assert(IsFace<ParseType>::value, "parse type must be a Face type");
+
+  return ParseFace(iss, std::forward<AddFaceFuncT>(add_face), state, count,
+            typename AddFaceTraits<AddFaceFuncT>::AddCategory{});
+}
+
+// Parses a smoothing group token in [first, last), an unsigned integer or
+// "off" (group zero). Shared by the stream and the in-memory parsers.
+inline bool ParseSmoothingGroupToken(const char* const first,
+                                     const char* const last,
+                                     std::uint32_t* const group) noexcept {
+  if (last - first == 3 && std::equal(first, last, "off")) {
+    *group = 0;
+    return true;
+  }
+
+  // No sign, the group must not wrap.
+  auto value = std::int64_t{0};
+  if (first == last || !(*first >= '0' && *first <= '9') ||
+      ParseInteger(first, last, &value) != last ||
+      value > std::int64_t{std::numeric_limits<std::uint32_t>::max()}) {
+    return false;
+  }
+  *group = static_cast<std::uint32_t>(value);
+  return true;
+}
+
+template <typename StateT>
+bool ParseSmoothingGroup(std::istringstream* const iss, StateT* const state) {
+  auto token = Token{};
+  if (!(*iss >> token)) {
+    return Fail(&state->error, ObjReadErrorKind::kValueCount,
+                "smoothing group must have a value");
+  }
+
+  auto group = std::uint32_t{0};
+  if (!ParseSmoothingGroupToken(token.begin(), token.end(), &group)) {
+    auto oss = std::ostringstream{};
+    oss << "failed parsing smoothing group '" << token.str() << "'";
+    return Fail(&state->error, ObjReadErrorKind::kInvalidValue, oss.str(),
+                StreamOffset(iss));
+  }
+  state->smoothing_group = group;
+  return true;
+}
+
+template <typename AddObjTexCoordFuncT>
+bool ParseObjTexCoord(std::istringstream* const iss,
+                   AddObjTexCoordFuncT&& add_tex_coord, 
+                   const bool drop_extra_values,
+                   std::uint32_t* const count,
+                   LineError* const error,
+                   FuncTag) {
+  using ParseType = typename std::decay<AddObjTexCoordFuncT>::type::ParseType;
+  static_assert(IsObjTexCoord<ParseType>::value,
+                "parse type must be a ObjTexCoord type");
+
+  auto tex_coord = ParseType{};
+  const auto parse_count = ParseValues(
+      iss, &tex_coord.values, error,
+      drop_extra_values ? 3 : tex_coord.values.size());
+  if (error->failed()) {
+    return false;
+  }
+
+  if (parse_count < 2) {
+    auto oss = std::ostringstream{};
+    oss << "texture coordinates must have 2 or 3 values (found " << parse_count
+        << ")";
+    return Fail(error, ObjReadErrorKind::kValueCount, oss.str());
+  }
+
+  // Third texture coordinate value (if any) defaults to 1.
+  using ArrayType = decltype(tex_coord.values);
+  if (std::tuple_size<ArrayType>::value == 3 && parse_count == 2) {
+    tex_coord.values[2] = typename ArrayType::value_type{1};
+  }
+
+  auto message = std::string{};
+  if (!CheckObjTexCoord(tex_coord, &message)) {
+    return Fail(error, ObjReadErrorKind::kInvalidValue, message);
+  }
+
+  add_tex_coord.func(tex_coord);
+  ++(*count);
+  return true;
+}
+
+// Dummy.
+template <typename AddObjTexCoordFuncT>
+bool ParseObjTexCoord(std::istringstream* const, AddObjTexCoordFuncT&&,
+                   const bool, std::uint32_t* const, LineError* const,
+                   NoOpFuncTag) {
+  return true;
+}
+
+template <typename AddNormalFuncT>
+bool ParseNormal(std::istringstream* const iss, 
+                 AddNormalFuncT&& add_normal,
+                 std::uint32_t* const count, 
+                 LineError* const error,
+                 FuncTag) {
+  using ParseType = typename std::decay<AddNormalFuncT>::type::ParseType;
+  static_assert(IsNormal<ParseType>::value, "parse type must be a ObjNormal type");
+
+  auto normal = ParseType{};
+  const auto parse_count = ParseValues(iss, &normal.values, error);
+  if (error->failed()) {
+    return false;
+  }
+
+  if (parse_count < 3) {
+    auto oss = std::ostringstream{};
+    oss << "normals must have 3 values (found " << parse_count << ")";
+    return Fail(error, ObjReadErrorKind::kValueCount, oss.str());
+  }
+
+  add_normal.func(normal);
+  ++(*count);
+  return true;
+}
+
+// Dummy.
+template <typename AddNormalFuncT>
+bool ParseNormal(std::istringstream* const, AddNormalFuncT&&,
+                 std::uint32_t* const, LineError* const, NoOpFuncTag) {
+  return true;
+}
+
+// True if |line| holds a texture coordinate or normal without a callback,
+// which is then skipped without tokenizing the line. Lines with leading
+// whitespace are left to the regular path, which drops them as well.
+template <typename AddObjTexCoordFuncT, typename AddNormalFuncT>
+bool IsUnusedLine(const std::string& line) {
+  constexpr auto skip_tex_coords =
+      std::is_same<typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory,
+                   NoOpFuncTag>::value;
+  constexpr auto skip_normals =
+      std::is_same<typename FuncTraits<AddNormalFuncT>::FuncCategory,
+                   NoOpFuncTag>::value;
+  if (!(skip_tex_coords || skip_normals) || line.size() < 2 ||
+      line[0] != 'v' ||
+      (line.size() > 2 &&
+       std::isspace(static_cast<unsigned char>(line[2])) == 0)) {
+    return false;
+  }
+  return (skip_tex_coords && line[1] == 't') ||
+         (skip_normals && line[1] == 'n');
+}
+
+// Passes the text of a face line on to a lazy face add function without
+// tokenizing the line. Lines with leading whitespace are left to ParseFace.
+template <typename AddFaceFuncT>
+bool AddLazyFace(const std::string& line, AddFaceFuncT&& add_face,
+                 std::uint32_t* const count, LazyAddTag) {
+  if (line.empty() || line[0] != 'f' ||
+      (line.size() > 1 &&
+       std::isspace(static_cast<unsigned char>(line[1])) == 0)) {
+    return false;
+  }
+  add_face.func.Append(line.data() + 1, line.data() + line.size());
+  ++(*count);
+  return true;
+}
+
+template <typename AddFaceFuncT, typename AddTagT>
+bool AddLazyFace(const std::string&, AddFaceFuncT&&, std::uint32_t* const,
+                 AddTagT) {
+  return false;
+}
+
+template <typename FaceT, typename IndexT>
+FaceT MakeFace(const IndexT* const first, const IndexT* const last,
+               StaticFaceTag) {
+  auto face = FaceT{};
+  std::copy(first, last, std::begin(face.values));
+  return face;
+}
+
+template <typename FaceT, typename IndexT>
+FaceT MakeFace(const IndexT* const first, const IndexT* const last,
+               DynamicFaceTag) {
+  auto face = FaceT{};
+  face.values.assign(first, last);
+  return face;
+}
+
+// Delivers the faces held back during the read, preceded by generated
+// normals unless the file has its own normals.
+template <typename AddFaceFuncT, typename AddNormalFuncT, typename StateT>
+void AddDeferredFaces(AddFaceFuncT&& add_face, AddNormalFuncT&& add_normal,
+                      StateT* const state, std::uint32_t* const face_count,
+                      std::uint32_t* const normal_count, FuncTag) {
+  using FaceType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  using NormalType = typename std::decay<AddNormalFuncT>::type::ParseType;
+  using IndexType = FaceIndexType<FaceType>;
+  using IntT = decltype(PositionIndexValue(std::declval<IndexType>()));
+  using ValueType = typename decltype(NormalType{}.values)::value_type;
+
+  const auto& indices = state->deferred_indices;
+  const auto& offsets = state->deferred_offsets;
+  auto corner_normals = std::vector<std::uint32_t>{};
+  if (!state->has_normals) {
+    auto corner_positions = std::vector<std::uint32_t>(indices.size());
+    for (auto i = std::size_t{0}; i < indices.size(); ++i) {
+      corner_positions[i] =
+          static_cast<std::uint32_t>(PositionIndexValue(indices[i]));
+    }
+    auto normals = std::vector<std::array<double, 3>>{};
+    normals::Generate(
+        state->positions, corner_positions, offsets, state->deferred_groups,
+        state->options.generate_normals == ObjNormalGeneration::kAngleWeighted,
+        ThreadCount(state->options.thread_count), &normals, &corner_normals);
+
+    // The one-based index must fit, as for parsed indices.
+    const auto max_value =
+        static_cast<std::uint64_t>(std::numeric_limits<IntT>::max());
+    if (normals.size() > max_value) {
+      auto oss = std::ostringstream{};
+      oss << "generated normal count " << normals.size()
+          << " does not fit index type (max " << max_value << ")";
+      throw std::runtime_error(oss.str());
+    }
+
+    for (const auto& n : normals) {
+      auto normal = NormalType{};
+      for (auto k = std::size_t{0}; k < 3; ++k) {
+        normal.values[k] = static_cast<ValueType>(n[k]);
+      }
+      add_normal.func(normal);
+      ++(*normal_count);
+    }
+  }
+
+  for (auto f = std::size_t{0}; f + 1 < offsets.size(); ++f) {
+    auto face = MakeFace<FaceType>(
+        indices.data() + offsets[f], indices.data() + offsets[f + 1],
+        typename FaceTraits<FaceType>::FaceCategory{});
+    if (!state->has_normals) {
+      for (auto i = std::size_t{0}; i < face.values.size(); ++i) {
+        SetNormalIndexValue(static_cast<IntT>(corner_normals[offsets[f] + i]),
+                            &face.values[i]);
+      }
+    }
+    add_face.func(face);
+    ++(*face_count);
+  }
+}
+
+// Dummy, normal generation requires a normal callback.
+template <typename AddFaceFuncT, typename AddNormalFuncT, typename StateT>
+void AddDeferredFaces(AddFaceFuncT&&, AddNormalFuncT&&, StateT* const,
+                      std::uint32_t* const, std::uint32_t* const,
+                      NoOpFuncTag) {}
+
+// Called on the first normal line while generating normals: the input has
+// its own normals, so the faces held back so far are delivered as parsed and
+// later faces are passed on directly.
+template <typename AddFaceFuncT, typename AddNormalFuncT, typename StateT>
+void StopDeferringFaces(AddFaceFuncT&& add_face, AddNormalFuncT&& add_normal,
+                        StateT* const state, std::uint32_t* const face_count,
+                        std::uint32_t* const normal_count) {
+  state->has_normals = true;
+  AddDeferredFaces(std::forward<AddFaceFuncT>(add_face),
+                   std::forward<AddNormalFuncT>(add_normal), state,
+                   face_count, normal_count,
+                   typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+  state->deferred_indices.clear();
+  state->deferred_offsets.assign(1, 0);
+  state->deferred_groups.clear();
+}
+
+// Returns false on errors, which are recorded in the state.
+template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
+          typename AddNormalFuncT, typename AddFaceFuncT, typename StateT>
+bool ParseLine(const std::string& line, 
+               AddPositionFuncT&& add_position,
+               AddFaceFuncT&& add_face, 
+               AddObjTexCoordFuncT&& add_tex_coord,
+               AddNormalFuncT&& add_normal, 
+               StateT* const state,
+               std::uint32_t* const position_count,
+               std::uint32_t* const face_count,
+               std::uint32_t* const tex_coord_count,
+               std::uint32_t* const normal_count) {
+  if (IsUnusedLine<AddObjTexCoordFuncT, AddNormalFuncT>(line) ||
+      AddLazyFace(line, add_face, face_count,
+                  typename AddFaceTraits<AddFaceFuncT>::AddCategory{})) {
+    return true;
+  }
+
+  auto& iss = state->line_stream;
+  iss.clear();
+  iss.str(line);
+
+  // Prefix is first non-whitespace token.
+  auto prefix = std::string{};
+  iss >> prefix;
+
+  // Parse the rest of the line depending on prefix.
+  if (prefix.empty() || prefix == CommentPrefix()) {
+    return true;  // Ignore empty lines and comments.
+  } else if (prefix == PositionPrefix()) {
+    return ParsePosition(&iss, std::forward<AddPositionFuncT>(add_position),
+                         state, position_count);
+  } else if (prefix == FacePrefix()) {
+    return ParseFace(&iss, std::forward<AddFaceFuncT>(add_face), state,
+                     face_count);
+  } else if (prefix == ObjTexCoordPrefix()) {
+    return ParseObjTexCoord(
+        &iss, std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+        state->options.drop_extra_values, tex_coord_count, &state->error,
+        typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
+  } else if (prefix == NormalPrefix()) {
+    if (state->DefersFaces()) {
+      StopDeferringFaces(add_face, add_normal, state, face_count,
+                         normal_count);
+    }
+    state->has_normals = true;
+    return ParseNormal(&iss, std::forward<AddNormalFuncT>(add_normal),
+                       normal_count, &state->error,
+                       typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+  } else if (prefix == SmoothingGroupPrefix()) {
+    return ParseSmoothingGroup(&iss, state);
+  }
+
+  auto oss = std::ostringstream{};
+  oss << "unrecognized line prefix '" << prefix << "'";
+  return Fail(&state->error, ObjReadErrorKind::kUnrecognizedPrefix, oss.str(),
+              StreamOffset(&iss));
+}
+
+// Returns false if |options| do not fit the callbacks, with the reason
+// recorded in |error|.
+template <typename AddFaceFuncT, typename AddNormalFuncT>
+bool CheckReadOptions(const ObjReadOptions& options, LineError* const error) {
+  using FaceType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  constexpr auto kKind = ObjReadErrorKind::kInvalidOptions;
+
+  if (std::is_same<typename AddFaceTraits<AddFaceFuncT>::AddCategory,
+                   LazyAddTag>::value) {
+    if (options.weld_positions || options.weld_map != nullptr ||
+        options.generate_normals != ObjNormalGeneration::kNone) {
+      return Fail(error, kKind,
+                  "lazy faces do not support welding or normal generation");
+    }
+    if (options.triangulation != ObjTriangulation::kNone) {
+      return Fail(error, kKind, "lazy faces are triangulated when decoded");
+    }
+  }
+
+  if (options.generate_normals != ObjNormalGeneration::kNone) {
+    if (!IsIndexGroup<FaceIndexType<FaceType>>::value) {
+      return Fail(error, kKind,
+                  "normal generation requires index group faces");
+    }
+    if (std::is_same<typename FuncTraits<AddNormalFuncT>::FuncCategory,
+                     NoOpFuncTag>::value) {
+      return Fail(error, kKind,
+                  "normal generation requires a normal callback");
+    }
+  }
+  return true;
+}
+
+template <typename AddFaceFuncT, typename AddNormalFuncT>
+void ValidateReadOptions(const ObjReadOptions& options) {
+  auto error = LineError{};
+  if (!CheckReadOptions<AddFaceFuncT, AddNormalFuncT>(options, &error)) {
+    throw std::runtime_error(error.message);
+  }
+}
+
+// Hands the weld map of the positions parsed so far to the caller. Also
+// called when a read is cancelled.
+template <typename StateT>
+void DeliverWeldMap(StateT* const state) {
+  if (state->options.weld_map != nullptr) {
+    state->options.weld_map->swap(state->weld_map);
+  }
+}
+
+// Work done once all lines have been parsed.
+template <typename AddFaceFuncT, typename AddNormalFuncT, typename StateT>
+void FinishLines(AddFaceFuncT&& add_face, AddNormalFuncT&& add_normal,
+                 StateT* const state, std::uint32_t* const face_count,
+                 std::uint32_t* const normal_count) {
+  if (state->GeneratesNormals()) {
+    AddDeferredFaces(std::forward<AddFaceFuncT>(add_face),
+                     std::forward<AddNormalFuncT>(add_normal), state,
+                     face_count, normal_count,
+                     typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+  }
+
+  DeliverWeldMap(state);
+}
+
+// Splits blocks of input into lines, holding on to the incomplete line at
+// the end of a block until the next block arrives.
+class LineBuffer {
+ public:
+  // Calls |func(line)| for the complete lines in [data, data + size),
+  // together with the line left incomplete by the previous call.
+  template <typename FuncT>
+  void Feed(const char* const data, const std::size_t size, FuncT&& func) {
+    const auto* p = data;
+    const auto* const end = data + size;
+    for (;;) {
+      const auto* const newline = static_cast<const char*>(
+          std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+      if (newline == nullptr) {
+        break;
+      }
+      if (pending_.empty()) {
+        line_.assign(p, newline);
+      } else {
+        pending_.append(p, newline);
+        line_.swap(pending_);
+        pending_.clear();
+      }
+      func(line_);
+      p = newline + 1;
+    }
+    pending_.append(p, end);
+  }
+
+  // Calls |func(line)| for the final line, if it lacks a newline.
+  template <typename FuncT>
+  void Finish(FuncT&& func) {
+    if (!pending_.empty()) {
+      func(pending_);
+      pending_.clear();
+    }
+  }
+
+  std::size_t pending_size() const noexcept { return pending_.size(); }
+
+  std::size_t capacity() const noexcept {
+    return pending_.capacity() + line_.capacity();
+  }
+
+ private:
+  std::string pending_;
+  std::string line_;
+};
+
+enum class LineKind {
+  kBlank,
+  kComment,
+  kPosition,
+  kFace,
+  kTexCoord,
+  kNormal,
+  kSmoothingGroup,
+  kOther
+};
+
+// Kind of |line|, judged by its first token only.
+inline LineKind ClassifyLine(const std::string& line) {
+  const auto is_space = [](const char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  };
+  const auto first = std::find_if_not(line.begin(), line.end(), is_space);
+  const auto last = std::find_if(first, line.end(), is_space);
+  const auto prefix_size = static_cast<std::size_t>(last - first);
+  const auto is_prefix = [&](const char* const prefix) {
+    return std::strlen(prefix) == prefix_size &&
+           std::equal(first, last, prefix);
+  };
+  if (first == last) {
+    return LineKind::kBlank;
+  } else if (*first == CommentPrefix()[0]) {
+    return LineKind::kComment;
+  } else if (is_prefix(PositionPrefix())) {
+    return LineKind::kPosition;
+  } else if (is_prefix(FacePrefix())) {
+    return LineKind::kFace;
+  } else if (is_prefix(ObjTexCoordPrefix())) {
+    return LineKind::kTexCoord;
+  } else if (is_prefix(NormalPrefix())) {
+    return LineKind::kNormal;
+  } else if (is_prefix(SmoothingGroupPrefix())) {
+    return LineKind::kSmoothingGroup;
+  }
+  return LineKind::kOther;
+}
+
+// Number of bytes from the current position to the end of |is|, or zero if
+// the stream cannot seek.
+inline std::uint64_t RemainingSize(std::istream& is) {
+  const auto start = is.tellg();
+  if (start == std::istream::pos_type(-1)) {
+    is.clear();
+    return 0;
+  }
+  is.seekg(0, std::ios_base::end);
+  const auto end = is.tellg();
+  is.clear();
+  is.seekg(start);
+  return end > start ? static_cast<std::uint64_t>(end - start) : 0;
+}
+
+// Waits with increasing back-off: spinning first, then yielding and
+// finally sleeping, so that a stalled pipeline does not occupy a core.
+class Backoff {
+ public:
+  void Wait() {
+    if (++count_ < 64) {
+      return;
+    } else if (count_ < 256) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+ private:
+  std::uint32_t count_ = 0;
+};
+
+// Bounded lock-free queue with a single producer and a single consumer
+// thread. Slots are filled and consumed in place, so that their buffers
+// are reused; the indices only say which slots are ready.
+template <typename T>
+class SpscRing {
+ public:
+  explicit SpscRing(const std::size_t capacity) : slots_(capacity) {}
+
+  // Producer: returns the next free slot, waiting for the consumer to
+  // release one, or null if the consumer has stopped.
+  T* AcquireWrite() {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    auto backoff = Backoff{};
+    while (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      if (stopped_.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      backoff.Wait();
+    }
+    return stopped_.load(std::memory_order_acquire)
+               ? nullptr
+               : &slots_[tail % slots_.size()];
+  }
+
+  // Producer: publishes the slot returned by AcquireWrite.
+  void CommitWrite() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Producer: nothing more will be written.
+  void Close() { closed_.store(true, std::memory_order_release); }
+
+  // Consumer: returns the next filled slot, or null once the producer has
+  // closed the ring and all slots have been consumed.
+  T* AcquireRead() {
+    const auto head = head_.load(std::memory_order_relaxed);
+    auto backoff = Backoff{};
+    while (head == tail_.load(std::memory_order_acquire)) {
+      if (closed_.load(std::memory_order_acquire) &&
+          head == tail_.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      backoff.Wait();
+    }
+    return &slots_[head % slots_.size()];
+  }
+
+  // Consumer: hands the slot returned by AcquireRead back to the producer.
+  void ReleaseRead() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Consumer: nothing more will be read.
+  void Stop() { stopped_.store(true, std::memory_order_release); }
+
+ private:
+  std::vector<T> slots_;
+  std::atomic<std::size_t> head_{0};  // Slots consumed.
+  std::atomic<std::size_t> tail_{0};  // Slots produced.
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> stopped_{false};
+};
+
+inline std::streamsize ReadBlock(std::streambuf* const rdbuf,
+                                 char* const data, const std::size_t size) {
+  trace::Span span("read block");
+  const auto n = rdbuf->sgetn(data, static_cast<std::streamsize>(size));
+  span.Arg("bytes", n > 0 ? static_cast<std::uint64_t>(n) : 0);
+  return n;
+}
+
+// Calls |func(data, size)| for consecutive blocks of at most |block_size|
+// bytes read from |rdbuf|, until the end of the stream or until |func|
+// returns false.
+template <typename FuncT>
+void ForEachBlock(std::streambuf* const rdbuf, const std::size_t block_size,
+                  FuncT&& func) {
+  auto buffer = std::vector<char>(block_size);
+  for (;;) {
+    const auto n = ReadBlock(rdbuf, buffer.data(), block_size);
+    if (n <= 0 || !func(static_cast<const char*>(buffer.data()),
+                        static_cast<std::size_t>(n))) {
+      return;
+    }
+  }
+}
+
+// As ForEachBlock, but |rdbuf| is read on a separate thread that stays up
+// to kPipelineBlockCount blocks ahead of |func|. Exceptions thrown while
+// reading are re-thrown on the calling thread once the blocks read before
+// them have been passed to |func|.
+template <typename FuncT>
+void ForEachBlockPipelined(std::streambuf* const rdbuf,
+                           const std::size_t block_size, FuncT&& func) {
+  struct Block {
+    std::vector<char> data;
+    std::size_t size;
+  };
+  constexpr auto kPipelineBlockCount = std::size_t{4};
+  SpscRing<Block> ring(kPipelineBlockCount);
+  auto read_error = std::exception_ptr{};
+  auto reader = std::thread([rdbuf, block_size, &ring, &read_error]() {
+    try {
+      while (auto* const block = ring.AcquireWrite()) {
+        block->data.resize(block_size);
+        const auto n = ReadBlock(rdbuf, block->data.data(), block_size);
+        if (n <= 0) {
+          break;
+        }
+        block->size = static_cast<std::size_t>(n);
+        ring.CommitWrite();
+      }
+    } catch (...) {
+      read_error = std::current_exception();
+    }
+    ring.Close();
+  });
+
+  // The reader must be stopped and joined however this function exits.
+  struct Joiner {
+    ~Joiner() {
+      ring->Stop();
+      thread->join();
+    }
+    SpscRing<Block>* ring;
+    std::thread* thread;
+  } joiner = {&ring, &reader};
+
+  while (const auto* const block = ring.AcquireRead()) {
+    const auto more =
+        func(static_cast<const char*>(block->data.data()), block->size);
+    ring.ReleaseRead();
+    if (!more) {
+      return;
+    }
+  }
+  if (read_error) {
+    std::rethrow_exception(read_error);
+  }
+}
+
+// Statistics policy of reads without statistics, which compiles away.
+class NoReadStats {
+ public:
+  template <typename AddFuncT>
+  AddFuncT& Timed(AddFuncT& add) {
+    return add;
+  }
+
+  void Start() {}
+  void BeginBlock() {}
+  void EndBlock() {}
+  void Line(const std::string&, const std::size_t) {}
+  void Finish(const std::uint64_t) {}
+};
+
+// Calls an add function and accumulates the time spent in it.
+template <typename AddFuncT>
+class TimedFunc {
+ public:
+  TimedFunc(AddFuncT* const add, std::uint64_t* const ns)
+      : add_(add), ns_(ns) {}
+
+  template <typename T>
+  void operator()(const T& value) {
+    const auto start = NowNs();
+    add_->func(value);
+    *ns_ += NowNs() - start;
+  }
+
+ private:
+  AddFuncT* add_;
+  std::uint64_t* ns_;
+};
+
+// Statistics policy filling ObjReadStats. Time outside the blocks is spent
+// reading input, time in the callbacks is split off from the time in the
+// blocks.
+class ReadStatsCollector {
+ public:
+  explicit ReadStatsCollector(ObjReadStats* const stats) : stats_(stats) {
+    *stats_ = ObjReadStats{};
+  }
+
+  template <typename AddFuncT>
+  decltype(auto) Timed(AddFuncT& add) {
+    return Timed(add, typename FuncTraits<AddFuncT>::FuncCategory{},
+                 typename AddFaceTraits<AddFuncT>::AddCategory{});
+  }
+
+  void Start() { start_ = NowNs(); }
+  void BeginBlock() { block_start_ = NowNs(); }
+  void EndBlock() { block_ns_ += NowNs() - block_start_; }
+
+  void Line(const std::string& line, const std::size_t buffer_capacity) {
+    switch (ClassifyLine(line)) {
+      case LineKind::kBlank:
+        ++stats_->blank_lines;
+        break;
+      case LineKind::kComment:
+        ++stats_->comment_lines;
+        break;
+      case LineKind::kPosition:
+        ++stats_->position_lines;
+        break;
+      case LineKind::kFace:
+        ++stats_->face_lines;
+        break;
+      case LineKind::kTexCoord:
+        ++stats_->tex_coord_lines;
+        break;
+      case LineKind::kNormal:
+        ++stats_->normal_lines;
+        break;
+      case LineKind::kSmoothingGroup:
+        ++stats_->smoothing_group_lines;
+        break;
+      case LineKind::kOther:
+        break;
+    }
+    stats_->longest_line =
+        std::max<std::uint64_t>(stats_->longest_line, line.size());
+    if (buffer_capacity > buffer_capacity_) {
+      ++stats_->buffer_growths;
+      buffer_capacity_ = buffer_capacity;
+    }
+  }
+
+  void Finish(const std::uint64_t bytes) {
+    const auto total_ns = NowNs() - start_;
+    stats_->bytes = bytes;
+    stats_->io_ns = total_ns - std::min(total_ns, block_ns_);
+    stats_->parse_ns = block_ns_ - std::min(block_ns_, stats_->callback_ns);
+  }
+
+ private:
+  template <typename AddFuncT>
+  ObjAddFunc<typename std::decay<AddFuncT>::type::ParseType,
+             TimedFunc<AddFuncT>>
+  Timed(AddFuncT& add, FuncTag, FaceAddTag) {
+    return {TimedFunc<AddFuncT>(&add, &stats_->callback_ns)};
+  }
+
+  // Appending to faces builders is part of parsing.
+  template <typename AddFuncT, typename AddTagT>
+  AddFuncT& Timed(AddFuncT& add, FuncTag, AddTagT) {
+    return add;
+  }
+
+  template <typename AddFuncT, typename AddTagT>
+  AddFuncT& Timed(AddFuncT& add, NoOpFuncTag, AddTagT) {
+    return add;
+  }
+
+  ObjReadStats* stats_;
+  std::uint64_t start_ = 0;
+  std::uint64_t block_start_ = 0;
+  std::uint64_t block_ns_ = 0;
+  std::size_t buffer_capacity_ = 0;
+};
+
+// Fills |error| from the error recorded while parsing |line|, where
+// |error| already holds the line number and the offset of the line.
+inline void SetReadError(const LineError& line_error, const std::string& line,
+                         ObjReadError* const error) {
+  constexpr auto kMaxExcerptSize = std::size_t{32};
+
+  // The offending token, or the whole line without its line terminator.
+  auto first = std::size_t{0};
+  auto last = line.size();
+  if (line_error.token_end != 0) {
+    last = std::min(line_error.token_end, line.size());
+    first = last;
+    while (first > 0 &&
+           std::isspace(static_cast<unsigned char>(line[first - 1])) == 0) {
+      --first;
+    }
+  } else if (last > 0 && line[last - 1] == '\r') {
+    --last;
+  }
+
+  error->kind = line_error.kind;
+  error->byte_offset += first;
+  error->excerpt.assign(line, first, std::min(last - first, kMaxExcerptSize));
+  error->message = line_error.message;
+}
+
+// Reports an exception thrown during a read at the line being parsed, if
+// any. Does not throw, the message is left empty if it cannot be copied.
+inline void SetExceptionError(const char* const what,
+                              ObjReadError* const error) noexcept {
+  error->kind = ObjReadErrorKind::kException;
+  error->excerpt.clear();
+  try {
+    error->message = what;
+  } catch (...) {
+    error->message.clear();
+  }
+}
+
+// Reads |is| in blocks, so that progress is reported and cancellation is
+// polled between blocks rather than per line. Parse errors stop the read
+// and are recorded in |error|, which holds the number and offset of the
+// line being parsed while the callbacks run.
+template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
+          typename AddNormalFuncT, typename AddFaceFuncT, typename StatsT>
+void ParseLinesDirect(std::istream& is,
+                      AddPositionFuncT&& add_position,
+                      AddFaceFuncT&& add_face,
+                      AddObjTexCoordFuncT&& add_tex_coord,
+                      AddNormalFuncT&& add_normal,
+                      const ObjReadOptions& options,
+                      ObjReadResult* const result,
+                      StatsT* const stats,
+                      ObjReadError* const error) {
+  using FaceType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  constexpr auto kMaxBlockSize = std::uint64_t{1} << 20;
+  constexpr auto kMinBlockSize = std::uint64_t{1} << 12;
+
+  auto state = ReadState<FaceIndexType<FaceType>>(options);
+  if (!CheckReadOptions<AddFaceFuncT, AddNormalFuncT>(options,
+                                                       &state.error)) {
+    SetReadError(state.error, std::string{}, error);
+    return;
+  }
+  const auto monitor = ProgressMonitor(
+      options.progress, options.cancellation,
+      options.progress ? RemainingSize(is) : 0);
+  auto&& timed_position = stats->Timed(add_position);
+  auto&& timed_face = stats->Timed(add_face);
+  auto&& timed_tex_coord = stats->Timed(add_tex_coord);
+  auto&& timed_normal = stats->Timed(add_normal);
+  auto lines = LineBuffer{};
+  auto line_offset = std::uint64_t{0};
+  auto failed = false;
+  const auto parse_line = [&](const std::string& line) {
+    if (failed) {
+      return;  // Skip the rest of the block.
+    }
+    ++error->line;
+    error->byte_offset = line_offset;
+    line_offset += line.size() + 1;  // Including the newline.
+    stats->Line(line, lines.capacity() + state.face_indices.capacity());
+    if (!obj_io_internal::read::ParseLine(
+            line, timed_position, timed_face, timed_tex_coord, timed_normal,
+            &state, &result->position_count, &result->face_count,
+            &result->tex_coord_count, &result->normal_count)) {
+      SetReadError(state.error, line, error);
+      failed = true;
+    }
+  };
+
+  const auto interval = std::max(options.progress_interval, kMinBlockSize);
+  const auto block_size = static_cast<std::size_t>(
+      monitor.enabled() ? std::min(interval, kMaxBlockSize) : kMaxBlockSize);
+  auto bytes_done = std::uint64_t{0};
+  auto next_update = interval;
+  const auto parse_block = [&](const char* const data,
+                               const std::size_t size) {
+    trace::Span span("parse block");
+    span.Arg("bytes", size);
+    stats->BeginBlock();
+    lines.Feed(data, size, parse_line);
+    stats->EndBlock();
+    bytes_done += size;
+    if (bytes_done >= next_update && monitor.enabled()) {
+      next_update = bytes_done + interval;
+      result->cancelled = monitor.Update(bytes_done, ElementCount(*result));
+    }
+    return !(result->cancelled || failed);
+  };
+
+  stats->Start();
+  const std::istream::sentry sentry(is, /* noskipws */ true);
+  if (sentry) {
+    if (options.pipelined) {
+      ForEachBlockPipelined(is.rdbuf(), block_size, parse_block);
+    } else {
+      ForEachBlock(is.rdbuf(), block_size, parse_block);
+    }
+  }
+  if (failed) {
+    return;
+  }
+  if (result->cancelled) {
+    DeliverWeldMap(&state);
+    stats->Finish(bytes_done);
+    return;
+  }
+  is.setstate(std::ios_base::eofbit);
+  stats->BeginBlock();
+  {
+    trace::Span span("finish lines");
+    lines.Finish(parse_line);
+    if (failed) {
+      return;
+    }
+
+    // Errors from here on are not tied to a line.
+    error->line = 0;
+    error->byte_offset = 0;
+    FinishLines(timed_face, timed_normal, &state, &result->face_count,
+                &result->normal_count);
+  }
+  stats->EndBlock();
+  stats->Finish(bytes_done);
+  monitor.Report(bytes_done, ElementCount(*result));
+}
+
+// Element type of an add function, or NoElement for null callbacks.
+struct NoElement {};
+
+template <typename FuncT,
+          typename CategoryT = typename FuncTraits<FuncT>::FuncCategory>
+struct ElementTypeImpl {
+  using Type = typename std::decay<FuncT>::type::ParseType;
+};
+
+template <typename FuncT>
+struct ElementTypeImpl<FuncT, NoOpFuncTag> {
+  using Type = NoElement;
+};
+
+template <typename FuncT>
+using ElementType = typename ElementTypeImpl<FuncT>::Type;
+
+// Elements in file order, stored in one array per element type.
+template <typename PositionT, typename FaceT, typename TexCoordT,
+          typename NormalT>
+struct ElementBatch {
+  enum class Kind : std::uint8_t { kPosition, kFace, kTexCoord, kNormal };
+
+  void Clear() {
+    positions.clear();
+    faces.clear();
+    tex_coords.clear();
+    normals.clear();
+    order.clear();
+  }
+
+  std::vector<PositionT> positions;
+  std::vector<FaceT> faces;
+  std::vector<TexCoordT> tex_coords;
+  std::vector<NormalT> normals;
+  std::vector<Kind> order;
+};
+
+template <typename AddFuncT, typename T>
+void CallAdd(AddFuncT&& add, const T& value, FuncTag) {
+  add.func(value);
+}
+
+template <typename AddFuncT, typename T>
+void CallAdd(AddFuncT&&, const T&, NoOpFuncTag) {}
+
+template <typename AddFaceFuncT, typename FaceT, typename AddTagT>
+void CallAddFace(AddFaceFuncT&& add_face, const FaceT& face, AddTagT) {
+  DeliverFace(add_face, face, AddTagT{});
+}
+
+// Lazy faces are recorded on the parsing thread and never queued, see
+// MakeQueueFaceFunc.
+template <typename AddFaceFuncT, typename FaceT>
+void CallAddFace(AddFaceFuncT&&, const FaceT&, LazyAddTag) {}
+
+// Add function that stores elements in a batch instead of handling them,
+// null for null callbacks.
+template <typename AddFuncT, typename QueueFuncT>
+ObjAddFunc<ElementType<AddFuncT>, QueueFuncT> MakeQueueFunc(
+    QueueFuncT queue_func, FuncTag) {
+  return {queue_func};
+}
+
+template <typename AddFuncT, typename QueueFuncT>
+std::nullptr_t MakeQueueFunc(QueueFuncT, NoOpFuncTag) {
+  return nullptr;
+}
+
+template <typename AddFaceFuncT, typename QueueFuncT, typename AddTagT>
+ObjAddFunc<ElementType<AddFaceFuncT>, QueueFuncT> MakeQueueFaceFunc(
+    const AddFaceFuncT&, QueueFuncT queue_func, AddTagT) {
+  return {queue_func};
+}
+
+// Lazy faces are recorded on the parsing thread, there is no callback to
+// run for them.
+template <typename AddFaceFuncT, typename QueueFuncT>
+typename std::decay<AddFaceFuncT>::type MakeQueueFaceFunc(
+    const AddFaceFuncT& add_face, QueueFuncT, LazyAddTag) {
+  return add_face;
+}
+
+// Thrown on the parsing thread when the callback thread has stopped.
+struct CallbacksStopped {};
+
+// Parses |is| on the calling thread and runs the callbacks on a separate
+// thread. Parsed elements are stored in batches that are passed through a
+// bounded ring, where the parser waits when all batches are in use.
+// Elements parsed before an error are still delivered, and errors from
+// the callbacks stop the parser, so that both behave as for a direct read.
+template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
+          typename AddNormalFuncT, typename AddFaceFuncT, typename StatsT>
+void ParseLinesOnCallbackThread(std::istream& is,
+                                AddPositionFuncT&& add_position,
+                                AddFaceFuncT&& add_face,
+                                AddObjTexCoordFuncT&& add_tex_coord,
+                                AddNormalFuncT&& add_normal,
+                                const ObjReadOptions& options,
+                                ObjReadResult* const result,
+                                StatsT* const stats,
+                                ObjReadError* const error) {
+  using BatchType = ElementBatch<
+      ElementType<AddPositionFuncT>, ElementType<AddFaceFuncT>,
+      ElementType<AddObjTexCoordFuncT>, ElementType<AddNormalFuncT>>;
+  using Kind = typename BatchType::Kind;
+
+  SpscRing<BatchType> ring(std::max(options.callback_queue_size, 2u));
+  auto callback_error = std::exception_ptr{};
+  auto callback_thread = std::thread([&]() {
+    try {
+      while (auto* const batch = ring.AcquireRead()) {
+        trace::Span span("deliver batch");
+        span.Arg("elements", batch->order.size());
+        auto position_index = std::size_t{0};
+        auto face_index = std::size_t{0};
+        auto tex_coord_index = std::size_t{0};
+        auto normal_index = std::size_t{0};
+        for (const auto kind : batch->order) {
+          switch (kind) {
+            case Kind::kPosition:
+              CallAdd(add_position, batch->positions[position_index++],
+                      typename FuncTraits<AddPositionFuncT>::FuncCategory{});
+              break;
+            case Kind::kFace:
+              CallAddFace(add_face, batch->faces[face_index++],
+                          typename AddFaceTraits<AddFaceFuncT>::AddCategory{});
+              break;
+            case Kind::kTexCoord:
+              CallAdd(
+                  add_tex_coord, batch->tex_coords[tex_coord_index++],
+                  typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
+              break;
+            case Kind::kNormal:
+              CallAdd(add_normal, batch->normals[normal_index++],
+                      typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+              break;
+          }
+        }
+        batch->Clear();
+        ring.ReleaseRead();
+      }
+    } catch (...) {
+      callback_error = std::current_exception();
+      ring.Stop();
+    }
+  });
+
+  const auto batch_size = std::max<std::size_t>(options.callback_batch_size, 1);
+  auto* batch = ring.AcquireWrite();
+  const auto push = [&](const Kind kind) {
+    batch->order.push_back(kind);
+    if (batch->order.size() >= batch_size) {
+      ring.CommitWrite();
+      batch = ring.AcquireWrite();
+      if (batch == nullptr) {
+        throw CallbacksStopped{};
+      }
+    }
+  };
+  auto queue_position = MakeQueueFunc<AddPositionFuncT>(
+      [&](const auto& position) {
+        batch->positions.push_back(position);
+        push(Kind::kPosition);
+      },
+      typename FuncTraits<AddPositionFuncT>::FuncCategory{});
+  auto queue_face = MakeQueueFaceFunc(
+      add_face,
+      [&](const auto& face) {
+        batch->faces.push_back(face);
+        push(Kind::kFace);
+      },
+      typename AddFaceTraits<AddFaceFuncT>::AddCategory{});
+  auto queue_tex_coord = MakeQueueFunc<AddObjTexCoordFuncT>(
+      [&](const auto& tex_coord) {
+        batch->tex_coords.push_back(tex_coord);
+        push(Kind::kTexCoord);
+      },
+      typename FuncTraits<AddObjTexCoordFuncT>::FuncCategory{});
+  auto queue_normal = MakeQueueFunc<AddNormalFuncT>(
+      [&](const auto& normal) {
+        batch->normals.push_back(normal);
+        push(Kind::kNormal);
+      },
+      typename FuncTraits<AddNormalFuncT>::FuncCategory{});
+
+  auto parse_error = std::exception_ptr{};
+  try {
+    ParseLinesDirect(is, queue_position, queue_face, queue_tex_coord,
+                     queue_normal, options, result, stats, error);
+  } catch (const CallbacksStopped&) {
+    // The callback error is re-thrown below.
+  } catch (...) {
+    parse_error = std::current_exception();
+  }
+  if (batch != nullptr && !batch->order.empty()) {
+    ring.CommitWrite();
+  }
+  ring.Close();
+  callback_thread.join();
+
+  // A callback error happened for an element before the parse error. The
+  // line being parsed is not the line of the element.
+  if (callback_error) {
+    error->line = 0;
+    error->byte_offset = 0;
+    std::rethrow_exception(callback_error);
+  }
+  if (parse_error) {
+    std::rethrow_exception(parse_error);
+  }
+}
+
+template <typename AddPositionFuncT, typename AddObjTexCoordFuncT,
+          typename AddNormalFuncT, typename AddFaceFuncT, typename StatsT>
+void ParseLines(std::istream& is,
+                AddPositionFuncT&& add_position,
+                AddFaceFuncT&& add_face,
+                AddObjTexCoordFuncT&& add_tex_coord,
+                AddNormalFuncT&& add_normal,
+                const ObjReadOptions& options,
+                ObjReadResult* const result,
+                StatsT* const stats,
+                ObjReadError* const error) {
+  const trace::CallScope trace_scope(options.trace);
+  if (options.callback_thread) {
+    ParseLinesOnCallbackThread(
+        is, std::forward<AddPositionFuncT>(add_position),
+        std::forward<AddFaceFuncT>(add_face),
+        std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+        std::forward<AddNormalFuncT>(add_normal), options, result, stats,
+        error);
+  } else {
+    ParseLinesDirect(is, std::forward<AddPositionFuncT>(add_position),
+                     std::forward<AddFaceFuncT>(add_face),
+                     std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+                     std::forward<AddNormalFuncT>(add_normal), options,
+                     result, stats, error);
+  }
+}
+
+// Throws the error of a read, as ReadObj reports errors.
+inline void ThrowIfFailed(const ObjReadError& error) {
+  if (error.kind != ObjReadErrorKind::kNone) {
+    throw std::runtime_error(error.message);
+  }
+}
+
+}  // namespace read
+
+// Parsing of lines held in memory, as opposed to the stream based parsing
+// in the read namespace. Lines are given as [first, last) where |last|
+// points at a line terminator, so that number conversions stop there.
+namespace scan {
+
+inline bool IsSpace(const char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipSpace(const char* p, const char* const last) noexcept {
+  while (p != last && IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+inline const char* TokenEnd(const char* p, const char* const last) noexcept {
+  while (p != last && !IsSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+[[noreturn]] inline void ThrowParseError(const char* const first,
+                                         const char* const last) {
+  auto oss = std::ostringstream{};
+  oss << "failed parsing '" << std::string(first, TokenEnd(first, last))
+      << "'";
+  throw std::runtime_error(oss.str());
+}
+
+// Parses the next whitespace separated real value in [*p, last). Returns
+// false if there are no more tokens. Accepts the same values as
+// read::ExtractReal.
+template <typename T>
+bool ParseReal(const char** const p, const char* const last, T* const value) {
+  const auto* const first = SkipSpace(*p, last);
+  if (first == last) {
+    *p = last;
+    return false;
+  }
+  auto real_text = read::RealText{};
+  auto end = first;
+  while (end != last && real_text.Accept(*end)) {
+    ++end;
+  }
+  if ((end != last && !IsSpace(*end)) ||
+      !read::ConvertReal(first, end, value)) {
+    ThrowParseError(first, last);
+  }
+  *p = end;
+  return true;
+}
+
+// Parses a (one-based) index at |*p|, as read::ParseInteger. Conversion to
+// a zero-based index is left to the caller, see read::ToZeroBasedIndex.
+inline std::int64_t ParseIndex(const char** const p, const char* const last) {
+  const auto* const first = *p;
+  auto value = std::int64_t{0};
+  const auto* const end = read::ParseInteger(first, last, &value);
+  if (end == nullptr) {
+    ThrowParseError(first, last);
+  }
+  *p = end;
+  return value;
+}
+
+// Reads |is| in large blocks and calls |func(first, last)| for every line,
+// where |last| points at the line terminator (which is not part of the
+// line). The final line is given a terminator if it lacks one.
+template <typename FuncT>
+void ForEachLine(std::istream& is, FuncT&& func) {
+  constexpr auto kBlockSize = std::size_t{1} << 20;
+  auto buffer = std::vector<char>(kBlockSize + 1);
+  auto carry = std::size_t{0};  // Bytes of an incomplete line.
+  auto* const rdbuf = is.rdbuf();
+  for (;;) {
+    if (buffer.size() - carry < kBlockSize / 2) {
+      buffer.resize(buffer.size() + kBlockSize);  // Very long line.
+    }
+    const auto n = rdbuf->sgetn(
+        buffer.data() + carry,
+        static_cast<std::streamsize>(buffer.size() - carry - 1));
+    if (n <= 0) {
+      break;
+    }
+    const auto* first = buffer.data();
+    const auto* const end = buffer.data() + carry + n;
+    for (;;) {
+      const auto* const newline = static_cast<const char*>(
+          std::memchr(first, '\n', static_cast<std::size_t>(end - first)));
+      if (newline == nullptr) {
+        break;
+      }
+      func(first, newline);
+      first = newline + 1;
+    }
+    carry = static_cast<std::size_t>(end - first);
+    std::memmove(buffer.data(), first, carry);
+  }
+  if (carry > 0) {
+    buffer[carry] = '\n';
+    func(buffer.data(), buffer.data() + carry);
+  }
+  is.setstate(std::ios_base::eofbit);
+}
+
+// Index group of a face corner, with one-based indices as in the file.
+struct Corner {
+  std::int64_t position;
+  std::int64_t tex_coord;
+  std::int64_t normal;
+  bool has_tex_coord;
+  bool has_normal;
+};
+
+[[noreturn]] inline void ThrowIndexGroupError(const char* const message,
+                                              const char* const first,
+                                              const char* const last) {
+  auto oss = std::ostringstream{};
+  oss << message << " ('" << std::string(first, last) << "')";
+  throw std::runtime_error(oss.str());
+}
+
+// Parses an index group token in [first, last), i.e. "p", "p/t", "p//n" or
+// "p/t/n".
+inline Corner ParseCorner(const char* const first, const char* const last) {
+  auto corner = Corner{};
+  auto p = first;
+  if (*p == '/') {
+    ThrowIndexGroupError("empty position index", first, last);
+  }
+  corner.position = ParseIndex(&p, last);
+  if (p != last && *p == '/') {
+    ++p;
+    if (p != last && *p != '/') {
+      corner.tex_coord = ParseIndex(&p, last);
+      corner.has_tex_coord = true;
+    }
+    if (p != last && *p == '/') {
+      ++p;
+      if (p == last) {
+        ThrowIndexGroupError("empty normal index", first, last);
+      }
+      corner.normal = ParseIndex(&p, last);
+      corner.has_normal = true;
+    }
+  }
+  if (p != last) {
+    if (*p == '/') {
+      ThrowIndexGroupError("index group can have at most 3 tokens", first,
+                           last);
+    }
+    ThrowParseError(first, last);
+  }
+  return corner;
+}
+
+// Parses up to N real values, returns the number of values parsed.
+template <std::size_t N>
+std::uint32_t ParseReals(const char* p, const char* const last,
+                         std::array<double, N>* const values) {
+  auto count = std::uint32_t{0};
+  auto value = 0.0;
+  while (ParseReal(&p, last, &value)) {
+    if (count >= N) {
+      auto oss = std::ostringstream{};
+      oss << "expected to parse at most " << N << " values";
+      throw std::runtime_error(oss.str());
+    }
+    (*values)[count++] = value;
+  }
+  return count;
+}
+
+// Parses lines and passes the elements to a handler, which must provide:
+//
+//   void Position(const std::array<double, 4>& values, std::uint32_t count);
+//   void TexCoord(const std::array<double, 3>& values, std::uint32_t count);
+//   void Normal(const std::array<double, 3>& values);
+//   void Face(const std::vector<Corner>& corners);
+//   void SmoothingGroup(std::uint32_t group);
+//
+// Handler calls are resolved at compile time, so that they can be inlined
+// into the parse loop. Value counts and texture coordinate ranges are
+// validated before calling the handler; faces have at least three corners.
+template <typename HandlerT>
+class LineParser {
+ public:
+  explicit LineParser(HandlerT* const handler) : handler_(handler) {}
+
+  void ParseLine(const char* p, const char* const last) {
+    p = SkipSpace(p, last);
+    const auto* const prefix_end = TokenEnd(p, last);
+    const auto prefix_length = prefix_end - p;
+    if (prefix_length == 0 || *p == '#') {
+      return;  // Ignore empty lines and comments.
+    }
+    if (prefix_length == 1 && *p == 'v') {
+      ParsePosition(prefix_end, last);
+    } else if (prefix_length == 1 && *p == 'f') {
+      ParseFace(prefix_end, last);
+    } else if (prefix_length == 2 && p[0] == 'v' && p[1] == 't') {
+      ParseTexCoord(prefix_end, last);
+    } else if (prefix_length == 2 && p[0] == 'v' && p[1] == 'n') {
+      ParseNormal(prefix_end, last);
+    } else if (prefix_length == 1 && *p == 's') {
+      ParseSmoothingGroup(prefix_end, last);
+    } else {
+      auto oss = std::ostringstream{};
+      oss << "unrecognized line prefix '" << std::string(p, prefix_end)
+          << "'";
+      throw std::runtime_error(oss.str());
+    }
+  }
+
+ private:
+  void ParsePosition(const char* const p, const char* const last) {
+    auto values = std::array<double, 4>{};
+    const auto count = ParseReals(p, last, &values);
+    if (count < 3) {
+      auto oss = std::ostringstream{};
+      oss << "positions must have 3 or 4 values (found " << count << ")";
+      throw std::runtime_error(oss.str());
+    }
+    handler_->Position(values, count);
+  }
+
+  void ParseTexCoord(const char* const p, const char* const last) {
+    auto values = std::array<double, 3>{};
+    const auto count = ParseReals(p, last, &values);
+    if (count < 2) {
+      auto oss = std::ostringstream{};
+      oss << "texture coordinates must have 2 or 3 values (found " << count
+          << ")";
+      throw std::runtime_error(oss.str());
+    }
+    for (auto i = std::uint32_t{0}; i < count; ++i) {
+      if (!(0.0 <= values[i] && values[i] <= 1.0)) {
+        auto oss = std::ostringstream{};
+        oss << "texture coordinate values must be in range [0, 1] (found "
+            << values[i] << ")";
+        throw std::runtime_error(oss.str());
+      }
+    }
+    handler_->TexCoord(values, count);
+  }
+
+  void ParseNormal(const char* const p, const char* const last) {
+    auto values = std::array<double, 3>{};
+    const auto count = ParseReals(p, last, &values);
+    if (count < 3) {
+      auto oss = std::ostringstream{};
+      oss << "normals must have 3 values (found " << count << ")";
+      throw std::runtime_error(oss.str());
+    }
+    handler_->Normal(values);
+  }
+
+  void ParseFace(const char* p, const char* const last) {
+    corners_.clear();
+    for (;;) {
+      p = SkipSpace(p, last);
+      if (p == last) {
+        break;
+      }
+      const auto* const token_end = TokenEnd(p, last);
+      corners_.push_back(ParseCorner(p, token_end));
+      p = token_end;
+    }
+    if (!(corners_.size() >= 3)) {
+      auto oss = std::ostringstream{};
+      oss << "faces must have at least 3 indices (found " << corners_.size()
+          << ")";
+      throw std::runtime_error(oss.str());
+    }
+    handler_->Face(corners_);
+  }
+
+  void ParseSmoothingGroup(const char* p, const char* const last) {
+    p = SkipSpace(p, last);
+    if (p == last) {
+      throw std::runtime_error("smoothing group must have a value");
+    }
+    const auto* const token_end = TokenEnd(p, last);
+    auto group = std::uint32_t{0};
+    if (!read::ParseSmoothingGroupToken(p, token_end, &group)) {
+      auto oss = std::ostringstream{};
+      oss << "failed parsing smoothing group '" << std::string(p, token_end)
+          << "'";
+      throw std::runtime_error(oss.str());
+    }
+    handler_->SmoothingGroup(group);
+  }
+
+  HandlerT* handler_;
+  std::vector<Corner> corners_;
+};
+
+}  // namespace scan
+
+namespace write {
+
+template <typename IntT>
+std::ostream& operator<<(std::ostream& os, const ObjIndex<IntT>& index) {
+  using ValueType = decltype(index.value);
+
+  // Note that the valid range allows increment of one.
+  if (!(ValueType{0} <= index.value &&
+        index.value < std::numeric_limits<ValueType>::max())) {
+    auto oss = std::ostringstream{};
+    oss << "invalid index: " << static_cast<std::int64_t>(index.value);
+    throw std::runtime_error(oss.str());
+  }
+
+  // Input indices are assumed to be zero-based.
+  // OBJ format uses one-based indexing.
+  os << index.value + 1;
+  return os;
+}
+
+template <typename IntT>
+std::ostream& operator<<(std::ostream& os,
+                         const ObjIndexGroup<IntT>& index_group) {
+  os << index_group.position_index;
+  if (index_group.tex_coord_index.second && index_group.normal_index.second) {
+    os << IndexGroupSeparator() << index_group.tex_coord_index.first
+       << IndexGroupSeparator() << index_group.normal_index.first;
+  } else if (index_group.tex_coord_index.second) {
+    os << IndexGroupSeparator() << index_group.tex_coord_index.first;
+  } else if (index_group.normal_index.second) {
+    os << IndexGroupSeparator() << IndexGroupSeparator()
+       << index_group.normal_index.first;
+  }
+  return os;
+}
+
+// Counts written elements, reporting progress and polling for cancellation
+// every options.progress_interval elements.
+class Progress {
+ public:
+  Progress(std::ostream& os, const ObjWriteOptions& options)
+      : os_(os),
+        monitor_(options.progress, options.cancellation, 0),
+        interval_(std::max(options.progress_interval, 1u)),
+        start_(monitor_.enabled() ? os.tellp() : std::ostream::pos_type(-1)),
+        next_update_(monitor_.enabled()
+                         ? interval_
+                         : std::numeric_limits<std::uint64_t>::max()) {}
+
+  // Counts one element and returns true if the write should stop.
+  bool Count() {
+    if (++element_count_ != next_update_) {
+      return false;
+    }
+    next_update_ += interval_;
+    cancelled_ = monitor_.Update(BytesDone(), element_count_);
+    return cancelled_;
+  }
+
+  void Finish() const { monitor_.Report(BytesDone(), element_count_); }
+
+  bool cancelled() const noexcept { return cancelled_; }
+
+ private:
+  std::uint64_t BytesDone() const {
+    if (start_ == std::ostream::pos_type(-1)) {
+      return 0;
+    }
+    const auto pos = os_.tellp();
+    return pos > start_ ? static_cast<std::uint64_t>(pos - start_) : 0;
+  }
+
+  std::ostream& os_;
+  ProgressMonitor monitor_;
+  std::uint64_t interval_;
+  std::ostream::pos_type start_;
+  std::uint64_t next_update_;
+  std::uint64_t element_count_ = 0;
+  bool cancelled_ = false;
+};
+
+inline void WriteHeader(std::ostream& os, const std::string& newline) {
+  os << CommentPrefix() << " Written by https://github.com/thinks/obj-io"
+     << newline;
+}
+
+template <template <typename> class MappedTypeCheckerT, typename MapperT,
+          typename ValidatorT>
+std::uint32_t WriteMappedLines(std::ostream& os, const std::string& line_prefix,
+                               MapperT&& mapper, ValidatorT validator,
+                               const std::string& newline,
+                               Progress* const progress) {
+  auto count = std::uint32_t{0};
+  auto map_result = mapper();
+  while (!map_result.is_end) {
+    static_assert(MappedTypeCheckerT<decltype(map_result.value)>::value,
+                  "incorrect mapped type");
+
+    validator(map_result.value);
+
+    // Write line.
+    os << line_prefix;
+    for (const auto& element : map_result.value.values) {
+      os << " " << element;
+    }
+    os << newline;
+
+    ++count;
+    if (progress->Count()) {
+      break;
+    }
+    map_result = mapper();
+  }
+  return count;
+}
+
+template <typename MapperT>
+std::uint32_t WritePositions(std::ostream& os, MapperT&& mapper,
+                             const std::string& newline,
+                             Progress* const progress) {
+  trace::Span span("write positions");
+  return WriteMappedLines<IsPosition>(os, PositionPrefix(),
+                                      std::forward<MapperT>(mapper),
+                                      [](const auto&) {},  // No validation.
+                                      newline, progress);
+}
+
+template <typename MapperT>
+std::uint32_t WriteObjTexCoords(std::ostream& os, MapperT&& mapper,
+                                const std::string& newline,
+                                Progress* const progress, FuncTag) {
+  trace::Span span("write tex coords");
+  return WriteMappedLines<IsObjTexCoord>(
+      os, ObjTexCoordPrefix(), std::forward<MapperT>(mapper),
+      [](const auto& tex_coord) { ValidateObjTexCoord(tex_coord); }, newline,
+      progress);
+}
+
+// Dummy.
+template <typename MapperT>
+std::uint32_t WriteObjTexCoords(std::ostream&, MapperT&&, const std::string&,
+                                Progress* const, NoOpFuncTag) {
+  return 0;
+}
+
+template <typename MapperT>
+std::uint32_t WriteNormals(std::ostream& os, MapperT&& mapper,
+                           const std::string& newline,
+                           Progress* const progress, FuncTag) {
+  trace::Span span("write normals");
+  return WriteMappedLines<IsNormal>(os, NormalPrefix(),
+                                    std::forward<MapperT>(mapper),
+                                    [](const auto&) {},  // No validation.
+                                    newline, progress);
+}
+
+// Dummy.
+template <typename MapperT>
+std::uint32_t WriteNormals(std::ostream&, MapperT&&, const std::string&,
+                           Progress* const, NoOpFuncTag) {
+  return 0;
+}
+
+template <typename MapperT>
+std::uint32_t WriteFaces(std::ostream& os, MapperT&& mapper,
+                         const std::string& newline,
+                         Progress* const progress) {
+  trace::Span span("write faces");
+  return WriteMappedLines<IsFace>(
+      os, FacePrefix(), std::forward<MapperT>(mapper),
+      [](const auto& face) {
+        ValidateFace(face, typename FaceTraits<decltype(face)>::FaceCategory{});
+      },
+      newline, progress);
+}
+
+}  // namespace write
+}  // namespace obj_io_internal
+
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjReadResult ReadObj(std::istream& is, 
+                      AddPositionFuncT&& add_position,
+                      AddFaceFuncT&& add_face,
+                      AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                      AddNormalFuncT&& add_normal = nullptr,
+                      const ObjReadOptions& options = ObjReadOptions{}) {
+  ObjReadResult result = {};
+  ObjReadError error = {};
+  auto no_stats = obj_io_internal::read::NoReadStats{};
+  obj_io_internal::read::ParseLines(
+      is, std::forward<AddPositionFuncT>(add_position),
+      std::forward<AddFaceFuncT>(add_face),
+      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+      std::forward<AddNormalFuncT>(add_normal), options, &result, &no_stats,
+      &error);
+  obj_io_internal::read::ThrowIfFailed(error);
+  return result;
+}
+
+// Same as ReadObj, but also fills |stats|, which costs some time per line
+// and per callback.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT>
+ObjReadResult ReadObj(std::istream& is, 
+                      AddPositionFuncT&& add_position,
+                      AddFaceFuncT&& add_face,
+                      AddObjTexCoordFuncT&& add_tex_coord,
+                      AddNormalFuncT&& add_normal,
+                      const ObjReadOptions& options,
+                      ObjReadStats* const stats) {
+  ObjReadResult result = {};
+  ObjReadError error = {};
+  auto collector = obj_io_internal::read::ReadStatsCollector(stats);
+  obj_io_internal::read::ParseLines(
+      is, std::forward<AddPositionFuncT>(add_position),
+      std::forward<AddFaceFuncT>(add_face),
+      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+      std::forward<AddNormalFuncT>(add_normal), options, &result, &collector,
+      &error);
+  obj_io_internal::read::ThrowIfFailed(error);
+  return result;
+}
+
+// Same as ReadObj, but errors are returned instead of thrown. Parse errors
+// are located by line and byte offset, and parsing does not throw to stop
+// at them. Exceptions thrown by the callbacks or the stream, and failed
+// allocations, are caught and reported as ObjReadErrorKind::kException,
+// located at the line being parsed when the callbacks run on the calling
+// thread. The counts are those of the elements read before the error.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjTryReadResult TryReadObj(
+    std::istream& is, AddPositionFuncT&& add_position, AddFaceFuncT&& add_face,
+    AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+    AddNormalFuncT&& add_normal = nullptr,
+    const ObjReadOptions& options = ObjReadOptions{}) noexcept {
+  ObjTryReadResult outcome = {};
+  auto no_stats = obj_io_internal::read::NoReadStats{};
+  try {
+    obj_io_internal::read::ParseLines(
+        is, std::forward<AddPositionFuncT>(add_position),
+        std::forward<AddFaceFuncT>(add_face),
+        std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+        std::forward<AddNormalFuncT>(add_normal), options, &outcome.result,
+        &no_stats, &outcome.error);
+  } catch (const std::exception& ex) {
+    obj_io_internal::read::SetExceptionError(ex.what(), &outcome.error);
+  } catch (...) {
+    obj_io_internal::read::SetExceptionError("unknown exception",
+                                             &outcome.error);
+  }
+  if (outcome.ok()) {
+    outcome.error.line = 0;
+    outcome.error.byte_offset = 0;
+  }
+  return outcome;
+}
+
+// Incremental (push) parser for input that arrives in chunks of arbitrary
+// size, e.g. from a pipe or a socket. Elements are passed to the same
+// callbacks as for ReadObj as soon as the lines holding them are
+// complete; only the incomplete trailing line is buffered between calls.
+// Use MakeObjStreamParser to deduce the callback types. The parser must
+// not be fed after an exception has been thrown.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+class ObjStreamParser {
+ public:
+  ObjStreamParser(AddPositionFuncT add_position, AddFaceFuncT add_face,
+                  AddObjTexCoordFuncT add_tex_coord = nullptr,
+                  AddNormalFuncT add_normal = nullptr,
+                  const ObjReadOptions& options = ObjReadOptions{})
+      : add_position_(std::move(add_position)),
+        add_face_(std::move(add_face)),
+        add_tex_coord_(std::move(add_tex_coord)),
+        add_normal_(std::move(add_normal)),
+        state_(options) {
+    obj_io_internal::read::ValidateReadOptions<AddFaceFuncT, AddNormalFuncT>(
+        options);
+  }
+
+  // Parses the complete lines in [data, data + size), together with the
+  // line left incomplete by the previous call.
+  void Feed(const char* const data, const std::size_t size) {
+    if (finished_) {
+      throw std::runtime_error("stream parser is finished");
+    }
+    lines_.Feed(data, size,
+                [this](const std::string& line) { ParseLine(line); });
+  }
+
+  // Parses the final line (which need not end with a newline) and
+  // completes the read. Must be called exactly once, after the last Feed.
+  ObjReadResult Finish() {
+    if (finished_) {
+      throw std::runtime_error("stream parser is finished");
+    }
+    lines_.Finish([this](const std::string& line) { ParseLine(line); });
+    finished_ = true;
+    obj_io_internal::read::FinishLines(add_face_, add_normal_, &state_,
+                                       &result_.face_count,
+                                       &result_.normal_count);
+    return result_;
+  }
+
+  // Number of bytes of the incomplete trailing line.
+  std::size_t pending_size() const noexcept { return lines_.pending_size(); }
+
+ private:
+  using FaceType = typename AddFaceFuncT::ParseType;
+
+  void ParseLine(const std::string& line) {
+    if (!obj_io_internal::read::ParseLine(
+            line, add_position_, add_face_, add_tex_coord_, add_normal_,
+            &state_, &result_.position_count, &result_.face_count,
+            &result_.tex_coord_count, &result_.normal_count)) {
+      throw std::runtime_error(state_.error.message);
+    }
+  }
+
+  AddPositionFuncT add_position_;
+  AddFaceFuncT add_face_;
+  AddObjTexCoordFuncT add_tex_coord_;
+  AddNormalFuncT add_normal_;
+  obj_io_internal::read::ReadState<obj_io_internal::FaceIndexType<FaceType>>
+      state_;
+  ObjReadResult result_ = {};
+  obj_io_internal::read::LineBuffer lines_;
+  bool finished_ = false;
+};
+
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjStreamParser<typename std::decay<AddPositionFuncT>::type,
+                typename std::decay<AddFaceFuncT>::type,
+                typename std::decay<AddObjTexCoordFuncT>::type,
+                typename std::decay<AddNormalFuncT>::type>
+MakeObjStreamParser(AddPositionFuncT&& add_position, AddFaceFuncT&& add_face,
+                    AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                    AddNormalFuncT&& add_normal = nullptr,
+                    const ObjReadOptions& options = ObjReadOptions{}) {
+  return {std::forward<AddPositionFuncT>(add_position),
+          std::forward<AddFaceFuncT>(add_face),
+          std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+          std::forward<AddNormalFuncT>(add_normal), options};
+}
+
+// Outcome of ReadObjRange and CountObjRange.
+struct ObjRangeReadResult {
+  // Counts of the elements on the lines of the range.
+  ObjReadResult result;
+
+  // The lines of the range are the bytes [lines_begin, lines_end) of the
+  // stream. Ranges that tile the stream give lines that tile it too, so
+  // each line belongs to exactly one range.
+  std::uint64_t lines_begin;
+  std::uint64_t lines_end;
+};
+
+namespace obj_io_internal {
+namespace range {
+
+// Moves |source| to the first line that starts at or after |begin|, i.e.
+// just past the first newline at or after |begin| - 1, and returns the
+// offset of that line.
+inline std::uint64_t AlignToLine(std::streambuf* const source,
+                                 const std::uint64_t begin) {
+  const auto offset = begin > 0 ? begin - 1 : 0;
+  if (source->pubseekpos(static_cast<std::streamoff>(offset),
+                         std::ios_base::in) == std::streampos(-1)) {
+    auto oss = std::ostringstream{};
+    oss << "failed to seek to byte " << offset;
+    throw std::runtime_error(oss.str());
+  }
+  if (begin == 0) {
+    return 0;
+  }
+  auto line_begin = offset;
+  for (;;) {
+    const auto c = source->sbumpc();
+    if (c == std::streambuf::traits_type::eof()) {
+      return line_begin;
+    }
+    ++line_begin;
+    if (c == '\n') {
+      return line_begin;
+    }
+  }
+}
+
+// Passes on the bytes of |source|, from its current position at
+// |offset|, up to and including the newline that ends the line holding
+// byte |end| - 1. That is, the lines starting before |end|.
+class LineRangeBuf : public std::streambuf {
+ public:
+  LineRangeBuf(std::streambuf* const source, const std::uint64_t offset,
+               const std::uint64_t end)
+      : source_(source),
+        offset_(offset),
+        end_(end),
+        done_(offset >= end),
+        buffer_(std::size_t{1} << 16) {}
+
+  // Offset in |source| one past the last byte passed on so far.
+  std::uint64_t offset() const noexcept { return offset_; }
+
+ protected:
+  int_type underflow() override {
+    if (gptr() < egptr()) {
+      return traits_type::to_int_type(*gptr());
+    }
+    if (done_) {
+      return traits_type::eof();
+    }
+    const auto n = source_->sgetn(buffer_.data(),
+                                  static_cast<std::streamsize>(buffer_.size()));
+    if (n <= 0) {
+      done_ = true;
+      return traits_type::eof();
+    }
+
+    auto size = static_cast<std::size_t>(n);
+    if (offset_ + size >= end_) {
+      // Block holds byte end - 1 or lies beyond it, look for the newline
+      // ending the last line.
+      const auto first =
+          static_cast<std::size_t>(end_ > offset_ ? end_ - 1 - offset_ : 0);
+      const auto* const newline = static_cast<const char*>(
+          std::memchr(buffer_.data() + first, '\n', size - first));
+      if (newline != nullptr) {
+        size = static_cast<std::size_t>(newline - buffer_.data()) + 1;
+        done_ = true;
+      }
+    }
+    offset_ += size;
+    setg(buffer_.data(), buffer_.data(), buffer_.data() + size);
+    return traits_type::to_int_type(*gptr());
+  }
+
+ private:
+  std::streambuf* source_;
+  std::uint64_t offset_;
+  std::uint64_t end_;
+  bool done_;
+  std::vector<char> buffer_;
+};
+
+inline void ValidateRange(const std::uint64_t begin, const std::uint64_t end) {
+  if (end < begin) {
+    auto oss = std::ostringstream{};
+    oss << "invalid byte range [" << begin << ", " << end << ")";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+// Counts the element described by the first token of |line|.
+inline void CountLine(const std::string& line, ObjReadResult* const result) {
+  switch (read::ClassifyLine(line)) {
+    case read::LineKind::kPosition:
+      ++result->position_count;
+      break;
+    case read::LineKind::kFace:
+      ++result->face_count;
+      break;
+    case read::LineKind::kTexCoord:
+      ++result->tex_coord_count;
+      break;
+    case read::LineKind::kNormal:
+      ++result->normal_count;
+      break;
+    default:
+      break;
+  }
+}
+
+}  // namespace range
+}  // namespace obj_io_internal
+
+// Same as ReadObj, but only parses the lines that start in the byte range
+// [begin, end) of |is|, which must be seekable. Splitting a stream into
+// ranges, e.g. for reading one large file on many nodes, gives each line
+// to exactly one range. Face indices are not rebased: they refer to the
+// elements of the whole stream, see CountObjRange for the elements that
+// precede a range. Welding, normal generation and ear clipping need the
+// elements of the whole stream and are not supported.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjRangeReadResult ReadObjRange(
+    std::istream& is, const std::uint64_t begin, const std::uint64_t end,
+    AddPositionFuncT&& add_position, AddFaceFuncT&& add_face,
+    AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+    AddNormalFuncT&& add_normal = nullptr,
+    const ObjReadOptions& options = ObjReadOptions{}) {
+  obj_io_internal::range::ValidateRange(begin, end);
+  if (options.weld_positions || options.weld_map != nullptr) {
+    throw std::runtime_error("welding is not supported for byte ranges");
+  }
+  if (options.generate_normals != ObjNormalGeneration::kNone) {
+    throw std::runtime_error(
+        "normal generation is not supported for byte ranges");
+  }
+  if (options.triangulation == ObjTriangulation::kEarClip) {
+    throw std::runtime_error("ear clipping is not supported for byte ranges");
+  }
+
+  ObjRangeReadResult range_result = {};
+  range_result.lines_begin =
+      obj_io_internal::range::AlignToLine(is.rdbuf(), begin);
+  obj_io_internal::range::LineRangeBuf buf(is.rdbuf(),
+                                           range_result.lines_begin, end);
+  std::istream range_is(&buf);
+  range_result.result =
+      ReadObj(range_is, std::forward<AddPositionFuncT>(add_position),
+              std::forward<AddFaceFuncT>(add_face),
+              std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+              std::forward<AddNormalFuncT>(add_normal), options);
+  range_result.lines_end = buf.offset();
+  return range_result;
+}
+
+// Counts the elements on the lines that ReadObjRange parses for the same
+// range, looking only at line prefixes. Faces are counted per line, i.e.
+// before triangulation. This pass is much cheaper than parsing, so the
+// index bases of the ranges can be found first: the elements before a
+// range are the sum of the counts of the ranges before it, see
+// ObjRangeIndexBases.
+inline ObjRangeReadResult CountObjRange(std::istream& is,
+                                        const std::uint64_t begin,
+                                        const std::uint64_t end) {
+  obj_io_internal::range::ValidateRange(begin, end);
+  ObjRangeReadResult range_result = {};
+  range_result.lines_begin =
+      obj_io_internal::range::AlignToLine(is.rdbuf(), begin);
+  obj_io_internal::range::LineRangeBuf buf(is.rdbuf(),
+                                           range_result.lines_begin, end);
+  const auto count_line = [&range_result](const std::string& line) {
+    obj_io_internal::range::CountLine(line, &range_result.result);
+  };
+  auto lines = obj_io_internal::read::LineBuffer{};
+  obj_io_internal::read::ForEachBlock(
+      &buf, std::size_t{1} << 16,
+      [&](const char* const data, const std::size_t size) {
+        lines.Feed(data, size, count_line);
+        return true;
+      });
+  lines.Finish(count_line);
+  range_result.lines_end = buf.offset();
+  return range_result;
+}
+
+// Index bases of consecutive ranges that tile a stream, given their counts
+// in stream order. Element i holds the number of elements of each kind
+// before range i, so the k-th (zero-based) position of range i has the
+// global index bases[i].position_count + k.
+inline std::vector<ObjReadResult> ObjRangeIndexBases(
+    const std::vector<ObjRangeReadResult>& ranges) {
+  auto bases = std::vector<ObjReadResult>(ranges.size());
+  auto base = ObjReadResult{};
+  for (auto i = std::size_t{0}; i < ranges.size(); ++i) {
+    bases[i] = base;
+    base.position_count += ranges[i].result.position_count;
+    base.face_count += ranges[i].result.face_count;
+    base.tex_coord_count += ranges[i].result.tex_coord_count;
+    base.normal_count += ranges[i].result.normal_count;
+  }
+  return bases;
+}
+
+struct ObjWriteResult {
+  std::uint32_t position_count;
+  std::uint32_t face_count;
+  std::uint32_t tex_coord_count;
+  std::uint32_t normal_count;
+  bool cancelled;
+};
+
+// Statistics of a write, filled by the WriteObj overload that takes a
+// pointer to them. Lines per prefix are the counts in ObjWriteResult.
+struct ObjWriteStats {
+  // Bytes written, zero if the stream does not report its position.
+  std::uint64_t bytes;
+
+  // Wall clock time spent in the mappers and formatting and writing lines.
+  std::uint64_t mapper_ns;
+  std::uint64_t write_ns;
+};
+
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT = std::nullptr_t,
+          typename NormalMapperT = std::nullptr_t>
+ObjWriteResult WriteObj(std::ostream& os, 
+                        PositionMapperT&& position_mapper,
+                        FaceMapperT&& face_mapper,
+                        ObjTexCoordMapperT&& tex_coord_mapper = nullptr,
+                        NormalMapperT&& normal_mapper = nullptr,
+                        const std::string& newline = "\n",
+                        const ObjWriteOptions& options = ObjWriteOptions{}) {
+  const obj_io_internal::trace::CallScope trace_scope(options.trace);
+  ObjWriteResult result = {};
+  auto progress = obj_io_internal::write::Progress(os, options);
+  obj_io_internal::write::WriteHeader(os, newline);
+  result.position_count += obj_io_internal::write::WritePositions(
+      os, std::forward<PositionMapperT>(position_mapper), newline, &progress);
+  if (!progress.cancelled()) {
+    result.tex_coord_count += obj_io_internal::write::WriteObjTexCoords(
+        os, std::forward<ObjTexCoordMapperT>(tex_coord_mapper), newline,
+        &progress,
+        typename obj_io_internal::FuncTraits<
+            ObjTexCoordMapperT>::FuncCategory{});
+  }
+  if (!progress.cancelled()) {
+    result.normal_count += obj_io_internal::write::WriteNormals(
+        os, std::forward<NormalMapperT>(normal_mapper), newline, &progress,
+        typename obj_io_internal::FuncTraits<NormalMapperT>::FuncCategory{});
+  }
+  if (!progress.cancelled()) {
+    result.face_count += obj_io_internal::write::WriteFaces(
+        os, std::forward<FaceMapperT>(face_mapper), newline, &progress);
+  }
+  result.cancelled = progress.cancelled();
+  if (!result.cancelled) {
+    progress.Finish();
+  }
+  return result;
+}
+
+namespace obj_io_internal {
+namespace write {
+
+// Calls a mapper and accumulates the time spent in it.
+template <typename MapperT>
+class TimedMapper {
+ public:
+  TimedMapper(MapperT* const mapper, std::uint64_t* const ns)
+      : mapper_(mapper), ns_(ns) {}
+
+  auto operator()() {
+    const auto start = NowNs();
+    auto result = (*mapper_)();
+    *ns_ += NowNs() - start;
+    return result;
+  }
+
+ private:
+  MapperT* mapper_;
+  std::uint64_t* ns_;
+};
+
+template <typename MapperT>
+TimedMapper<MapperT> Timed(MapperT& mapper, std::uint64_t* const ns,
+                           FuncTag) {
+  return TimedMapper<MapperT>(&mapper, ns);
+}
+
+template <typename MapperT>
+std::nullptr_t Timed(MapperT&, std::uint64_t* const, NoOpFuncTag) {
+  return nullptr;
+}
+
+}  // namespace write
+}  // namespace obj_io_internal
+
+// Same as WriteObj, but also fills |stats|, which costs some time per
+// mapper call.
+template <typename PositionMapperT, typename FaceMapperT,
+          typename ObjTexCoordMapperT, typename NormalMapperT>
+ObjWriteResult WriteObj(std::ostream& os, 
+                        PositionMapperT&& position_mapper,
+                        FaceMapperT&& face_mapper,
+                        ObjTexCoordMapperT&& tex_coord_mapper,
+                        NormalMapperT&& normal_mapper,
+                        const std::string& newline,
+                        const ObjWriteOptions& options,
+                        ObjWriteStats* const stats) {
+  using obj_io_internal::FuncTraits;
+  using obj_io_internal::write::Timed;
+
+  *stats = ObjWriteStats{};
+  const auto start_pos = os.tellp();
+  const auto start = obj_io_internal::NowNs();
+  const auto result = WriteObj(
+      os,
+      Timed(position_mapper, &stats->mapper_ns,
+            typename FuncTraits<PositionMapperT>::FuncCategory{}),
+      Timed(face_mapper, &stats->mapper_ns,
+            typename FuncTraits<FaceMapperT>::FuncCategory{}),
+      Timed(tex_coord_mapper, &stats->mapper_ns,
+            typename FuncTraits<ObjTexCoordMapperT>::FuncCategory{}),
+      Timed(normal_mapper, &stats->mapper_ns,
+            typename FuncTraits<NormalMapperT>::FuncCategory{}),
+      newline, options);
+  const auto total_ns = obj_io_internal::NowNs() - start;
+  stats->write_ns = total_ns - std::min(total_ns, stats->mapper_ns);
+  const auto end_pos = os.tellp();
+  if (start_pos != std::ostream::pos_type(-1) &&
+      end_pos != std::ostream::pos_type(-1)) {
+    stats->bytes = static_cast<std::uint64_t>(end_pos - start_pos);
+  }
+  return result;
+}
+
+namespace obj_io_internal {
+
+namespace unify {
+
+// Open-addressing (linear probing) hash table mapping index groups to
+// unified vertex indices. Slots are stored in a single flat array so that
+// probing touches consecutive memory. Missing texture coordinate and normal
+// indices are encoded as the maximum value of the index type, which is never
+// produced by the parser since indices are converted to zero-based.
+template <typename IntT>
+class IndexGroupTable {
+ public:
+  static constexpr std::size_t kEmpty = std::numeric_limits<std::size_t>::max();
+
+  explicit IndexGroupTable(const std::size_t expected_count = 0) {
+    auto capacity = std::size_t{16};
+    while (capacity < 2 * expected_count) {
+      capacity *= 2;
+    }
+    slots_.resize(capacity);
+  }
+
+  // Returns the value associated with |index_group|. If |index_group| is not
+  // yet in the table it is inserted with |value|.
+  std::size_t Insert(const ObjIndexGroup<IntT>& index_group,
+                     const std::size_t value) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      Grow();
+    }
+
+    auto slot = Slot{};
+    slot.position = index_group.position_index.value;
+    slot.tex_coord = index_group.tex_coord_index.second
+                         ? index_group.tex_coord_index.first.value
+                         : kMissing;
+    slot.normal = index_group.normal_index.second
+                      ? index_group.normal_index.first.value
+                      : kMissing;
+    slot.value = value;
+    return InsertSlot(slot);
+  }
+
+  std::size_t size() const noexcept { return size_; }
+
+ private:
+  static constexpr IntT kMissing = std::numeric_limits<IntT>::max();
+
+  struct Slot {
+    IntT position;
+    IntT tex_coord;
+    IntT normal;
+    std::size_t value = kEmpty;
+  };
+
+  static std::size_t Hash(const Slot& slot) noexcept {
+    // 64-bit mix (splitmix64 finalizer) of the combined index values.
+    auto h = static_cast<std::uint64_t>(slot.position);
+    h = h * 0x9e3779b97f4a7c15ULL ^ static_cast<std::uint64_t>(slot.tex_coord);
+    h = h * 0x9e3779b97f4a7c15ULL ^ static_cast<std::uint64_t>(slot.normal);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return static_cast<std::size_t>(h);
+  }
+
+  std::size_t InsertSlot(const Slot& slot) {
+    const auto mask = slots_.size() - 1;
+    auto i = Hash(slot) & mask;
+    while (slots_[i].value != kEmpty) {
+      if (slots_[i].position == slot.position &&
+          slots_[i].tex_coord == slot.tex_coord &&
+          slots_[i].normal == slot.normal) {
+        return slots_[i].value;
+      }
+      i = (i + 1) & mask;
+    }
+    slots_[i] = slot;
+    ++size_;
+    return slot.value;
+  }
+
+  void Grow() {
+    auto old_slots = std::vector<Slot>(2 * slots_.size());
+    old_slots.swap(slots_);
+    size_ = 0;
+    for (const auto& slot : old_slots) {
+      if (slot.value != kEmpty) {
+        InsertSlot(slot);
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+};
+
+template <typename IntT>
+constexpr std::size_t IndexGroupTable<IntT>::kEmpty;
+
+template <typename IntT>
+constexpr IntT IndexGroupTable<IntT>::kMissing;
+
+template <typename IntT>
+IntT ToUnifiedIndex(const std::size_t value) {
+  if (!(value < static_cast<std::size_t>(std::numeric_limits<IntT>::max()))) {
+    auto oss = std::ostringstream{};
+    oss << "unified vertex count exceeds index type range (" << value << ")";
+    throw std::runtime_error(oss.str());
+  }
+  return static_cast<IntT>(value);
+}
+
+}  // namespace unify
+}  // namespace obj_io_internal
+
+// Unified vertex and index buffers built from index group faces. Each entry
+// in |index_groups| describes a unique vertex in terms of the (zero-based)
+// position, texture coordinate and normal indices of the OBJ data. Entries
+// are ordered by first occurrence in the faces. |indices| holds one index
+// into |index_groups| per face corner, in face order.
+template <typename IntT>
+struct ObjUnifiedIndexGroups {
+  std::vector<ObjIndexGroup<IntT>> index_groups;
+  std::vector<IntT> indices;
+};
+
+// Incrementally unifies index group faces, typically while reading. OBJ
+// files store separate indices for positions, texture coordinates and
+// normals, while most graphics APIs expect a single index per vertex.
+template <typename IntT>
+class ObjIndexGroupUnifier {
+ public:
+  explicit ObjIndexGroupUnifier(const std::size_t expected_vertex_count = 0)
+      : table_(expected_vertex_count) {
+    result_.index_groups.reserve(expected_vertex_count);
+  }
+
+  // Returns the unified index of |index_group| and appends it to the index
+  // buffer.
+  IntT Add(const ObjIndexGroup<IntT>& index_group) {
+    const auto next = result_.index_groups.size();
+    const auto value = table_.Insert(index_group, next);
+    if (value == next) {
+      result_.index_groups.push_back(index_group);
+    }
+    const auto index = obj_io_internal::unify::ToUnifiedIndex<IntT>(value);
+    result_.indices.push_back(index);
+    return index;
+  }
+
+  template <typename FaceT>
+  void AddFace(const FaceT& face) {
+    static_assert(obj_io_internal::IsFace<FaceT>::value,
+                  "face must be a face type");
+    for (const auto& index_group : face.values) {
+      Add(index_group);
+    }
+  }
+
+  const std::vector<ObjIndexGroup<IntT>>& index_groups() const noexcept {
+    return result_.index_groups;
+  }
+
+  const std::vector<IntT>& indices() const noexcept { return result_.indices; }
+
+  // Moves the unified buffers out of the unifier, leaving it empty.
+  ObjUnifiedIndexGroups<IntT> Release() {
+    auto result = std::move(result_);
+    *this = ObjIndexGroupUnifier{};
+    return result;
+  }
+
+ private:
+  obj_io_internal::unify::IndexGroupTable<IntT> table_;
+  ObjUnifiedIndexGroups<IntT> result_;
+};
+
+// Returns an add function that feeds faces of type FaceT into |unifier|,
+// suitable for passing to ReadObj as |add_face|.
+template <typename FaceT, typename IntT>
+auto MakeObjUnifyingAddFunc(ObjIndexGroupUnifier<IntT>* const unifier) {
+  return MakeObjAddFunc<FaceT>(
+      [unifier](const FaceT& face) { unifier->AddFace(face); });
+}
+
+// Unifies a flat sequence of index groups (e.g. face corners collected while
+// reading). Work is split into |thread_count| contiguous chunks (zero means
+// hardware concurrency) that are hashed independently and then merged in
+// chunk order, so that the output is identical to that of a sequential
+// ObjIndexGroupUnifier regardless of thread count.
+template <typename IntT>
+ObjUnifiedIndexGroups<IntT> UnifyObjIndexGroups(
+    const std::vector<ObjIndexGroup<IntT>>& corners,
+    const std::uint32_t thread_count = 1) {
+  using obj_io_internal::unify::IndexGroupTable;
+
+  const auto corner_count = corners.size();
+  const auto chunk_count = std::max<std::size_t>(
+      1, std::min<std::size_t>(
+             obj_io_internal::ThreadCount(thread_count),
+             corner_count / std::size_t{0x10000}));
+
+  auto result = ObjUnifiedIndexGroups<IntT>{};
+  if (chunk_count == 1) {
+    auto unifier = ObjIndexGroupUnifier<IntT>(corner_count / 4);
+    for (const auto& index_group : corners) {
+      unifier.Add(index_group);
+    }
+    return unifier.Release();
+  }
+
+  // Pass 1 (parallel): unique index groups per chunk, in order of first
+  // occurrence, and chunk-local indices per corner.
+  auto chunk_index_groups =
+      std::vector<std::vector<ObjIndexGroup<IntT>>>(chunk_count);
+  auto local_indices = std::vector<std::size_t>(corner_count);
+  obj_io_internal::ParallelFor(
+      corner_count, static_cast<std::uint32_t>(chunk_count),
+      [&](const std::size_t begin, const std::size_t end,
+          const std::size_t chunk) {
+        auto table = IndexGroupTable<IntT>((end - begin) / 4);
+        auto& unique = chunk_index_groups[chunk];
+        for (auto i = begin; i < end; ++i) {
+          const auto value = table.Insert(corners[i], unique.size());
+          if (value == unique.size()) {
+            unique.push_back(corners[i]);
+          }
+          local_indices[i] = value;
+        }
+      });
+
+  // Pass 2 (sequential): merge chunk-local index groups in chunk order.
+  auto table = IndexGroupTable<IntT>(chunk_index_groups[0].size());
+  auto local_to_global = std::vector<std::vector<IntT>>(chunk_count);
+  for (auto chunk = std::size_t{0}; chunk < chunk_count; ++chunk) {
+    local_to_global[chunk].reserve(chunk_index_groups[chunk].size());
+    for (const auto& index_group : chunk_index_groups[chunk]) {
+      const auto next = result.index_groups.size();
+      const auto value = table.Insert(index_group, next);
+      if (value == next) {
+        result.index_groups.push_back(index_group);
+      }
+      local_to_global[chunk].push_back(
+          obj_io_internal::unify::ToUnifiedIndex<IntT>(value));
+    }
+  }
+
+  // Pass 3 (parallel): remap corners to global indices.
+  result.indices.resize(corner_count);
+  obj_io_internal::ParallelFor(
+      corner_count, static_cast<std::uint32_t>(chunk_count),
+      [&](const std::size_t begin, const std::size_t end,
+          const std::size_t chunk) {
+        const auto& remap = local_to_global[chunk];
+        for (auto i = begin; i < end; ++i) {
+          result.indices[i] = remap[local_indices[i]];
+        }
+      });
+
+  return result;
+}
+
+namespace obj_io_internal {
+namespace vertex_cache {
+
+template <typename IntT>
+void ValidateTriangleIndices(const std::vector<IntT>& indices,
+                             const std::size_t vertex_count) {
+  if (indices.size() % 3 != 0) {
+    auto oss = std::ostringstream{};
+    oss << "triangle index count must be a multiple of 3 (found "
+        << indices.size() << ")";
+    throw std::runtime_error(oss.str());
+  }
+  for (const auto index : indices) {
+    if (!(static_cast<std::size_t>(index) < vertex_count)) {
+      auto oss = std::ostringstream{};
+      oss << "triangle index out of range (found "
+          << static_cast<std::int64_t>(index) << ", vertex count "
+          << vertex_count << ")";
+      throw std::runtime_error(oss.str());
+    }
+  }
+}
+
+// Simulates a FIFO post-transform cache. A vertex is in the cache if it
+// was inserted less than |cache_size| misses ago.
+template <typename IntT>
+double Acmr(const std::vector<IntT>& indices, const std::size_t vertex_count,
+            const std::uint32_t cache_size) {
+  const auto triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return 0.0;
+  }
+
+  auto inserted_at = std::vector<std::uint64_t>(vertex_count, 0);
+  auto misses = std::uint64_t{0};
+  for (const auto index : indices) {
+    auto& time = inserted_at[static_cast<std::size_t>(index)];
+    if (time == 0 || misses - time >= cache_size) {
+      ++misses;
+      time = misses;
+    }
+  }
+  return static_cast<double>(misses) / static_cast<double>(triangle_count);
+}
+
+// Tipsify [Sander, Nehab and Barczak 2007]: triangles are emitted by fanning
+// around a vertex, choosing the next fanning vertex among the vertices of
+// the last fan that are still in the cache. Runs in time linear in the
+// number of triangles.
+template <typename IntT>
+void Tipsify(std::vector<IntT>* const indices, const std::size_t vertex_count,
+             const std::uint32_t cache_size) {
+  const auto& in = *indices;
+  const auto triangle_count = in.size() / 3;
+
+  // Vertex-to-triangle adjacency, in compressed row form.
+  auto live = std::vector<std::uint32_t>(vertex_count, 0);
+  for (const auto index : in) {
+    ++live[static_cast<std::size_t>(index)];
+  }
+  auto offsets = std::vector<std::size_t>(vertex_count + 1, 0);
+  for (auto v = std::size_t{0}; v < vertex_count; ++v) {
+    offsets[v + 1] = offsets[v] + live[v];
+  }
+  auto adjacency = std::vector<std::size_t>(in.size());
+  {
+    auto fill = std::vector<std::size_t>(offsets.begin(), offsets.end() - 1);
+    for (auto t = std::size_t{0}; t < triangle_count; ++t) {
+      for (auto k = std::size_t{0}; k < 3; ++k) {
+        adjacency[fill[static_cast<std::size_t>(in[3 * t + k])]++] = t;
+      }
+    }
+  }
+
+  const auto k = static_cast<std::int64_t>(cache_size);
+  auto cache_time = std::vector<std::int64_t>(vertex_count, 0);
+  auto emitted = std::vector<bool>(triangle_count, false);
+  auto dead_end = std::vector<std::size_t>{};
+  auto candidates = std::vector<std::size_t>{};
+  auto out = std::vector<IntT>{};
+  out.reserve(in.size());
+
+  auto time = k + 1;
+  auto cursor = std::size_t{0};
+  const auto skip_dead_end = [&]() -> std::int64_t {
+    while (!dead_end.empty()) {
+      const auto d = dead_end.back();
+      dead_end.pop_back();
+      if (live[d] > 0) {
+        return static_cast<std::int64_t>(d);
+      }
+    }
+    while (cursor < vertex_count) {
+      if (live[cursor] > 0) {
+        return static_cast<std::int64_t>(cursor);
+      }
+      ++cursor;
+    }
+    return -1;
+  };
+
+  auto fanning = skip_dead_end();
+  while (fanning >= 0) {
+    const auto f = static_cast<std::size_t>(fanning);
+    candidates.clear();
+    for (auto a = offsets[f]; a < offsets[f + 1]; ++a) {
+      const auto t = adjacency[a];
+      if (emitted[t]) {
+        continue;
+      }
+      for (auto c = std::size_t{0}; c < 3; ++c) {
+        const auto index = in[3 * t + c];
+        const auto v = static_cast<std::size_t>(index);
+        out.push_back(index);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - cache_time[v] > k) {
+          cache_time[v] = time++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // Prefer the candidate that will still be in the cache after its
+    // remaining triangles have been emitted, and among those the oldest.
+    auto best = std::int64_t{-1};
+    auto best_priority = std::int64_t{-1};
+    for (const auto v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      auto priority = std::int64_t{0};
+      if (time - cache_time[v] + 2 * static_cast<std::int64_t>(live[v]) <= k) {
+        priority = time - cache_time[v];
+      }
+      if (priority > best_priority) {
+        best = static_cast<std::int64_t>(v);
+        best_priority = priority;
+      }
+    }
+    fanning = best >= 0 ? best : skip_dead_end();
+  }
+
+  indices->swap(out);
+}
+
+}  // namespace vertex_cache
+}  // namespace obj_io_internal
+
+struct ObjVertexCacheResult {
+  // Average cache miss ratio, i.e. transformed vertices per triangle, for a
+  // FIFO cache. Ranges from 0.5 (ideal, for large regular meshes) to 3.
+  double acmr_before;
+  double acmr_after;
+};
+
+// Returns the average cache miss ratio of a triangle index buffer for a FIFO
+// post-transform cache holding |cache_size| vertices.
+template <typename IntT>
+double ObjAcmr(const std::vector<IntT>& indices, const std::size_t vertex_count,
+               const std::uint32_t cache_size = 16) {
+  obj_io_internal::vertex_cache::ValidateTriangleIndices(indices, vertex_count);
+  return obj_io_internal::vertex_cache::Acmr(indices, vertex_count, cache_size);
+}
+
+// Reorders the triangles of a triangle index buffer for post-transform
+// vertex cache efficiency, using the linear-time Tipsify algorithm. The
+// vertex order within each triangle (and hence winding) is preserved.
+// Typically applied to unified indices after reading (see
+// ObjIndexGroupUnifier) or to mesh indices before writing.
+template <typename IntT>
+ObjVertexCacheResult OptimizeObjVertexCache(
+    std::vector<IntT>* const indices, const std::size_t vertex_count,
+    const std::uint32_t cache_size = 16) {
+  using namespace obj_io_internal::vertex_cache;
+
+  if (cache_size == 0) {
+    throw std::runtime_error("cache size must be greater than zero");
+  }
+  ValidateTriangleIndices(*indices, vertex_count);
+
+  auto result = ObjVertexCacheResult{};
+  result.acmr_before = Acmr(*indices, vertex_count, cache_size);
+  Tipsify(indices, vertex_count, cache_size);
+  result.acmr_after = Acmr(*indices, vertex_count, cache_size);
+  return result;
+}
+
+struct ObjWeldResult {
+  // Welded (zero-based) index of each input position.
+  std::vector<std::uint32_t> weld_map;
+
+  // Input index of each kept position, in order. Kept position i is the
+  // first position of the group that has welded index i.
+  std::vector<std::uint32_t> kept_indices;
+};
+
+// Welds positions closer than |epsilon| (Euclidean distance), merging each
+// position into the first previously kept position within |epsilon|. This
+// is the same rule as ObjReadOptions::weld_positions, applied to positions
+// that have already been read. The neighbor search is split over
+// |thread_count| threads (zero means hardware concurrency), while merges
+// are resolved in input order, so the result does not depend on the
+// number of threads.
+template <typename ArithT, std::size_t N>
+ObjWeldResult WeldObjPositions(
+    const std::vector<ObjPosition<ArithT, N>>& positions, const double epsilon,
+    const std::uint32_t thread_count = 1) {
+  using obj_io_internal::ParallelFor;
+  using obj_io_internal::read::ToDouble3;
+  using obj_io_internal::weld::Cell;
+  using obj_io_internal::weld::CellTable;
+  using obj_io_internal::weld::kNone;
+
+  const auto grid = obj_io_internal::weld::Grid(epsilon);
+  const auto count = positions.size();
+  if (!(count < static_cast<std::size_t>(kNone))) {
+    throw std::runtime_error("too many positions to weld");
+  }
+  const auto chunk_count = static_cast<std::uint32_t>(std::max<std::size_t>(
+      1, std::min<std::size_t>(obj_io_internal::ThreadCount(thread_count),
+                               count / std::size_t{0x4000})));
+
+  // Bucket positions by grid cell. Cell lists are in ascending order.
+  auto cells = std::vector<Cell>(count);
+  ParallelFor(count, chunk_count,
+              [&](const std::size_t begin, const std::size_t end,
+                  const std::size_t) {
+                for (auto i = begin; i < end; ++i) {
+                  cells[i] = grid.CellOf(ToDouble3(positions[i]));
+                }
+              });
+  auto cell_table = CellTable(count / 2);
+  auto cell_ids = std::vector<std::uint32_t>(count);
+  auto cell_offsets = std::vector<std::uint32_t>(1, 0);
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    const auto next_id = static_cast<std::uint32_t>(cell_offsets.size() - 1);
+    const auto id = cell_table.Insert(cells[i], next_id);
+    if (id == next_id) {
+      cell_offsets.push_back(0);
+    }
+    cell_ids[i] = id;
+    ++cell_offsets[id + 1];
+  }
+  for (auto c = std::size_t{1}; c < cell_offsets.size(); ++c) {
+    cell_offsets[c] += cell_offsets[c - 1];
+  }
+  auto cell_members = std::vector<std::uint32_t>(count);
+  {
+    auto fill = std::vector<std::uint32_t>(cell_offsets.begin(),
+                                           cell_offsets.end() - 1);
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      cell_members[fill[cell_ids[i]]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+
+  // Find earlier positions within epsilon (parallel). In dense clusters,
+  // e.g. many coincident positions, the number of candidates grows
+  // quadratically, so positions with more than kMaxCandidates are marked
+  // with kNone instead and resolved against kept positions only.
+  constexpr auto kMaxCandidates = std::size_t{16};
+  auto candidates = std::vector<std::vector<std::uint32_t>>(chunk_count);
+  auto candidate_offsets = std::vector<std::uint32_t>(count + 1, 0);
+  ParallelFor(
+      count, chunk_count,
+      [&](const std::size_t begin, const std::size_t end,
+          const std::size_t chunk) {
+        auto& chunk_candidates = candidates[chunk];
+        for (auto i = begin; i < end; ++i) {
+          const auto p = ToDouble3(positions[i]);
+          const auto first = chunk_candidates.size();
+          auto overflow = false;
+          grid.ForEachNeighbor(cells[i], [&](const Cell& neighbor) {
+            const auto id = cell_table.Find(neighbor);
+            if (overflow || id == nullptr) {
+              return;
+            }
+            for (auto m = cell_offsets[*id]; m < cell_offsets[*id + 1]; ++m) {
+              const auto j = cell_members[m];
+              if (j >= i) {
+                break;
+              }
+              if (grid.Near(p, ToDouble3(positions[j]))) {
+                if (chunk_candidates.size() - first == kMaxCandidates) {
+                  overflow = true;
+                  return;
+                }
+                chunk_candidates.push_back(j);
+              }
+            }
+          });
+          if (overflow) {
+            chunk_candidates.resize(first);
+            candidate_offsets[i + 1] = kNone;
+            continue;
+          }
+          std::sort(chunk_candidates.begin() + first, chunk_candidates.end());
+          candidate_offsets[i + 1] =
+              static_cast<std::uint32_t>(chunk_candidates.size() - first);
+        }
+      });
+
+  // Resolve merges in input order. Kept positions are also linked per cell,
+  // kept positions are more than epsilon apart so these lists stay short.
+  auto result = ObjWeldResult{};
+  result.weld_map.resize(count);
+  auto kept = std::vector<bool>(count, false);
+  auto kept_heads = std::vector<std::uint32_t>(cell_offsets.size() - 1, kNone);
+  auto kept_next = std::vector<std::uint32_t>(count, kNone);
+  auto chunk = std::size_t{0};
+  auto chunk_end = std::size_t{0};
+  auto offset = std::size_t{0};
+  const auto chunk_size = (count + chunk_count - 1) / chunk_count;
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    if (i == chunk_end) {
+      chunk = i / chunk_size;
+      chunk_end = std::min(count, i + chunk_size);
+      offset = 0;
+    }
+    auto welded = kNone;
+    if (candidate_offsets[i + 1] == kNone) {
+      const auto p = ToDouble3(positions[i]);
+      auto best = kNone;
+      grid.ForEachNeighbor(cells[i], [&](const Cell& neighbor) {
+        const auto id = cell_table.Find(neighbor);
+        if (id == nullptr) {
+          return;
+        }
+        for (auto j = kept_heads[*id]; j != kNone; j = kept_next[j]) {
+          if (j < best && grid.Near(p, ToDouble3(positions[j]))) {
+            best = j;
+          }
+        }
+      });
+      if (best != kNone) {
+        welded = result.weld_map[best];
+      }
+    } else {
+      const auto* const first = candidates[chunk].data() + offset;
+      const auto* const last = first + candidate_offsets[i + 1];
+      offset += candidate_offsets[i + 1];
+      for (auto j = first; j != last; ++j) {
+        if (kept[*j]) {
+          welded = result.weld_map[*j];
+          break;
+        }
+      }
+    }
+    if (welded == kNone) {
+      kept[i] = true;
+      kept_next[i] = kept_heads[cell_ids[i]];
+      kept_heads[cell_ids[i]] = static_cast<std::uint32_t>(i);
+      welded = static_cast<std::uint32_t>(result.kept_indices.size());
+      result.kept_indices.push_back(static_cast<std::uint32_t>(i));
+    }
+    result.weld_map[i] = welded;
+  }
+  return result;
+}
+
+struct ObjProbeResult {
+  std::uint32_t position_count;
+  std::uint32_t face_count;
+  std::uint32_t tex_coord_count;
+  std::uint32_t normal_count;
+
+  // Total number of face indices (or index groups), i.e. face corners.
+  std::uint64_t face_index_count;
+};
+
+// Counts the elements in |is| by looking only at line prefixes and at the
+// number of tokens on face lines, without parsing any values. Useful for
+// presizing containers before calling ReadObj. The stream must be seekable,
+// it is restored to its initial position before returning.
+inline ObjProbeResult ProbeObj(std::istream& is) {
+  const auto start = is.tellg();
+  if (start == std::istream::pos_type(-1)) {
+    throw std::runtime_error("probing requires a seekable stream");
+  }
+
+  enum class State { kLeading, kPrefix, kFace, kSkip };
+
+  auto result = ObjProbeResult{};
+  auto state = State::kLeading;
+  char prefix[3] = {};
+  auto prefix_length = std::size_t{0};
+  auto in_token = false;
+  auto token_count = std::uint64_t{0};
+
+  // Classifies the prefix of the current line, returns the state for the
+  // remainder of the line.
+  const auto classify = [&]() {
+    if (prefix_length == 1 && prefix[0] == 'v') {
+      ++result.position_count;
+    } else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 't') {
+      ++result.tex_coord_count;
+    } else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 'n') {
+      ++result.normal_count;
+    } else if (prefix_length == 1 && prefix[0] == 'f') {
+      ++result.face_count;
+      return State::kFace;
+    }
+    return State::kSkip;
+  };
+
+  auto buffer = std::vector<char>(std::size_t{1} << 16);
+  auto* const rdbuf = is.rdbuf();
+  for (;;) {
+    const auto n = rdbuf->sgetn(buffer.data(),
+                                static_cast<std::streamsize>(buffer.size()));
+    if (n <= 0) {
+      break;
+    }
+    for (auto i = std::streamsize{0}; i < n; ++i) {
+      const auto c = buffer[static_cast<std::size_t>(i)];
+      const auto is_space = c == ' ' || c == '\t' || c == '\r';
+      if (c == '\n') {
+        if (state == State::kPrefix) {
+          classify();
+        }
+        result.face_index_count += token_count;
+        state = State::kLeading;
+        token_count = 0;
+        continue;
+      }
+
+      switch (state) {
+        case State::kLeading:
+          if (is_space) {
+            break;
+          }
+          state = State::kPrefix;
+          prefix_length = 0;
+          // Fall through.
+        case State::kPrefix:
+          if (is_space) {
+            state = classify();
+            in_token = false;
+          } else if (prefix_length < 3) {
+            prefix[prefix_length++] = c;
+          } else {
+            prefix_length = 4;  // Not a known prefix.
+          }
+          break;
+        case State::kFace:
+          if (is_space) {
+            in_token = false;
+          } else if (!in_token) {
+            in_token = true;
+            ++token_count;
+          }
+          break;
+        case State::kSkip:
+          break;
+      }
+    }
+  }
+  if (state == State::kPrefix) {
+    classify();
+  }
+  result.face_index_count += token_count;
+
+  is.clear();
+  is.seekg(start);
+  return result;
+}
+
+// Returns the size in bytes (1, 2 or 4) of the narrowest unsigned integer
+// type that can hold |max_index|.
+inline std::uint32_t ObjIndexWidth(const std::uint64_t max_index) {
+  if (max_index <= std::numeric_limits<std::uint8_t>::max()) {
+    return 1;
+  }
+  if (max_index <= std::numeric_limits<std::uint16_t>::max()) {
+    return 2;
+  }
+  if (max_index <= std::numeric_limits<std::uint32_t>::max()) {
+    return 4;
+  }
+  throw std::runtime_error("index does not fit in 32 bits");
+}
+
+// Index buffer that stores (zero-based) indices in the narrowest of 8, 16
+// or 32 bits. The width is either chosen up front from a known vertex count,
+// e.g. from ProbeObj, or grows adaptively as larger indices are added, in
+// which case existing indices are converted (at most twice in total).
+class ObjIndexBuffer {
+ public:
+  ObjIndexBuffer() = default;
+
+  explicit ObjIndexBuffer(const std::uint64_t vertex_count)
+      : width_(ObjIndexWidth(vertex_count > 0 ? vertex_count - 1 : 0)) {}
+
+  void reserve(const std::size_t count) { bytes_.reserve(count * width_); }
+
+  void push_back(const std::uint32_t index) {
+    const auto width = ObjIndexWidth(index);
+    if (width > width_) {
+      Widen(width);
+    }
+    bytes_.resize(bytes_.size() + width_);
+    Store(size_++, index);
+  }
+
+  std::uint32_t operator[](const std::size_t i) const noexcept {
+    switch (width_) {
+      case 1:
+        return bytes_[i];
+      case 2:
+        return Load<std::uint16_t>(i);
+      default:
+        return Load<std::uint32_t>(i);
+    }
+  }
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  // Size in bytes of each index (1, 2 or 4).
+  std::uint32_t width() const noexcept { return width_; }
+
+  // Raw index data, size() * width() bytes, e.g. for uploading to the GPU.
+  const void* data() const noexcept { return bytes_.data(); }
+
+  // Copies the indices into a vector of IntT, which must be at least as
+  // wide as width().
+  template <typename IntT>
+  std::vector<IntT> ToVector() const {
+    static_assert(std::is_integral<IntT>::value, "index must be integral");
+    if (sizeof(IntT) < width_) {
+      throw std::runtime_error("index type too narrow for index buffer");
+    }
+    auto indices = std::vector<IntT>(size_);
+    for (auto i = std::size_t{0}; i < size_; ++i) {
+      indices[i] = static_cast<IntT>((*this)[i]);
+    }
+    return indices;
+  }
+
+  // Releases memory reserved beyond size().
+  void shrink_to_fit() { bytes_.shrink_to_fit(); }
+
+ private:
+  template <typename T>
+  T Load(const std::size_t i) const noexcept {
+    auto value = T{};
+    std::memcpy(&value, bytes_.data() + i * sizeof(T), sizeof(T));
+    return value;
+  }
+
+  void Store(const std::size_t i, const std::uint32_t index) noexcept {
+    auto* const dst = bytes_.data() + i * width_;
+    switch (width_) {
+      case 1:
+        *dst = static_cast<std::uint8_t>(index);
+        break;
+      case 2: {
+        const auto value = static_cast<std::uint16_t>(index);
+        std::memcpy(dst, &value, sizeof(value));
+        break;
+      }
+      default:
+        std::memcpy(dst, &index, sizeof(index));
+        break;
+    }
+  }
+
+  void Widen(const std::uint32_t width) {
+    auto widened = ObjIndexBuffer{};
+    widened.width_ = width;
+    widened.bytes_.reserve(std::max(bytes_.capacity() / width_ * width,
+                                    (size_ + 1) * width));
+    widened.bytes_.resize(size_ * width);
+    for (auto i = std::size_t{0}; i < size_; ++i) {
+      widened.Store(i, (*this)[i]);
+    }
+    widened.size_ = size_;
+    *this = std::move(widened);
+  }
+
+  std::vector<std::uint8_t> bytes_;
+  std::size_t size_ = 0;
+  std::uint32_t width_ = 1;
+};
+
+// Returns an add function that appends the (position) indices of faces of
+// type FaceT to |index_buffer|, suitable for passing to ReadObj as
+// |add_face|. Use ObjIndexGroupUnifier first for index group faces with
+// more than one attribute. Throws if an index does not fit in 32 bits,
+// which is only possible for wider index types.
+template <typename FaceT>
+auto MakeObjIndexBufferAddFunc(ObjIndexBuffer* const index_buffer) {
+  return MakeObjAddFunc<FaceT>([index_buffer](const FaceT& face) {
+    for (const auto& index : face.values) {
+      const auto value = static_cast<std::uint64_t>(
+          obj_io_internal::PositionIndexValue(index));
+      if (value > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("index does not fit in 32 bits");
+      }
+      index_buffer->push_back(static_cast<std::uint32_t>(value));
+    }
+  });
+}
+
+
+// Faces in compressed sparse row form: the indices of face i are stored in
+// [face_offsets[i], face_offsets[i + 1]) of the index arrays. Index group
+// faces are split per attribute, texture coordinate and normal indices are
+// empty if the faces have none.
+template <typename IntT>
+struct ObjCsrFaces {
+  std::vector<std::uint32_t> face_offsets;
+  std::vector<IntT> position_indices;
+  std::vector<IntT> tex_coord_indices;
+  std::vector<IntT> normal_indices;
+};
+
+// Builds ObjCsrFaces face by face, typically while reading (see
+// MakeObjCsrAddFunc). Arrays grow in blocks of at least a million elements
+// and are trimmed once, in Release.
+template <typename IntT>
+class ObjCsrFaceBuilder {
+ public:
+  explicit ObjCsrFaceBuilder(const std::size_t expected_face_count = 0,
+                             const std::size_t expected_index_count = 0) {
+    reserve(expected_face_count, expected_index_count);
+    faces_.face_offsets.push_back(0);
+  }
+
+  // Presizes the arrays, e.g. from the counts returned by ProbeObj. Texture
+  // coordinate and normal indices are reserved as soon as the first face
+  // shows that they are present.
+  void reserve(const std::size_t face_count, const std::size_t index_count) {
+    faces_.face_offsets.reserve(face_count + 1);
+    faces_.position_indices.reserve(index_count);
+  }
+
+  void Add(const ObjIndex<IntT>* const first,
+           const ObjIndex<IntT>* const last) {
+    const auto n = static_cast<std::size_t>(last - first);
+    Grow(&faces_.position_indices, n);
+    for (auto index = first; index != last; ++index) {
+      faces_.position_indices.push_back(index->value);
+    }
+    AddOffset();
+  }
+
+  void Add(const ObjIndexGroup<IntT>* const first,
+           const ObjIndexGroup<IntT>* const last) {
+    if (first == last) {
+      AddOffset();
+      return;
+    }
+
+    // Texture coordinate and normal indices must be given for all corners
+    // or for none, so that the index arrays line up.
+    if (faces_.face_offsets.size() == 1) {
+      has_tex_coords_ = first->tex_coord_index.second;
+      has_normals_ = first->normal_index.second;
+      const auto capacity = faces_.position_indices.capacity();
+      if (has_tex_coords_) {
+        faces_.tex_coord_indices.reserve(capacity);
+      }
+      if (has_normals_) {
+        faces_.normal_indices.reserve(capacity);
+      }
+    }
+    const auto n = static_cast<std::size_t>(last - first);
+    Grow(&faces_.position_indices, n);
+    if (has_tex_coords_) {
+      Grow(&faces_.tex_coord_indices, n);
+    }
+    if (has_normals_) {
+      Grow(&faces_.normal_indices, n);
+    }
+    for (auto index_group = first; index_group != last; ++index_group) {
+      if (index_group->tex_coord_index.second != has_tex_coords_ ||
+          index_group->normal_index.second != has_normals_) {
+        throw std::runtime_error(
+            "all face corners must have the same index group layout");
+      }
+      faces_.position_indices.push_back(index_group->position_index.value);
+      if (has_tex_coords_) {
+        faces_.tex_coord_indices.push_back(
+            index_group->tex_coord_index.first.value);
+      }
+      if (has_normals_) {
+        faces_.normal_indices.push_back(index_group->normal_index.first.value);
+      }
+    }
+    AddOffset();
+  }
+
+  template <typename FaceT>
+  void AddFace(const FaceT& face) {
+    static_assert(obj_io_internal::IsFace<FaceT>::value,
+                  "face must be a face type");
+    Add(face.values.data(), face.values.data() + face.values.size());
+  }
+
+  const ObjCsrFaces<IntT>& faces() const noexcept { return faces_; }
+
+  // Moves the trimmed arrays out of the builder, leaving it empty.
+  ObjCsrFaces<IntT> Release() {
+    faces_.face_offsets.shrink_to_fit();
+    faces_.position_indices.shrink_to_fit();
+    faces_.tex_coord_indices.shrink_to_fit();
+    faces_.normal_indices.shrink_to_fit();
+    auto faces = std::move(faces_);
+    *this = ObjCsrFaceBuilder{};
+    return faces;
+  }
+
+ private:
+  static void Grow(std::vector<IntT>* const values, const std::size_t n) {
+    constexpr auto kBlockSize = std::size_t{1} << 20;
+    if (values->size() + n > values->capacity()) {
+      values->reserve(std::max(values->size() + n,
+                               values->capacity() +
+                                   std::max(values->capacity(), kBlockSize)));
+    }
+  }
+
+  void AddOffset() {
+    const auto offset = faces_.position_indices.size();
+    if (offset > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::runtime_error("face index count does not fit face offsets");
+    }
+    auto& offsets = faces_.face_offsets;
+    if (offsets.size() == offsets.capacity()) {
+      offsets.reserve(offsets.size() + std::max(offsets.size(),
+                                                std::size_t{1} << 20));
+    }
+    offsets.push_back(static_cast<std::uint32_t>(offset));
+  }
+
+  ObjCsrFaces<IntT> faces_;
+  bool has_tex_coords_ = false;
+  bool has_normals_ = false;
+};
+
+namespace obj_io_internal {
+
+template <typename IndexT>
+class CsrAddFunc {
+ public:
+  using IntT = decltype(PositionIndexValue(std::declval<IndexT>()));
+
+  explicit CsrAddFunc(ObjCsrFaceBuilder<IntT>* const builder)
+      : builder_(builder) {}
+
+  // Called by the reader with the parsed face indices.
+  void Append(const IndexT* const first, const IndexT* const last) {
+    builder_->Add(first, last);
+  }
+
+  void operator()(const ObjPolygonFace<IndexT>& face) {
+    builder_->AddFace(face);
+  }
+
+ private:
+  ObjCsrFaceBuilder<IntT>* builder_;
+};
+
+}  // namespace obj_io_internal
+
+// Returns an add function for polygon faces with indices of type IndexT
+// (ObjIndex or ObjIndexGroup) that appends to |builder|, suitable for
+// passing to ReadObj as |add_face|. The reader appends the parsed indices
+// directly, without creating a face object per face.
+template <typename IndexT, typename IntT>
+ObjAddFunc<ObjPolygonFace<IndexT>, obj_io_internal::CsrAddFunc<IndexT>>
+MakeObjCsrAddFunc(ObjCsrFaceBuilder<IntT>* const builder) {
+  using AddFuncType = obj_io_internal::CsrAddFunc<IndexT>;
+  static_assert(std::is_same<IntT, typename AddFuncType::IntT>::value,
+                "index type must match builder");
+  return {AddFuncType(builder)};
+}
+
+// Face lines recorded by a lazy read (see MakeObjLazyFaceAddFunc), to be
+// parsed on demand with DecodeObjFaces. The text of the lines, without the
+// face prefix, is packed into a single arena.
+class ObjLazyFaces {
+ public:
+  ObjLazyFaces() : offsets_(1, 0) {}
+
+  // Adds a face given by the text following the face prefix.
+  void Add(const char* const first, const char* const last) {
+    text_.append(first, last);
+    offsets_.push_back(text_.size());
+  }
+
+  std::size_t size() const noexcept { return offsets_.size() - 1; }
+  bool empty() const noexcept { return size() == 0; }
+
+  // Text of face |i|, e.g. " 1/1 2/2 3/3".
+  std::string FaceText(const std::size_t i) const {
+    auto text = std::string{};
+    FaceText(i, &text);
+    return text;
+  }
+
+  // Assigns the text of face |i| to |text|, reusing its buffer.
+  void FaceText(const std::size_t i, std::string* const text) const {
+    text->assign(text_, static_cast<std::size_t>(offsets_[i]),
+                 static_cast<std::size_t>(offsets_[i + 1] - offsets_[i]));
+  }
+
+ private:
+  std::string text_;
+  std::vector<std::uint64_t> offsets_;
+};
+
+namespace obj_io_internal {
+
+class LazyFaceAddFunc {
+ public:
+  explicit LazyFaceAddFunc(ObjLazyFaces* const faces) : faces_(faces) {}
+
+  // Called by the reader with the text of a face line.
+  void Append(const char* const first, const char* const last) {
+    faces_->Add(first, last);
+  }
+
+ private:
+  ObjLazyFaces* faces_;
+};
+
+}  // namespace obj_io_internal
+
+// Returns a face add function for ReadObj that records face lines in
+// |faces| instead of parsing them, so that the read only parses vertex
+// data. Welding and normal generation are not supported, and triangulation
+// is done by DecodeObjFaces.
+inline ObjAddFunc<ObjPolygonFace<ObjIndex<std::uint32_t>>,
+                  obj_io_internal::LazyFaceAddFunc>
+MakeObjLazyFaceAddFunc(ObjLazyFaces* const faces) {
+  return {obj_io_internal::LazyFaceAddFunc(faces)};
+}
+
+// Parses the faces [begin, end) of |faces| and passes them on to |add_face|,
+// which is used as for ReadObj. options.triangulation applies, except ear
+// clipping, which needs the positions. With options.thread_count other
+// than one the faces are parsed by several threads, but |add_face| is
+// still called from the calling thread in face order, also for the faces
+// before a face that fails to parse. Returns the number of faces passed
+// on.
+template <typename AddFaceFuncT>
+std::uint32_t DecodeObjFaces(const ObjLazyFaces& faces,
+                             const std::size_t begin, const std::size_t end,
+                             AddFaceFuncT&& add_face,
+                             const ObjReadOptions& options = ObjReadOptions{}) {
+  using FaceType = typename std::decay<AddFaceFuncT>::type::ParseType;
+  using StateType = obj_io_internal::read::ReadState<
+      obj_io_internal::FaceIndexType<FaceType>>;
+  using AddCategory =
+      typename obj_io_internal::AddFaceTraits<AddFaceFuncT>::AddCategory;
+  static_assert(!std::is_same<AddCategory, obj_io_internal::LazyAddTag>::value,
+                "lazy faces cannot be decoded into lazy faces");
+  constexpr auto kChunkSize = std::size_t{1} << 14;
+
+  if (!(begin <= end && end <= faces.size())) {
+    auto oss = std::ostringstream{};
+    oss << "invalid face range [" << begin << ", " << end << ") (found "
+        << faces.size() << " faces)";
+    throw std::runtime_error(oss.str());
+  }
+  if (options.weld_positions || options.weld_map != nullptr ||
+      options.generate_normals != ObjNormalGeneration::kNone) {
+    throw std::runtime_error(
+        "lazy faces do not support welding or normal generation");
+  }
+  if (options.triangulation == ObjTriangulation::kEarClip) {
+    throw std::runtime_error("ear clipping is not supported for lazy faces");
+  }
+  const obj_io_internal::trace::CallScope trace_scope(options.trace);
+
+  const auto decode = [&faces](const std::size_t first,
+                               const std::size_t last,
+                               auto&& add, StateType* const state,
+                               std::uint32_t* const count) {
+    obj_io_internal::trace::Span span("decode faces");
+    span.Arg("faces", last - first);
+    auto& iss = state->line_stream;
+    auto text = std::string{};
+    for (auto i = first; i < last; ++i) {
+      faces.FaceText(i, &text);
+      iss.clear();
+      iss.str(text);
+      if (!obj_io_internal::read::ParseFace(&iss, add, state, count)) {
+        throw std::runtime_error(state->error.message);
+      }
+    }
+  };
+
+  auto count = std::uint32_t{0};
+  const auto thread_count = obj_io_internal::ThreadCount(options.thread_count);
+  if (thread_count == 1 || end - begin <= kChunkSize) {
+    auto state = StateType(options);
+    decode(begin, end, add_face, &state, &count);
+    return count;
+  }
+
+  // Rounds of one chunk per thread. Chunks are parsed into face buffers,
+  // which are then passed on in order; a chunk that fails passes on the
+  // faces before the error and the error is re-thrown.
+  struct Chunk {
+    std::vector<FaceType> faces;
+    std::exception_ptr error;
+  };
+  auto chunks = std::vector<Chunk>(thread_count);
+  for (auto round_begin = begin; round_begin < end;
+       round_begin += thread_count * kChunkSize) {
+    const auto round_end =
+        std::min(end, round_begin + thread_count * kChunkSize);
+    obj_io_internal::ParallelFor(
+        round_end - round_begin, thread_count,
+        [&](const std::size_t chunk_begin, const std::size_t chunk_end,
+            const std::size_t chunk_index) {
+          auto& chunk = chunks[chunk_index];
+          chunk.faces.clear();
+          chunk.error = nullptr;
+          auto state = StateType(options);
+          auto chunk_count = std::uint32_t{0};
+          try {
+            decode(round_begin + chunk_begin, round_begin + chunk_end,
+                   MakeObjAddFunc<FaceType>([&chunk](const auto& face) {
+                     chunk.faces.push_back(face);
+                   }),
+                   &state, &chunk_count);
+          } catch (...) {
+            chunk.error = std::current_exception();
+          }
+        });
+    for (auto& chunk : chunks) {
+      obj_io_internal::trace::Span span("deliver faces");
+      span.Arg("faces", chunk.faces.size());
+      for (const auto& face : chunk.faces) {
+        obj_io_internal::read::DeliverFace(add_face, face, AddCategory{});
+        ++count;
+      }
+      chunk.faces.clear();
+      if (chunk.error) {
+        std::rethrow_exception(chunk.error);
+      }
+    }
+  }
+  return count;
+}
+
+// Allocator returning memory aligned to |Alignment| bytes, e.g. for SIMD
+// loads or cache line aligned arrays.
+template <typename T, std::size_t Alignment = 64>
+class ObjAlignedAllocator {
+  static_assert(Alignment >= alignof(void*) &&
+                    (Alignment & (Alignment - 1)) == 0,
+                "alignment must be a power of two");
+
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = ObjAlignedAllocator<U, Alignment>;
+  };
+
+  ObjAlignedAllocator() noexcept = default;
+
+  template <typename U>
+  ObjAlignedAllocator(const ObjAlignedAllocator<U, Alignment>&) noexcept {}
+
+  T* allocate(const std::size_t n) {
+    if (n > (std::numeric_limits<std::size_t>::max() - Alignment -
+             sizeof(void*)) / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+
+    // Over-allocate and keep the original pointer just before the aligned
+    // block.
+    auto* const raw = ::operator new(n * sizeof(T) + Alignment + sizeof(void*));
+    const auto address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+    auto* const aligned = reinterpret_cast<void*>(
+        (address + Alignment - 1) & ~std::uintptr_t{Alignment - 1});
+    static_cast<void**>(aligned)[-1] = raw;
+    return static_cast<T*>(aligned);
+  }
+
+  void deallocate(T* const p, const std::size_t) noexcept {
+    ::operator delete(reinterpret_cast<void**>(p)[-1]);
+  }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(const ObjAlignedAllocator<T, Alignment>&,
+                const ObjAlignedAllocator<U, Alignment>&) noexcept {
+  return true;
+}
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(const ObjAlignedAllocator<T, Alignment>&,
+                const ObjAlignedAllocator<U, Alignment>&) noexcept {
+  return false;
+}
+
+template <typename T>
+using ObjAlignedVector = std::vector<T, ObjAlignedAllocator<T>>;
+
+// Triangle mesh with one (64-byte aligned) array per attribute component.
+// Faces are stored as three corners per triangle, polygons are fan
+// triangulated. Each corner has a position index and, if the faces in the
+// file have them, a texture coordinate index and a normal index; otherwise
+// those index arrays are empty. Only the first two texture coordinate
+// components are kept, as are the first three position components.
+struct ObjSoAMesh {
+  ObjAlignedVector<float> x;
+  ObjAlignedVector<float> y;
+  ObjAlignedVector<float> z;
+
+  ObjAlignedVector<float> u;
+  ObjAlignedVector<float> v;
+
+  ObjAlignedVector<float> nx;
+  ObjAlignedVector<float> ny;
+  ObjAlignedVector<float> nz;
+
+  ObjAlignedVector<std::uint32_t> position_indices;
+  ObjAlignedVector<std::uint32_t> tex_coord_indices;
+  ObjAlignedVector<std::uint32_t> normal_indices;
+};
+
+namespace obj_io_internal {
+namespace soa {
+
+class Handler {
+ public:
+  explicit Handler(ObjSoAMesh* const mesh) : mesh_(mesh) {}
+
+  void Position(const std::array<double, 4>& values, std::uint32_t) {
+    mesh_->x.push_back(static_cast<float>(values[0]));
+    mesh_->y.push_back(static_cast<float>(values[1]));
+    mesh_->z.push_back(static_cast<float>(values[2]));
+  }
+
+  void TexCoord(const std::array<double, 3>& values, std::uint32_t) {
+    mesh_->u.push_back(static_cast<float>(values[0]));
+    mesh_->v.push_back(static_cast<float>(values[1]));
+  }
+
+  void Normal(const std::array<double, 3>& values) {
+    mesh_->nx.push_back(static_cast<float>(values[0]));
+    mesh_->ny.push_back(static_cast<float>(values[1]));
+    mesh_->nz.push_back(static_cast<float>(values[2]));
+  }
+
+  void Face(const std::vector<scan::Corner>& corners) {
+    // Texture coordinate and normal indices must be given for all corners
+    // or for none, so that the index arrays line up.
+    if (!has_face_) {
+      has_face_ = true;
+      has_tex_coords_ = corners[0].has_tex_coord;
+      has_normals_ = corners[0].has_normal;
+
+      // Presized position indices (if probed) tell the final size.
+      const auto capacity = mesh_->position_indices.capacity();
+      if (has_tex_coords_) {
+        mesh_->tex_coord_indices.reserve(capacity);
+      }
+      if (has_normals_) {
+        mesh_->normal_indices.reserve(capacity);
+      }
+    }
+    for (const auto& corner : corners) {
+      if (corner.has_tex_coord != has_tex_coords_ ||
+          corner.has_normal != has_normals_) {
+        throw std::runtime_error("all face corners must have the same index "
+                                 "group layout");
+      }
+    }
+
+    triangulate::Fan(corners.size(), [this, &corners](const std::size_t a,
+                                                      const std::size_t b,
+                                                      const std::size_t c) {
+      AddCorner(corners[a]);
+      AddCorner(corners[b]);
+      AddCorner(corners[c]);
+    });
+  }
+
+  void SmoothingGroup(std::uint32_t) {}
+
+ private:
+  void AddCorner(const scan::Corner& corner) {
+    using read::ToZeroBasedIndex;
+    mesh_->position_indices.push_back(
+        ToZeroBasedIndex<std::uint32_t>(corner.position));
+    if (has_tex_coords_) {
+      mesh_->tex_coord_indices.push_back(
+          ToZeroBasedIndex<std::uint32_t>(corner.tex_coord));
+    }
+    if (has_normals_) {
+      mesh_->normal_indices.push_back(
+          ToZeroBasedIndex<std::uint32_t>(corner.normal));
+    }
+  }
+
+  ObjSoAMesh* mesh_;
+  bool has_face_ = false;
+  bool has_tex_coords_ = false;
+  bool has_normals_ = false;
+};
+
+}  // namespace soa
+}  // namespace obj_io_internal
+
+// Reads |is| into an ObjSoAMesh. The file is parsed in large blocks
+// straight into the attribute arrays, without any per-element callbacks.
+// If |is| is seekable it is probed first so that every array is allocated
+// once at its final size.
+inline ObjSoAMesh ReadObjToSoA(std::istream& is) {
+  auto mesh = ObjSoAMesh{};
+  if (is.tellg() != std::istream::pos_type(-1)) {
+    const auto probe = ProbeObj(is);
+    mesh.x.reserve(probe.position_count);
+    mesh.y.reserve(probe.position_count);
+    mesh.z.reserve(probe.position_count);
+    mesh.u.reserve(probe.tex_coord_count);
+    mesh.v.reserve(probe.tex_coord_count);
+    mesh.nx.reserve(probe.normal_count);
+    mesh.ny.reserve(probe.normal_count);
+    mesh.nz.reserve(probe.normal_count);
+
+    // A face with k corners is split into k - 2 triangles.
+    const auto corner_count = static_cast<std::size_t>(
+        probe.face_index_count >= 2 * std::uint64_t{probe.face_count}
+            ? 3 * (probe.face_index_count - 2 * std::uint64_t{probe.face_count})
+            : 0);
+    mesh.position_indices.reserve(corner_count);
+  } else {
+    is.clear();
+  }
+
+  auto handler = obj_io_internal::soa::Handler(&mesh);
+  auto parser = obj_io_internal::scan::LineParser<
+      obj_io_internal::soa::Handler>(&handler);
+  obj_io_internal::scan::ForEachLine(
+      is, [&parser](const char* const first, const char* const last) {
+        parser.ParseLine(first, last);
+      });
+  return mesh;
+}
+
+enum class ObjComponentType {
+  // 32-bit IEEE float.
+  kFloat32,
+  // 16-bit IEEE half float, rounded to nearest even.
+  kFloat16,
+  // 16-bit signed integer mapping [-1, 1] to [-32767, 32767].
+  kSnorm16,
+  // 16-bit unsigned integer mapping [0, 1] to [0, 65535].
+  kUnorm16,
+  // Normals only: unit vector mapped to the octahedron and stored as two
+  // snorm16 values (4 bytes per normal).
+  kOctahedral16,
+  // Positions only: 16-bit unsigned integer mapping
+  // [ObjVertexLayout::position_bounds.min, max] to [0, 65535] per axis.
+  kFixed16
+};
+
+// Axis aligned bounds of positions, see ProbeObjPositionBounds.
+struct ObjPositionBounds {
+  std::array<float, 3> min;
+  std::array<float, 3> max;
+};
+
+// Returns the bounds of the positions in |is|, e.g. for fixed point
+// position encoding. Only position lines are parsed. The stream must be
+// seekable, it is restored to its initial position before returning. The
+// bounds are empty (min greater than max) if there are no positions.
+inline ObjPositionBounds ProbeObjPositionBounds(std::istream& is) {
+  const auto start = is.tellg();
+  if (start == std::istream::pos_type(-1)) {
+    throw std::runtime_error("probing requires a seekable stream");
+  }
+
+  namespace scan = obj_io_internal::scan;
+  auto bounds = ObjPositionBounds{};
+  bounds.min.fill(std::numeric_limits<float>::max());
+  bounds.max.fill(std::numeric_limits<float>::lowest());
+  scan::ForEachLine(
+      is, [&bounds](const char* p, const char* const last) {
+        p = scan::SkipSpace(p, last);
+        if (last - p < 2 || p[0] != 'v' || !scan::IsSpace(p[1])) {
+          return;
+        }
+        auto values = std::array<double, 4>{};
+        const auto count = scan::ParseReals(p + 1, last, &values);
+        for (auto i = std::size_t{0}; i < std::min(count, 3u); ++i) {
+          const auto value = static_cast<float>(values[i]);
+          bounds.min[i] = std::min(bounds.min[i], value);
+          bounds.max[i] = std::max(bounds.max[i], value);
+        }
+      });
+
+  is.clear();
+  is.seekg(start);
+  return bounds;
+}
+
+// Placement of one vertex attribute within an interleaved vertex.
+struct ObjVertexAttribute {
+  bool enabled = false;
+  // Byte offset from the start of the vertex.
+  std::size_t offset = 0;
+  ObjComponentType type = ObjComponentType::kFloat32;
+};
+
+// Describes a user-provided buffer of interleaved vertices, e.g. a mapped
+// GPU staging buffer. Vertex i starts at |data| + i * |stride|. Positions
+// and normals have three components, texture coordinates two.
+struct ObjVertexLayout {
+  void* data = nullptr;
+  std::size_t stride = 0;
+  // Maximum number of vertices that fit in |data|. The number of face
+  // corners (ObjProbeResult::face_index_count) is always enough.
+  std::size_t vertex_capacity = 0;
+
+  ObjVertexAttribute position;
+  ObjVertexAttribute tex_coord;
+  ObjVertexAttribute normal;
+
+  // Only used for ObjComponentType::kFixed16 positions, positions outside
+  // the bounds are clamped. Empty bounds (min greater than max, as probed
+  // from input without positions) encode all positions as zero.
+  ObjPositionBounds position_bounds = {};
+};
+
+struct ObjInterleavedResult {
+  std::uint32_t vertex_count;
+  std::uint32_t position_count;
+  std::uint32_t face_count;  // Triangles.
+  std::uint32_t tex_coord_count;
+  std::uint32_t normal_count;
+};
+
+namespace obj_io_internal {
+namespace convert {
+
+// Converts |value| to IEEE half float bits, rounding to nearest even.
+inline std::uint16_t FloatToHalf(const float value) noexcept {
+  auto bits = std::uint32_t{0};
+  std::memcpy(&bits, &value, sizeof(bits));
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+  const auto abs_bits = bits & 0x7fffffffu;
+
+  if (abs_bits >= 0x7f800000u) {
+    // Infinity or NaN, keep NaN quiet.
+    return static_cast<std::uint16_t>(
+        sign | 0x7c00u | (abs_bits > 0x7f800000u ? 0x0200u : 0u));
+  }
+  if (abs_bits >= 0x477ff000u) {
+    return static_cast<std::uint16_t>(sign | 0x7c00u);  // Overflow.
+  }
+  if (abs_bits < 0x38800000u) {
+    // Subnormal half (or zero): shift the mantissa, with implicit bit, into
+    // place and round to nearest even.
+    if (abs_bits < 0x33000000u) {
+      return sign;  // Rounds to zero.
+    }
+    const auto exponent = abs_bits >> 23;
+    const auto mantissa = (abs_bits & 0x7fffffu) | 0x800000u;
+    const auto shift = 126u - exponent;
+    auto half = mantissa >> shift;
+    const auto remainder = mantissa & ((1u << shift) - 1u);
+    const auto halfway = 1u << (shift - 1u);
+    if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+      ++half;
+    }
+    return static_cast<std::uint16_t>(sign | half);
+  }
+
+  // Normal half: rebias the exponent and round the mantissa to nearest
+  // even, a carry into the exponent is correct.
+  auto half = ((abs_bits - 0x38000000u) >> 13);
+  const auto remainder = abs_bits & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    ++half;
+  }
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+inline float HalfToFloat(const std::uint16_t half) noexcept {
+  const auto sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+  const auto exponent = (half >> 10) & 0x1fu;
+  auto mantissa = static_cast<std::uint32_t>(half & 0x3ffu);
+  auto bits = std::uint32_t{0};
+  if (exponent == 0x1fu) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+  } else if (mantissa != 0) {
+    // Subnormal half, normalize.
+    auto e = 113u;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      --e;
+    }
+    bits = sign | (e << 23) | ((mantissa & 0x3ffu) << 13);
+  } else {
+    bits = sign;
+  }
+  auto value = 0.f;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline std::int16_t ToSnorm16(const double value) noexcept {
+  const auto clamped = std::max(-1.0, std::min(1.0, value));
+  return static_cast<std::int16_t>(std::lround(clamped * 32767.0));
+}
+
+inline std::uint16_t ToUnorm16(const double value) noexcept {
+  const auto clamped = std::max(0.0, std::min(1.0, value));
+  return static_cast<std::uint16_t>(std::lround(clamped * 65535.0));
+}
+
+// Octahedral encoding of a unit vector, the components are in [-1, 1].
+inline std::array<double, 2> OctahedralProject(
+    const std::array<double, 3>& n) noexcept {
+  const auto l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+  if (!(l1 > 0.0)) {
+    return {{0.0, 0.0}};
+  }
+  const auto x = n[0] / l1;
+  const auto y = n[1] / l1;
+  if (n[2] >= 0.0) {
+    return {{x, y}};
+  }
+  return {{(1.0 - std::abs(y)) * (x >= 0.0 ? 1.0 : -1.0),
+           (1.0 - std::abs(x)) * (y >= 0.0 ? 1.0 : -1.0)}};
+}
+
+// Decodes two snorm16 values to a unit vector.
+inline std::array<double, 3> OctahedralDecode(
+    const std::array<std::int16_t, 2>& encoded) noexcept {
+  const auto x = std::max(-1.0, encoded[0] / 32767.0);
+  const auto y = std::max(-1.0, encoded[1] / 32767.0);
+  auto n = std::array<double, 3>{{x, y, 1.0 - std::abs(x) - std::abs(y)}};
+  if (n[2] < 0.0) {
+    n[0] = (1.0 - std::abs(y)) * (x >= 0.0 ? 1.0 : -1.0);
+    n[1] = (1.0 - std::abs(x)) * (y >= 0.0 ? 1.0 : -1.0);
+  }
+  const auto length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  return {{n[0] / length, n[1] / length, n[2] / length}};
+}
+
+// Encodes a normal as two snorm16 values. Of the four quantized neighbors
+// of the projected point, the one that decodes closest to the (normalized)
+// input is chosen, which roughly halves the worst case angular error
+// compared to rounding.
+inline std::array<std::int16_t, 2> OctahedralEncode(
+    const std::array<double, 3>& normal) noexcept {
+  const auto length = std::sqrt(normal[0] * normal[0] +
+                                normal[1] * normal[1] + normal[2] * normal[2]);
+  if (!(length > 0.0)) {
+    return {{0, 0}};
+  }
+  const auto n = std::array<double, 3>{
+      {normal[0] / length, normal[1] / length, normal[2] / length}};
+  const auto p = OctahedralProject(n);
+  const auto fx = std::floor(p[0] * 32767.0);
+  const auto fy = std::floor(p[1] * 32767.0);
+
+  auto best = std::array<std::int16_t, 2>{};
+  auto best_dot = -2.0;
+  for (auto dy = 0; dy < 2; ++dy) {
+    for (auto dx = 0; dx < 2; ++dx) {
+      const auto candidate = std::array<std::int16_t, 2>{
+          {static_cast<std::int16_t>(
+               std::max(-32767.0, std::min(32767.0, fx + dx))),
+           static_cast<std::int16_t>(
+               std::max(-32767.0, std::min(32767.0, fy + dy)))}};
+      const auto decoded = OctahedralDecode(candidate);
+      const auto dot =
+          decoded[0] * n[0] + decoded[1] * n[1] + decoded[2] * n[2];
+      if (dot > best_dot) {
+        best_dot = dot;
+        best = candidate;
+      }
+    }
+  }
+  return best;
+}
+
+inline std::uint16_t ToFixed16(const double value, const double min,
+                               const double max) noexcept {
+  const auto extent = max - min;
+  return extent > 0.0 ? ToUnorm16((value - min) / extent) : 0;
+}
+
+// Size in bytes of an attribute with |component_count| components stored
+// as |type|.
+inline std::size_t EncodedSize(const ObjComponentType type,
+                               const std::size_t component_count) noexcept {
+  switch (type) {
+    case ObjComponentType::kFloat32:
+      return 4 * component_count;
+    case ObjComponentType::kOctahedral16:
+      return 4;
+    default:
+      return 2 * component_count;
+  }
+}
+
+// Writes |values| to |dst| as |type|. Octahedral encoding only applies to
+// three components, fixed point only to values with |bounds|.
+template <std::size_t N>
+void Encode(const std::array<double, N>& values, const ObjComponentType type,
+            const ObjPositionBounds& bounds, char* const dst) noexcept {
+  if (type == ObjComponentType::kOctahedral16) {
+    auto normal = std::array<double, 3>{};
+    std::copy(values.begin(), values.begin() + std::min<std::size_t>(N, 3),
+              normal.begin());
+    const auto encoded = OctahedralEncode(normal);
+    std::memcpy(dst, encoded.data(), 4);
+    return;
+  }
+  for (auto i = std::size_t{0}; i < N; ++i) {
+    switch (type) {
+      case ObjComponentType::kFloat32: {
+        const auto value = static_cast<float>(values[i]);
+        std::memcpy(dst + 4 * i, &value, 4);
+        break;
+      }
+      case ObjComponentType::kFloat16: {
+        const auto half = FloatToHalf(static_cast<float>(values[i]));
+        std::memcpy(dst + 2 * i, &half, 2);
+        break;
+      }
+      case ObjComponentType::kSnorm16: {
+        const auto snorm = ToSnorm16(values[i]);
+        std::memcpy(dst + 2 * i, &snorm, 2);
+        break;
+      }
+      case ObjComponentType::kUnorm16: {
+        const auto unorm = ToUnorm16(values[i]);
+        std::memcpy(dst + 2 * i, &unorm, 2);
+        break;
+      }
+      case ObjComponentType::kFixed16: {
+        const auto fixed =
+            ToFixed16(values[i], bounds.min[i % 3], bounds.max[i % 3]);
+        std::memcpy(dst + 2 * i, &fixed, 2);
+        break;
+      }
+      case ObjComponentType::kOctahedral16:
+        break;
+    }
+  }
+}
+
+}  // namespace convert
+
+namespace interleave {
+
+// Attribute values already encoded to the destination component type.
+class EncodedValues {
+ public:
+  EncodedValues(const ObjVertexAttribute& attribute,
+                const std::size_t component_count)
+      : type_(attribute.type),
+        size_(attribute.enabled
+                  ? convert::EncodedSize(attribute.type, component_count)
+                  : 0) {}
+
+  template <std::size_t N>
+  void Add(const std::array<double, N>& values,
+           const ObjPositionBounds& bounds) {
+    bytes_.resize(bytes_.size() + size_);
+    if (size_ > 0) {
+      convert::Encode(values, type_, bounds, &bytes_[bytes_.size() - size_]);
+    }
+    ++count_;
+  }
+
+  // Copies the value at |index| to |dst|, or zeros if |has_index| is false.
+  void CopyTo(const bool has_index, const std::uint32_t index,
+              const char* const name, char* const dst) const {
+    if (!has_index) {
+      std::memset(dst, 0, size_);
+      return;
+    }
+    if (!(index < count_)) {
+      auto oss = std::ostringstream{};
+      oss << name << " index " << index + 1 << " out of range (found "
+          << count_ << " " << name << "s)";
+      throw std::runtime_error(oss.str());
+    }
+    std::memcpy(dst, &bytes_[index * size_], size_);
+  }
+
+ private:
+  ObjComponentType type_;
+  std::size_t size_;
+  std::size_t count_ = 0;
+  std::vector<char> bytes_;
+};
+
+// Unifies face corners into vertices as faces are parsed and writes each
+// new vertex straight into the destination buffer. Attributes are encoded
+// to their destination types as they are parsed and kept in that form,
+// since faces may reference any attribute read before them.
+class Handler {
+ public:
+  Handler(const ObjVertexLayout& layout, std::vector<std::uint32_t>* indices,
+          ObjInterleavedResult* const result)
+      : layout_(layout),
+        indices_(indices),
+        result_(result),
+        positions_(layout.position, 3),
+        tex_coords_(layout.tex_coord, 2),
+        normals_(layout.normal, 3) {}
+
+  void Position(const std::array<double, 4>& values, std::uint32_t) {
+    positions_.Add(std::array<double, 3>{{values[0], values[1], values[2]}},
+                   layout_.position_bounds);
+    ++result_->position_count;
+  }
+
+  void TexCoord(const std::array<double, 3>& values, std::uint32_t) {
+    tex_coords_.Add(std::array<double, 2>{{values[0], values[1]}},
+                    layout_.position_bounds);
+    ++result_->tex_coord_count;
+  }
+
+  void Normal(const std::array<double, 3>& values) {
+    normals_.Add(values, layout_.position_bounds);
+    ++result_->normal_count;
+  }
+
+  void Face(const std::vector<scan::Corner>& corners) {
+    vertices_.clear();
+    for (const auto& corner : corners) {
+      vertices_.push_back(AddVertex(corner));
+    }
+    triangulate::Fan(vertices_.size(), [this](const std::size_t a,
+                                              const std::size_t b,
+                                              const std::size_t c) {
+      indices_->push_back(vertices_[a]);
+      indices_->push_back(vertices_[b]);
+      indices_->push_back(vertices_[c]);
+      ++result_->face_count;
+    });
+  }
+
+  void SmoothingGroup(std::uint32_t) {}
+
+ private:
+  std::uint32_t AddVertex(const scan::Corner& corner) {
+    using read::ToZeroBasedIndex;
+
+    // Attributes that are not written do not distinguish vertices.
+    auto key = ObjIndexGroup<std::uint32_t>(
+        ToZeroBasedIndex<std::uint32_t>(corner.position));
+    if (layout_.tex_coord.enabled && corner.has_tex_coord) {
+      key.tex_coord_index = std::make_pair(
+          ObjIndex<std::uint32_t>(
+              ToZeroBasedIndex<std::uint32_t>(corner.tex_coord)),
+          true);
+    }
+    if (layout_.normal.enabled && corner.has_normal) {
+      key.normal_index = std::make_pair(
+          ObjIndex<std::uint32_t>(
+              ToZeroBasedIndex<std::uint32_t>(corner.normal)),
+          true);
+    }
+
+    const auto next = static_cast<std::size_t>(result_->vertex_count);
+    const auto vertex = table_.Insert(key, next);
+    if (vertex == next) {
+      WriteVertex(key, next);
+      ++result_->vertex_count;
+    }
+    return static_cast<std::uint32_t>(vertex);
+  }
+
+  // Missing attributes are written as zeros.
+  void WriteVertex(const ObjIndexGroup<std::uint32_t>& key,
+                   const std::size_t vertex) {
+    if (!(vertex < layout_.vertex_capacity)) {
+      auto oss = std::ostringstream{};
+      oss << "vertex count exceeds vertex layout capacity ("
+          << layout_.vertex_capacity << ")";
+      throw std::runtime_error(oss.str());
+    }
+    auto* const dst =
+        static_cast<char*>(layout_.data) + vertex * layout_.stride;
+    if (layout_.position.enabled) {
+      positions_.CopyTo(true, key.position_index.value, "position",
+                        dst + layout_.position.offset);
+    }
+    if (layout_.tex_coord.enabled) {
+      tex_coords_.CopyTo(key.tex_coord_index.second,
+                         key.tex_coord_index.first.value,
+                         "texture coordinate", dst + layout_.tex_coord.offset);
+    }
+    if (layout_.normal.enabled) {
+      normals_.CopyTo(key.normal_index.second, key.normal_index.first.value,
+                      "normal", dst + layout_.normal.offset);
+    }
+  }
+
+  const ObjVertexLayout& layout_;
+  std::vector<std::uint32_t>* indices_;
+  ObjInterleavedResult* result_;
+  EncodedValues positions_;
+  EncodedValues tex_coords_;
+  EncodedValues normals_;
+  unify::IndexGroupTable<std::uint32_t> table_;
+  std::vector<std::uint32_t> vertices_;
+};
+
+// Throws unless |attribute|, if enabled, lies within the vertex stride, so
+// that writing a vertex stays within the vertex.
+inline void ValidateAttribute(const ObjVertexAttribute& attribute,
+                              const std::size_t component_count,
+                              const std::size_t stride,
+                              const char* const name) {
+  if (!attribute.enabled) {
+    return;
+  }
+  const auto size = convert::EncodedSize(attribute.type, component_count);
+  if (attribute.offset > stride || size > stride - attribute.offset) {
+    auto oss = std::ostringstream{};
+    oss << name << " attribute (offset " << attribute.offset << ", size "
+        << size << ") does not fit vertex stride " << stride;
+    throw std::runtime_error(oss.str());
+  }
+}
+
+inline void ValidateLayout(const ObjVertexLayout& layout) {
+  if (layout.data == nullptr && layout.vertex_capacity > 0) {
+    throw std::runtime_error("vertex layout data must not be null");
+  }
+  if (layout.stride == 0 &&
+      (layout.position.enabled || layout.tex_coord.enabled ||
+       layout.normal.enabled)) {
+    throw std::runtime_error("vertex layout stride must not be zero");
+  }
+  if (layout.tex_coord.type == ObjComponentType::kOctahedral16 ||
+      layout.position.type == ObjComponentType::kOctahedral16) {
+    throw std::runtime_error("octahedral encoding only applies to normals");
+  }
+  if (layout.tex_coord.type == ObjComponentType::kFixed16 ||
+      layout.normal.type == ObjComponentType::kFixed16) {
+    throw std::runtime_error("fixed point encoding only applies to positions");
+  }
+  if (layout.position.type == ObjComponentType::kFixed16) {
+    // Empty bounds are fine, ToFixed16 maps them to zero.
+    for (auto i = std::size_t{0}; i < 3; ++i) {
+      if (std::isnan(layout.position_bounds.min[i]) ||
+          std::isnan(layout.position_bounds.max[i])) {
+        throw std::runtime_error("position bounds must not be NaN");
+      }
+    }
+  }
+  ValidateAttribute(layout.position, 3, layout.stride, "position");
+  ValidateAttribute(layout.tex_coord, 2, layout.stride, "texture coordinate");
+  ValidateAttribute(layout.normal, 3, layout.stride, "normal");
+}
+
+}  // namespace interleave
+}  // namespace obj_io_internal
+
+// Reads |is| into the interleaved vertex buffer described by |layout|,
+// converting attributes to the requested component types as they are
+// parsed. Face corners with the same (enabled) attribute indices share a
+// vertex; |indices| receives three vertex indices per triangle, polygons
+// are fan triangulated. Attributes must be read before the faces that
+// reference them.
+inline ObjInterleavedResult ReadObjInterleaved(
+    std::istream& is, const ObjVertexLayout& layout,
+    std::vector<std::uint32_t>* const indices) {
+  if (indices == nullptr) {
+    throw std::runtime_error("indices must not be null");
+  }
+  obj_io_internal::interleave::ValidateLayout(layout);
+  auto result = ObjInterleavedResult{};
+  auto handler = obj_io_internal::interleave::Handler(layout, indices, &result);
+  auto parser = obj_io_internal::scan::LineParser<
+      obj_io_internal::interleave::Handler>(&handler);
+  obj_io_internal::scan::ForEachLine(
+      is, [&parser](const char* const first, const char* const last) {
+        parser.ParseLine(first, last);
+      });
+  return result;
+}
+
+enum class ObjElementType { kPosition, kTexCoord, kNormal, kFace, kGroup };
+
+// Element yielded by ObjElementReader. Which members are valid depends on
+// |type|. Pointers refer to memory owned by the reader or to the input
+// buffer and are valid until the next element is read.
+struct ObjElement {
+  ObjElementType type;
+
+  // Position (3 or 4 values), texture coordinate (2 or 3) or normal (3).
+  std::array<double, 4> values;
+  std::uint32_t value_count;
+
+  // Face corners, zero-based. Missing texture coordinate or normal indices
+  // are flagged as for ObjIndexGroup.
+  const ObjIndexGroup<std::uint32_t>* corners;
+  std::size_t corner_count;
+
+  // Group ('g') or object ('o') name, not null terminated.
+  const char* name;
+  std::size_t name_size;
+};
+
+namespace obj_io_internal {
+namespace elements {
+
+// Fills in the element for the line given to the LineParser.
+class Handler {
+ public:
+  explicit Handler(ObjElement* const element) : element_(element) {}
+
+  void Position(const std::array<double, 4>& values,
+                const std::uint32_t count) {
+    Set(ObjElementType::kPosition, values, count);
+  }
+
+  void TexCoord(const std::array<double, 3>& values,
+                const std::uint32_t count) {
+    Set(ObjElementType::kTexCoord, values, count);
+  }
+
+  void Normal(const std::array<double, 3>& values) {
+    Set(ObjElementType::kNormal, values, 3);
+  }
+
+  void Face(const std::vector<scan::Corner>& corners) {
+    using read::ToZeroBasedIndex;
+    corners_.resize(corners.size());
+    for (auto i = std::size_t{0}; i < corners.size(); ++i) {
+      const auto& corner = corners[i];
+      auto& index_group = corners_[i];
+      index_group = ObjIndexGroup<std::uint32_t>(
+          ToZeroBasedIndex<std::uint32_t>(corner.position));
+      if (corner.has_tex_coord) {
+        index_group.tex_coord_index = std::make_pair(
+            ObjIndex<std::uint32_t>(
+                ToZeroBasedIndex<std::uint32_t>(corner.tex_coord)),
+            true);
+      }
+      if (corner.has_normal) {
+        index_group.normal_index = std::make_pair(
+            ObjIndex<std::uint32_t>(
+                ToZeroBasedIndex<std::uint32_t>(corner.normal)),
+            true);
+      }
+    }
+    element_->type = ObjElementType::kFace;
+    element_->corners = corners_.data();
+    element_->corner_count = corners_.size();
+    produced_ = true;
+  }
+
+  void SmoothingGroup(std::uint32_t) {}
+
+  // Returns true (once) if the last parsed line produced an element.
+  bool TakeProduced() noexcept {
+    const auto produced = produced_;
+    produced_ = false;
+    return produced;
+  }
+
+ private:
+  template <std::size_t N>
+  void Set(const ObjElementType type, const std::array<double, N>& values,
+           const std::uint32_t count) {
+    element_->type = type;
+    std::copy(values.begin(), values.end(), element_->values.begin());
+    element_->value_count = count;
+    produced_ = true;
+  }
+
+  ObjElement* element_;
+  std::vector<ObjIndexGroup<std::uint32_t>> corners_;
+  bool produced_ = false;
+};
+
+}  // namespace elements
+}  // namespace obj_io_internal
+
+// Pull parser yielding one element at a time from an in-memory buffer,
+// parsing lazily as elements are requested. Comments, empty lines and
+// smoothing groups produce no elements. No memory is allocated per element
+// once the face buffer has grown to fit the largest face, apart from a
+// single copy of the final line if it lacks a newline. The buffer must
+// outlive the reader.
+class ObjElementReader {
+ public:
+  ObjElementReader(const char* const data, const std::size_t size)
+      : next_(data),
+        end_(data + size),
+        handler_(&element_),
+        parser_(&handler_) {}
+
+  ObjElementReader(const ObjElementReader&) = delete;
+  ObjElementReader& operator=(const ObjElementReader&) = delete;
+
+  // Reads the next element into |*element|, returns false at the end of
+  // the input.
+  bool Next(ObjElement* const element) {
+    while (next_ != end_) {
+      const auto* const first = next_;
+      const auto* last = static_cast<const char*>(
+          std::memchr(first, '\n', static_cast<std::size_t>(end_ - first)));
+      if (last != nullptr) {
+        next_ = last + 1;
+      } else {
+        // Number parsing needs a terminator after the final line.
+        last_line_.assign(first, end_);
+        last_line_.push_back('\n');
+        next_ = end_;
+        if (ParseLine(last_line_.data(),
+                      last_line_.data() + last_line_.size() - 1)) {
+          *element = element_;
+          return true;
+        }
+        break;
+      }
+      if (ParseLine(first, last)) {
+        *element = element_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  bool ParseLine(const char* p, const char* const last) {
+    namespace scan = obj_io_internal::scan;
+    p = scan::SkipSpace(p, last);
+    if (last - p >= 1 && (*p == 'g' || *p == 'o') &&
+        (last - p == 1 || scan::IsSpace(p[1]))) {
+      // Name is the rest of the line, without surrounding whitespace.
+      const auto* first = scan::SkipSpace(p + 1, last);
+      auto name_last = last;
+      while (name_last != first && scan::IsSpace(*(name_last - 1))) {
+        --name_last;
+      }
+      element_.type = ObjElementType::kGroup;
+      element_.name = first;
+      element_.name_size = static_cast<std::size_t>(name_last - first);
+      return true;
+    }
+    parser_.ParseLine(p, last);
+    return handler_.TakeProduced();
+  }
+
+  const char* next_;
+  const char* end_;
+  ObjElement element_ = {};
+  obj_io_internal::elements::Handler handler_;
+  obj_io_internal::scan::LineParser<obj_io_internal::elements::Handler>
+      parser_;
+  std::string last_line_;
+};
+
+// Input iterator over the elements of an ObjElementReader.
+class ObjElementIterator {
+ public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = ObjElement;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const ObjElement*;
+  using reference = const ObjElement&;
+
+  // End iterator.
+  ObjElementIterator() = default;
+
+  explicit ObjElementIterator(ObjElementReader* const reader)
+      : reader_(reader) {
+    ++*this;
+  }
+
+  reference operator*() const noexcept { return element_; }
+  pointer operator->() const noexcept { return &element_; }
+
+  ObjElementIterator& operator++() {
+    if (!reader_->Next(&element_)) {
+      reader_ = nullptr;
+    }
+    return *this;
+  }
+
+  // Only iterators at the end compare equal, as usual for input iterators.
+  friend bool operator==(const ObjElementIterator& lhs,
+                         const ObjElementIterator& rhs) noexcept {
+    return lhs.reader_ == rhs.reader_;
+  }
+
+  friend bool operator!=(const ObjElementIterator& lhs,
+                         const ObjElementIterator& rhs) noexcept {
+    return !(lhs == rhs);
+  }
+
+ private:
+  ObjElementReader* reader_ = nullptr;
+  ObjElement element_ = {};
+};
+
+// Range for use in range-based for loops:
+//
+//   auto elements = thinks::ObjElements(data, size);
+//   for (const auto& element : elements) { ... }
+class ObjElements {
+ public:
+  ObjElements(const char* const data, const std::size_t size)
+      : reader_(new ObjElementReader(data, size)) {}
+
+  ObjElementIterator begin() { return ObjElementIterator(reader_.get()); }
+  ObjElementIterator end() { return ObjElementIterator(); }
+
+ private:
+  std::unique_ptr<ObjElementReader> reader_;  // Movable range.
+};
+
+#if defined(THINKS_OBJ_IO_HAS_COROUTINES)
+
+// C++20 generator adaptor over ObjElementReader:
+//
+//   for (auto gen = thinks::GenerateObjElements(data, size); gen.Next();) {
+//     const auto& element = gen.value();
+//   }
+class ObjElementGenerator {
+ public:
+  struct promise_type {
+    const ObjElement* current = nullptr;
+    std::exception_ptr error;
+
+    ObjElementGenerator get_return_object() {
+      return ObjElementGenerator(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(const ObjElement& element) noexcept {
+      current = &element;
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() { error = std::current_exception(); }
+  };
+
+  ObjElementGenerator(ObjElementGenerator&& other) noexcept
+      : handle_(other.handle_) {
+    other.handle_ = nullptr;
+  }
+
+  ObjElementGenerator(const ObjElementGenerator&) = delete;
+  ObjElementGenerator& operator=(const ObjElementGenerator&) = delete;
+  ObjElementGenerator& operator=(ObjElementGenerator&&) = delete;
+
+  ~ObjElementGenerator() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  // Advances to the next element, returns false at the end, also when
+  // called again after the end or after an error. Parse errors are
+  // re-thrown here.
+  bool Next() {
+    if (!handle_ || handle_.done()) {
+      return false;
+    }
+    handle_.resume();
+    if (handle_.promise().error) {
+      std::rethrow_exception(handle_.promise().error);
+    }
+    return !handle_.done();
+  }
+
+  const ObjElement& value() const noexcept {
+    return *handle_.promise().current;
+  }
+
+ private:
+  explicit ObjElementGenerator(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+inline ObjElementGenerator GenerateObjElements(const char* const data,
+                                               const std::size_t size) {
+  ObjElementReader reader(data, size);
+  auto element = ObjElement{};
+  while (reader.Next(&element)) {
+    co_yield element;
+  }
+}
+
+#endif  // THINKS_OBJ_IO_HAS_COROUTINES
+
 }  // namespace thinks
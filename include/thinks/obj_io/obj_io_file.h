@@ -0,0 +1,731 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// Reading from file paths: ReadObjFile and ReadObjFiles. Kept apart from
+// obj_io.h so that only users of these functions include the platform
+// file I/O headers.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Files are read with pread on POSIX systems, and with io_uring on Linux if
+// the kernel headers are available. Define THINKS_OBJ_IO_NO_IO_URING to
+// build without io_uring.
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define THINKS_OBJ_IO_HAS_PREAD 1
+#if defined(__linux__) && !defined(THINKS_OBJ_IO_NO_IO_URING) && \
+    defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define THINKS_OBJ_IO_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+#include "thinks/obj_io/obj_io.h"
+
+namespace thinks {
+
+namespace obj_io_internal {
+namespace fileio {
+
+constexpr std::size_t kBlockSize = std::size_t{1} << 20;
+constexpr std::uint32_t kQueueDepth = 4;  // Reads in flight with io_uring.
+
+#if defined(THINKS_OBJ_IO_HAS_PREAD)
+
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(const std::string& path)
+      : path_(path), fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    if (fd_ < 0) {
+      throw std::runtime_error("failed to open file '" + path + "'");
+    }
+  }
+
+  ~FileDescriptor() { ::close(fd_); }
+
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+  int get() const noexcept { return fd_; }
+
+  std::uint64_t Size() const {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+      ThrowReadError();
+    }
+    return static_cast<std::uint64_t>(st.st_size);
+  }
+
+  // Reads |size| bytes at |offset|, or fewer at the end of the file.
+  // Returns the number of bytes read.
+  std::size_t ReadAt(char* const data, const std::size_t size,
+                     const std::uint64_t offset) const {
+    trace::Span span("read block");
+    auto done = std::size_t{0};
+    while (done < size) {
+      const auto n = ::pread(fd_, data + done, size - done,
+                             static_cast<off_t>(offset + done));
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        ThrowReadError();
+      }
+      if (n == 0) {
+        break;
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    span.Arg("bytes", done);
+    return done;
+  }
+
+  [[noreturn]] void ThrowReadError() const {
+    throw std::runtime_error("failed to read file '" + path_ + "'");
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+};
+
+#else
+
+struct FileCloser {
+  void operator()(std::FILE* const file) const noexcept { std::fclose(file); }
+};
+
+#endif  // THINKS_OBJ_IO_HAS_PREAD
+
+// Size of the file at |path| in bytes, zero if unknown.
+inline std::uint64_t FileSize(const std::string& path) {
+#if defined(THINKS_OBJ_IO_HAS_PREAD)
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size)
+                                        : 0;
+#else
+  auto file = std::unique_ptr<std::FILE, FileCloser>(
+      std::fopen(path.c_str(), "rb"));
+  if (file == nullptr || std::fseek(file.get(), 0, SEEK_END) != 0) {
+    return 0;
+  }
+  const auto size = std::ftell(file.get());
+  return size > 0 ? static_cast<std::uint64_t>(size) : 0;
+#endif
+}
+
+#if defined(THINKS_OBJ_IO_HAS_IO_URING)
+
+// Minimal io_uring interface on top of the raw system calls, owning
+// kQueueDepth registered (fixed) buffers of kBlockSize bytes. Reads are
+// tagged with the index of the buffer they fill.
+class IoUring {
+ public:
+  // Returns null if io_uring cannot be used, e.g. because the kernel is too
+  // old or the system calls are filtered.
+  static std::unique_ptr<IoUring> Create() {
+    auto ring = std::unique_ptr<IoUring>(new IoUring());
+    return ring->Setup() ? std::move(ring) : nullptr;
+  }
+
+  ~IoUring() {
+    Unmap(buffers_, kQueueDepth * kBlockSize);
+    Unmap(sqes_, sqes_size_);
+    Unmap(cq_ring_, cq_ring_size_);
+    Unmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  char* buffer(const std::uint32_t index) const noexcept {
+    return static_cast<char*>(buffers_) + index * kBlockSize;
+  }
+
+  // Queues a read of up to kBlockSize bytes at |offset| into buffer
+  // |index| and submits it to the kernel.
+  bool SubmitRead(const int fd, const std::uint32_t index,
+                  const std::uint64_t offset) {
+    const auto tail = *sq_tail_;
+    const auto slot = tail & *sq_mask_;
+    auto* const sqe = &sqes_[slot];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(buffer(index));
+    sqe->len = static_cast<std::uint32_t>(kBlockSize);
+    sqe->buf_index = static_cast<std::uint16_t>(index);
+    sqe->user_data = index;
+    sq_array_[slot] = slot;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    return Enter(1, 0, 0) == 1;
+  }
+
+  // Waits for a read to complete, returning the index of its buffer in
+  // |index| and its result (bytes read or negated errno).
+  bool WaitCompletion(std::uint32_t* const index, std::int32_t* const res) {
+    for (;;) {
+      const auto head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        const auto& cqe = cqes_[head & *cq_mask_];
+        *index = static_cast<std::uint32_t>(cqe.user_data);
+        *res = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+      }
+      if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+        return false;
+      }
+    }
+  }
+
+ private:
+  IoUring() = default;
+
+  static void Unmap(void* const addr, const std::size_t size) noexcept {
+    if (addr != nullptr && addr != MAP_FAILED) {
+      ::munmap(addr, size);
+    }
+  }
+
+  void* Map(const std::size_t size, const std::uint64_t offset) const {
+    return ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, static_cast<off_t>(offset));
+  }
+
+  int Enter(const std::uint32_t to_submit, const std::uint32_t min_complete,
+            const std::uint32_t flags) const {
+    for (;;) {
+      const auto n = ::syscall(__NR_io_uring_enter, fd_, to_submit,
+                               min_complete, flags, nullptr, 0);
+      if (n >= 0 || errno != EINTR) {
+        return static_cast<int>(n);
+      }
+    }
+  }
+
+  bool Setup() {
+    auto params = io_uring_params{};
+    fd_ = static_cast<int>(
+        ::syscall(__NR_io_uring_setup, kQueueDepth, &params));
+    if (fd_ < 0) {
+      return false;
+    }
+
+    sq_ring_size_ =
+        params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    void* const sqes = Map(sqes_size_, IORING_OFF_SQES);
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+        sqes == MAP_FAILED) {
+      Unmap(sqes, sqes_size_);
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* const sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.array);
+    auto* const cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Page aligned buffers, registered once so that the kernel does not
+    // have to map them for every read.
+    buffers_ = ::mmap(nullptr, kQueueDepth * kBlockSize,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                      0);
+    if (buffers_ == MAP_FAILED) {
+      return false;
+    }
+    iovec iovecs[kQueueDepth];
+    for (auto i = std::uint32_t{0}; i < kQueueDepth; ++i) {
+      iovecs[i].iov_base = buffer(i);
+      iovecs[i].iov_len = kBlockSize;
+    }
+    return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                     iovecs, kQueueDepth) == 0;
+  }
+
+  int fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  void* buffers_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  std::size_t cq_ring_size_ = 0;
+  std::size_t sqes_size_ = 0;
+  std::uint32_t* sq_tail_ = nullptr;
+  std::uint32_t* sq_mask_ = nullptr;
+  std::uint32_t* sq_array_ = nullptr;
+  std::uint32_t* cq_head_ = nullptr;
+  std::uint32_t* cq_tail_ = nullptr;
+  std::uint32_t* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+#endif  // THINKS_OBJ_IO_HAS_IO_URING
+
+// Reads files in blocks of at most kBlockSize bytes, using the method
+// given by ObjFileIo. The buffers (and the io_uring instance) are kept
+// between files, so one reader should be used for many files.
+class BlockReader {
+ public:
+  explicit BlockReader(const ObjFileIo file_io) {
+#if defined(THINKS_OBJ_IO_HAS_IO_URING)
+    if (file_io != ObjFileIo::kPread) {
+      ring_ = IoUring::Create();
+    }
+    if (ring_ != nullptr) {
+      return;
+    }
+#endif
+    if (file_io == ObjFileIo::kIoUring) {
+      throw std::runtime_error("io_uring is not available");
+    }
+    buffer_.resize(kBlockSize);
+  }
+
+  // Calls |func(data, size)| for consecutive blocks of the file at |path|,
+  // until the end of the file or until |func| returns false.
+  template <typename FuncT>
+  void Read(const std::string& path, FuncT&& func) {
+#if defined(THINKS_OBJ_IO_HAS_PREAD)
+    const FileDescriptor file(path);
+#if defined(THINKS_OBJ_IO_HAS_IO_URING)
+    if (ring_ != nullptr) {
+      ReadIoUring(file, std::forward<FuncT>(func));
+      return;
+    }
+#endif
+    for (auto offset = std::uint64_t{0};;) {
+      const auto n = file.ReadAt(buffer_.data(), buffer_.size(), offset);
+      if (n > 0 && !func(static_cast<const char*>(buffer_.data()), n)) {
+        break;
+      }
+      if (n < buffer_.size()) {
+        break;
+      }
+      offset += n;
+    }
+#else
+    auto file = std::unique_ptr<std::FILE, FileCloser>(
+        std::fopen(path.c_str(), "rb"));
+    if (file == nullptr) {
+      throw std::runtime_error("failed to open file '" + path + "'");
+    }
+    std::setvbuf(file.get(), nullptr, _IONBF, 0);
+    for (;;) {
+      const auto n = std::fread(buffer_.data(), 1, buffer_.size(), file.get());
+      if (n > 0 && !func(static_cast<const char*>(buffer_.data()), n)) {
+        return;
+      }
+      if (n < buffer_.size()) {
+        break;
+      }
+    }
+    if (std::ferror(file.get()) != 0) {
+      throw std::runtime_error("failed to read file '" + path + "'");
+    }
+#endif  // THINKS_OBJ_IO_HAS_PREAD
+  }
+
+ private:
+#if defined(THINKS_OBJ_IO_HAS_IO_URING)
+  // Keeps up to kQueueDepth block reads in flight. Block i is read into
+  // buffer i % kQueueDepth, so blocks are passed on in file order as soon
+  // as they are complete, after which their buffer is refilled with the
+  // block kQueueDepth positions further on.
+  template <typename FuncT>
+  void ReadIoUring(const FileDescriptor& file, FuncT&& func) {
+    const auto size = file.Size();
+    const auto block_count = (size + kBlockSize - 1) / kBlockSize;
+    std::int32_t results[kQueueDepth];
+    bool done[kQueueDepth] = {};
+    auto in_flight = std::uint32_t{0};
+    auto next_block = std::uint64_t{0};
+    const auto submit = [&](const std::uint64_t block) {
+      if (!ring_->SubmitRead(file.get(),
+                             static_cast<std::uint32_t>(block % kQueueDepth),
+                             block * kBlockSize)) {
+        file.ThrowReadError();
+      }
+      ++in_flight;
+    };
+
+    try {
+      for (; next_block < std::min<std::uint64_t>(block_count, kQueueDepth);
+           ++next_block) {
+        submit(next_block);
+      }
+      for (auto block = std::uint64_t{0}; block < block_count; ++block) {
+        const auto index = static_cast<std::uint32_t>(block % kQueueDepth);
+        while (!done[index]) {
+          auto completed = std::uint32_t{0};
+          auto res = std::int32_t{0};
+          if (!ring_->WaitCompletion(&completed, &res)) {
+            file.ThrowReadError();
+          }
+          results[completed] = res;
+          done[completed] = true;
+          --in_flight;
+        }
+        done[index] = false;
+        if (results[index] < 0) {
+          file.ThrowReadError();
+        }
+
+        // Short reads are completed synchronously.
+        const auto offset = block * kBlockSize;
+        const auto expected =
+            static_cast<std::size_t>(std::min<std::uint64_t>(
+                kBlockSize, size - offset));
+        auto n = static_cast<std::size_t>(results[index]);
+        if (n < expected) {
+          n += file.ReadAt(ring_->buffer(index) + n, expected - n, offset + n);
+        }
+        if (!func(static_cast<const char*>(ring_->buffer(index)), n)) {
+          break;
+        }
+
+        if (next_block < block_count) {
+          submit(next_block++);
+        }
+      }
+    } catch (...) {
+      Drain(in_flight);
+      throw;
+    }
+    Drain(in_flight);
+  }
+
+  // Waits for reads in flight, since the buffers must not be in use by the
+  // kernel when reused.
+  void Drain(std::uint32_t in_flight) {
+    auto index = std::uint32_t{0};
+    auto res = std::int32_t{0};
+    while (in_flight > 0 && ring_->WaitCompletion(&index, &res)) {
+      --in_flight;
+    }
+  }
+
+  std::unique_ptr<IoUring> ring_;
+#endif  // THINKS_OBJ_IO_HAS_IO_URING
+  std::vector<char> buffer_;
+};
+
+// Parser state for the faces taken by a face callback of type AddFaceFuncT.
+template <typename AddFaceFuncT>
+using ReadStateFor = read::ReadState<FaceIndexType<
+    typename std::decay<AddFaceFuncT>::type::ParseType>>;
+
+// Reads the file at |path| with a fresh or reset |state|, whose options
+// must have been validated for the callbacks.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT, typename AddNormalFuncT,
+          typename StateT>
+ObjReadResult ReadLines(BlockReader* const reader, StateT* const state_ptr,
+                        const std::string& path,
+                        AddPositionFuncT&& add_position,
+                        AddFaceFuncT&& add_face,
+                        AddObjTexCoordFuncT&& add_tex_coord,
+                        AddNormalFuncT&& add_normal) {
+  auto& state = *state_ptr;
+  const auto& options = state.options;
+  ObjReadResult result = {};
+  const auto monitor = ProgressMonitor(
+      options.progress, options.cancellation,
+      options.progress ? FileSize(path) : 0);
+  const auto parse_line = [&](const std::string& line) {
+    if (!read::ParseLine(line, add_position, add_face, add_tex_coord,
+                         add_normal, &state, &result.position_count,
+                         &result.face_count, &result.tex_coord_count,
+                         &result.normal_count)) {
+      throw std::runtime_error(state.error.message);
+    }
+  };
+  auto lines = read::LineBuffer{};
+  auto bytes_done = std::uint64_t{0};
+  auto next_update = options.progress_interval;
+  reader->Read(path, [&](const char* const data, const std::size_t size) {
+    trace::Span span("parse block");
+    span.Arg("bytes", size);
+    lines.Feed(data, size, parse_line);
+    bytes_done += size;
+    if (bytes_done >= next_update && monitor.enabled()) {
+      next_update = bytes_done + options.progress_interval;
+      result.cancelled = monitor.Update(bytes_done, ElementCount(result));
+    }
+    return !result.cancelled;
+  });
+  if (result.cancelled) {
+    read::DeliverWeldMap(&state);
+    return result;
+  }
+  {
+    trace::Span span("finish lines");
+    lines.Finish(parse_line);
+    read::FinishLines(add_face, add_normal, &state, &result.face_count,
+                      &result.normal_count);
+  }
+  monitor.Report(bytes_done, ElementCount(result));
+  return result;
+}
+
+}  // namespace fileio
+}  // namespace obj_io_internal
+
+// True if io_uring can be used for reading files, which requires Linux
+// kernel headers at build time and a kernel that allows io_uring at run
+// time. The result of the run time check is cached.
+inline bool ObjIoUringAvailable() {
+#if defined(THINKS_OBJ_IO_HAS_IO_URING)
+  static const bool available =
+      obj_io_internal::fileio::IoUring::Create() != nullptr;
+  return available;
+#else
+  return false;
+#endif
+}
+
+// Same as ReadObj, but reads from the file at |path| in large blocks using
+// the method given by options.file_io. With io_uring several blocks are
+// read ahead while parsing.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjReadResult ReadObjFile(const std::string& path,
+                          AddPositionFuncT&& add_position,
+                          AddFaceFuncT&& add_face,
+                          AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                          AddNormalFuncT&& add_normal = nullptr,
+                          const ObjReadOptions& options = ObjReadOptions{}) {
+  const obj_io_internal::trace::CallScope trace_scope(options.trace);
+  auto reader = obj_io_internal::fileio::BlockReader(options.file_io);
+  obj_io_internal::read::ValidateReadOptions<AddFaceFuncT, AddNormalFuncT>(
+      options);
+  auto state = obj_io_internal::fileio::ReadStateFor<AddFaceFuncT>(options);
+  return obj_io_internal::fileio::ReadLines(
+      &reader, &state, path, std::forward<AddPositionFuncT>(add_position),
+      std::forward<AddFaceFuncT>(add_face),
+      std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+      std::forward<AddNormalFuncT>(add_normal));
+}
+
+// Callbacks for one file read by ReadObjFiles, with the same meaning as the
+// ReadObj arguments of the same names. Use MakeObjReadSink to deduce the
+// callback types.
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+struct ObjReadSink {
+  AddPositionFuncT add_position;
+  AddFaceFuncT add_face;
+  AddObjTexCoordFuncT add_tex_coord;
+  AddNormalFuncT add_normal;
+};
+
+template <typename AddPositionFuncT, typename AddFaceFuncT,
+          typename AddObjTexCoordFuncT = std::nullptr_t,
+          typename AddNormalFuncT = std::nullptr_t>
+ObjReadSink<typename std::decay<AddPositionFuncT>::type,
+            typename std::decay<AddFaceFuncT>::type,
+            typename std::decay<AddObjTexCoordFuncT>::type,
+            typename std::decay<AddNormalFuncT>::type>
+MakeObjReadSink(AddPositionFuncT&& add_position, AddFaceFuncT&& add_face,
+                AddObjTexCoordFuncT&& add_tex_coord = nullptr,
+                AddNormalFuncT&& add_normal = nullptr) {
+  return {std::forward<AddPositionFuncT>(add_position),
+          std::forward<AddFaceFuncT>(add_face),
+          std::forward<AddObjTexCoordFuncT>(add_tex_coord),
+          std::forward<AddNormalFuncT>(add_normal)};
+}
+
+// Outcome of reading one of the files given to ReadObjFiles.
+struct ObjFileReadResult {
+  // True if the whole file was read, in which case |result| holds its
+  // counts. Otherwise |error| holds the message of the exception that
+  // stopped the read ("unknown exception" if it is not a std::exception, or
+  // "read cancelled") and the sink may have received part of the file.
+  bool ok = false;
+  ObjReadResult result = {};
+  std::string error;
+};
+
+namespace obj_io_internal {
+namespace batch {
+
+// Files are dealt out to the workers in contiguous runs, so that small
+// neighbouring files are read by the same thread. A worker takes files
+// from the front of its own queue and, once that is empty, steals from
+// the back of the other queues.
+class WorkQueue {
+ public:
+  void Push(const std::size_t file_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_indices_.push_back(file_index);
+  }
+
+  bool PopFront(std::size_t* const file_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_indices_.empty()) {
+      return false;
+    }
+    *file_index = file_indices_.front();
+    file_indices_.pop_front();
+    return true;
+  }
+
+  bool PopBack(std::size_t* const file_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_indices_.empty()) {
+      return false;
+    }
+    *file_index = file_indices_.back();
+    file_indices_.pop_back();
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<std::size_t> file_indices_;
+};
+
+}  // namespace batch
+}  // namespace obj_io_internal
+
+// Reads many files concurrently, which pays off for large numbers of small
+// files where opening files and single threaded parsing dominate.
+// |sink_factory(file_index)| is called once per file, on the thread that
+// reads the file, and returns the ObjReadSink receiving the elements of
+// |paths[file_index]|. The factory and the callbacks are called from
+// several threads at once, but the callbacks of one sink are only called
+// from one thread, in file order.
+//
+// |options| apply to every file, and options.thread_count sets the number
+// of worker threads (zero means one per hardware thread). Each worker
+// reuses its read buffers, parser state, and its io_uring instance if
+// options.file_io selects one, for all its files. Errors do not abort the
+// batch: the returned results, in the order of |paths|, tell which files
+// failed and why. Progress is not reported, but options.cancellation is
+// polled between blocks and files; files that are cancelled fail with the
+// error "read cancelled".
+template <typename SinkFactoryT>
+std::vector<ObjFileReadResult> ReadObjFiles(
+    const std::vector<std::string>& paths, SinkFactoryT&& sink_factory,
+    const ObjReadOptions& options = ObjReadOptions{}) {
+  if (options.weld_map != nullptr) {
+    throw std::runtime_error("weld map is not supported for several files");
+  }
+  if (options.file_io == ObjFileIo::kIoUring && !ObjIoUringAvailable()) {
+    throw std::runtime_error("io_uring is not available");
+  }
+  const obj_io_internal::trace::CallScope trace_scope(options.trace);
+  auto results = std::vector<ObjFileReadResult>(paths.size());
+  const auto worker_count = static_cast<std::size_t>(std::max<std::size_t>(
+      1, std::min<std::size_t>(
+             obj_io_internal::ThreadCount(options.thread_count),
+             paths.size())));
+  auto queues = std::vector<obj_io_internal::batch::WorkQueue>(worker_count);
+  for (auto i = std::size_t{0}; i < paths.size(); ++i) {
+    queues[i * worker_count / paths.size()].Push(i);
+  }
+
+  // Files are read in parallel, so each file is read single threaded.
+  auto file_options = options;
+  file_options.thread_count = 1;
+  file_options.progress = nullptr;
+
+  // All sinks have the same type, so one parser state per worker is reset
+  // between its files.
+  using SinkType =
+      typename std::decay<decltype(sink_factory(std::size_t{0}))>::type;
+  using AddFaceType = decltype(std::declval<SinkType&>().add_face);
+  using AddNormalType = decltype(std::declval<SinkType&>().add_normal);
+
+  obj_io_internal::ParallelFor(
+      worker_count, static_cast<std::uint32_t>(worker_count),
+      [&](const std::size_t begin, const std::size_t end, std::size_t) {
+        auto reader = obj_io_internal::fileio::BlockReader(options.file_io);
+        auto state =
+            obj_io_internal::fileio::ReadStateFor<AddFaceType>(file_options);
+        for (auto worker = begin; worker < end; ++worker) {
+          auto file_index = std::size_t{0};
+          for (;;) {
+            auto found = queues[worker].PopFront(&file_index);
+            for (auto i = std::size_t{1}; !found && i < worker_count; ++i) {
+              found = queues[(worker + i) % worker_count].PopBack(&file_index);
+            }
+            if (!found) {
+              break;
+            }
+
+            auto& file_result = results[file_index];
+            if (options.cancellation != nullptr &&
+                options.cancellation->cancelled()) {
+              file_result.result.cancelled = true;
+              file_result.error = "read cancelled";
+              continue;
+            }
+            obj_io_internal::trace::Span span("read file");
+            span.Arg("file_index", file_index);
+            try {
+              obj_io_internal::read::ValidateReadOptions<AddFaceType&,
+                                                         AddNormalType&>(
+                  file_options);
+              auto sink = sink_factory(file_index);
+              state.Reset();
+              file_result.result = obj_io_internal::fileio::ReadLines(
+                  &reader, &state, paths[file_index], sink.add_position,
+                  sink.add_face, sink.add_tex_coord, sink.add_normal);
+              file_result.ok = !file_result.result.cancelled;
+              if (file_result.result.cancelled) {
+                file_result.error = "read cancelled";
+              }
+            } catch (const std::exception& e) {
+              file_result.error = e.what();
+            } catch (...) {
+              file_result.error = "unknown exception";
+            }
+          }
+        }
+      });
+  return results;
+}
+
+}  // namespace thinks
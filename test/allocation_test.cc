@@ -0,0 +1,285 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// Counts heap allocations made while reading and writing, by replacing the
+// global operator new. Built as a separate executable so that the
+// replacement does not affect the other tests.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocation_count{0};
+std::atomic<bool> g_fail_allocations{false};
+
+void* Allocate(const std::size_t size) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (g_fail_allocations.load(std::memory_order_relaxed)) {
+    throw std::bad_alloc();
+  }
+  if (auto* const ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(const std::size_t size) { return Allocate(size); }
+void* operator new[](const std::size_t size) { return Allocate(size); }
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return Allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void* operator new[](const std::size_t size,
+                     const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+void operator delete(void* const ptr) noexcept { std::free(ptr); }
+void operator delete[](void* const ptr) noexcept { std::free(ptr); }
+void operator delete(void* const ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* const ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* const ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* const ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+using IndexType = std::uint32_t;
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexType = thinks::ObjIndex<IndexType>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<IndexType>;
+
+// Allocations may grow buffers geometrically with the input, but must not
+// grow linearly with the element count. Reading or writing kLargeCount
+// elements may therefore only allocate a fixed number of times more than
+// handling kSmallCount elements.
+constexpr auto kSmallCount = 10000;
+constexpr auto kLargeCount = 100000;
+constexpr auto kBudget = std::uint64_t{64};
+
+// Returns the number of allocations made by |func|.
+template <typename FuncT>
+std::uint64_t CountAllocations(FuncT func) {
+  const auto before = g_allocation_count.load();
+  func();
+  return g_allocation_count.load() - before;
+}
+
+// Discards all output, so that stream growth is not counted.
+class NullBuffer : public std::streambuf {
+ protected:
+  int_type overflow(const int_type c) override {
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char*, const std::streamsize n) override {
+    return n;
+  }
+};
+
+std::string MakeInput(const int count, const bool index_groups,
+                      const bool polygons, const bool smoothing_groups) {
+  auto input = std::string(
+      "# allocation test\n"
+      "\n");
+  for (auto i = 0; i < count; ++i) {
+    input += "v 1.5 -2.25 3e-2\n";
+    if (index_groups) {
+      input += "vt 0.5 0.25\nvn 0 0 1\n";
+    }
+  }
+  for (auto i = 0; i < count; ++i) {
+    const auto a = std::to_string(i % count + 1);
+    const auto b = std::to_string((i + 1) % count + 1);
+    const auto c = std::to_string((i + 2) % count + 1);
+    if (smoothing_groups) {
+      input += i % 2 == 0 ? "s " + std::to_string(i + 1) + "\n" : "s off\n";
+    }
+    input += "f";
+    for (const auto& index : {a, b, c}) {
+      input += " " + index;
+      if (index_groups) {
+        input += "/" + index + "/" + index;
+      }
+    }
+    if (polygons) {
+      input += " " + a;
+    }
+    input += "\n";
+  }
+  return input;
+}
+
+template <typename ReadFuncT>
+void RequireBoundedReadAllocations(const bool index_groups,
+                                   const bool polygons,
+                                   const bool smoothing_groups,
+                                   ReadFuncT read) {
+  const auto small_input =
+      MakeInput(kSmallCount, index_groups, polygons, smoothing_groups);
+  const auto large_input =
+      MakeInput(kLargeCount, index_groups, polygons, smoothing_groups);
+
+  const auto small_allocations = CountAllocations([&small_input, &read]() {
+    auto iss = std::istringstream(small_input);
+    read(iss);
+  });
+  const auto large_allocations = CountAllocations([&large_input, &read]() {
+    auto iss = std::istringstream(large_input);
+    read(iss);
+  });
+
+  INFO("small: " << small_allocations << ", large: " << large_allocations);
+  REQUIRE(large_allocations <= small_allocations + kBudget);
+}
+
+TEST_CASE("ALLOCATION - read positions and triangles") {
+  auto options = thinks::ObjReadOptions{};
+  SECTION("direct") {}
+  SECTION("pipelined") { options.pipelined = true; }
+  SECTION("callback thread") { options.callback_thread = true; }
+
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+  RequireBoundedReadAllocations(
+      false, false, false, [&options](std::istream& is) {
+        const auto result = thinks::ReadObj(
+            is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+            thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}), nullptr,
+            nullptr, options);
+        REQUIRE(result.face_count > 0);
+      });
+}
+
+TEST_CASE("ALLOCATION - read index groups") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+  RequireBoundedReadAllocations(true, false, false, [](std::istream& is) {
+    const auto result = thinks::ReadObj(
+        is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjTexCoordType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjNormalType>([](const auto&) {}));
+    REQUIRE(result.normal_count > 0);
+  });
+}
+
+TEST_CASE("ALLOCATION - read polygons") {
+  using ObjFaceType = thinks::ObjPolygonFace<ObjIndexType>;
+  RequireBoundedReadAllocations(false, true, false, [](std::istream& is) {
+    const auto result = thinks::ReadObj(
+        is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+    REQUIRE(result.face_count > 0);
+  });
+}
+
+TEST_CASE("ALLOCATION - read smoothing groups") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+  RequireBoundedReadAllocations(false, false, true, [](std::istream& is) {
+    const auto result = thinks::ReadObj(
+        is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+    REQUIRE(result.face_count > 0);
+  });
+}
+
+TEST_CASE("ALLOCATION - read skipped attributes") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+  RequireBoundedReadAllocations(true, false, false, [](std::istream& is) {
+    const auto result = thinks::ReadObj(
+        is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+    REQUIRE(result.tex_coord_count == 0);
+  });
+}
+
+TEST_CASE("ALLOCATION - read lazy faces") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+  RequireBoundedReadAllocations(true, false, false, [](std::istream& is) {
+    auto faces = thinks::ObjLazyFaces{};
+    thinks::ReadObj(
+        is, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjLazyFaceAddFunc(&faces));
+    const auto count = thinks::DecodeObjFaces(
+        faces, 0, faces.size(),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+    REQUIRE(count == faces.size());
+  });
+}
+
+TEST_CASE("ALLOCATION - try read without memory") {
+  // The exception is created up front, then allocations fail until the read
+  // returns, so the message cannot be copied into the error.
+  const auto add_position = [](const auto&) {
+    auto error = std::runtime_error(std::string(100, 'x'));
+    g_fail_allocations = true;
+    throw error;
+  };
+  auto iss = std::istringstream("v 0 0 0\n");
+  const auto outcome = thinks::TryReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>(add_position),
+      thinks::MakeObjAddFunc<thinks::ObjTriangleFace<ObjIndexType>>(
+          [](const auto&) {}));
+  g_fail_allocations = false;
+
+  REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kException);
+  REQUIRE(outcome.error.message.empty());
+}
+
+TEST_CASE("ALLOCATION - write") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+  const auto write = [](const int count) {
+    auto position_index = 0;
+    const auto position_mapper = [&position_index, count]() {
+      return position_index++ < count
+                 ? thinks::ObjMap(ObjPositionType(1.5f, -2.25f, 0.03f))
+                 : thinks::ObjEnd<ObjPositionType>();
+    };
+    auto face_index = 0;
+    const auto face_mapper = [&face_index, count]() {
+      const auto i = static_cast<IndexType>(face_index);
+      return face_index++ < count
+                 ? thinks::ObjMap(ObjFaceType(ObjIndexType(i),
+                                              ObjIndexType(i + 1),
+                                              ObjIndexType(i + 2)))
+                 : thinks::ObjEnd<ObjFaceType>();
+    };
+    return CountAllocations([&position_mapper, &face_mapper]() {
+      NullBuffer buffer;
+      std::ostream os(&buffer);
+      const auto result = thinks::WriteObj(os, position_mapper, face_mapper);
+      REQUIRE(result.face_count > 0);
+    });
+  };
+
+  const auto small_allocations = write(kSmallCount);
+  const auto large_allocations = write(kLargeCount);
+
+  INFO("small: " << small_allocations << ", large: " << large_allocations);
+  REQUIRE(large_allocations <= small_allocations + kBudget);
+}
+
+}  // namespace
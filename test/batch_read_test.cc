@@ -0,0 +1,223 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io_file.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+// Files written to the working directory, removed when going out of scope.
+class TempFiles {
+ public:
+  ~TempFiles() {
+    for (const auto& path : paths_) {
+      std::remove(path.c_str());
+    }
+  }
+
+  std::string Add(const std::string& content) {
+    auto path = "batch_read_test_" + std::to_string(paths_.size()) + ".obj";
+    std::ofstream(path, std::ios::binary) << content;
+    paths_.push_back(path);
+    return path;
+  }
+
+ private:
+  std::vector<std::string> paths_;
+};
+
+// A strip of |quad_count| quads as triangles, with the file index in the
+// x-coordinates so that mixed up sinks are detected.
+std::string MakeStrip(const std::size_t file_index,
+                      const std::size_t quad_count) {
+  auto oss = std::ostringstream{};
+  for (auto i = std::size_t{0}; i <= quad_count; ++i) {
+    oss << "v " << file_index << " " << i << " 0\n";
+    oss << "v " << file_index << " " << i << " 1\n";
+  }
+  for (auto i = std::size_t{0}; i < quad_count; ++i) {
+    const auto a = 2 * i + 1;
+    oss << "f " << a << " " << a + 2 << " " << a + 1 << "\n";
+    oss << "f " << a + 1 << " " << a + 2 << " " << a + 3 << "\n";
+  }
+  return oss.str();
+}
+
+struct Mesh {
+  std::vector<float> positions;
+  std::vector<std::uint32_t> indices;
+};
+
+auto MakeSinkFactory(std::vector<Mesh>* const meshes) {
+  return [meshes](const std::size_t file_index) {
+    auto* const mesh = &(*meshes)[file_index];
+    return thinks::MakeObjReadSink(
+        thinks::MakeObjAddFunc<ObjPositionType>([mesh](const auto& pos) {
+          mesh->positions.insert(mesh->positions.end(), pos.values.begin(),
+                                 pos.values.end());
+        }),
+        thinks::MakeObjAddFunc<ObjFaceType>([mesh](const auto& face) {
+          for (const auto& index : face.values) {
+            mesh->indices.push_back(index.value);
+          }
+        }));
+  };
+}
+
+TEST_CASE("BATCH - read files") {
+  auto files = TempFiles{};
+  auto paths = std::vector<std::string>{};
+  auto quad_counts = std::vector<std::size_t>{};
+  for (auto i = std::size_t{0}; i < 40; ++i) {
+    // Mostly small files and a few large ones, larger than a read block.
+    const auto quad_count = i % 10 == 3 ? 40000 : 1 + i % 7;
+    paths.push_back(files.Add(MakeStrip(i, quad_count)));
+    quad_counts.push_back(quad_count);
+  }
+
+  for (const auto thread_count : {1u, 3u, 8u}) {
+    auto meshes = std::vector<Mesh>(paths.size());
+    auto options = thinks::ObjReadOptions{};
+    options.thread_count = thread_count;
+    const auto results =
+        thinks::ReadObjFiles(paths, MakeSinkFactory(&meshes), options);
+
+    REQUIRE(results.size() == paths.size());
+    for (auto i = std::size_t{0}; i < paths.size(); ++i) {
+      REQUIRE(results[i].ok);
+      REQUIRE(results[i].error.empty());
+      REQUIRE(results[i].result.position_count == 2 * (quad_counts[i] + 1));
+      REQUIRE(results[i].result.face_count == 2 * quad_counts[i]);
+
+      auto iss = std::istringstream(MakeStrip(i, quad_counts[i]));
+      auto expected_meshes = std::vector<Mesh>(paths.size());
+      auto expected_sink = MakeSinkFactory(&expected_meshes)(i);
+      thinks::ReadObj(iss, expected_sink.add_position, expected_sink.add_face);
+      REQUIRE(meshes[i].positions == expected_meshes[i].positions);
+      REQUIRE(meshes[i].indices == expected_meshes[i].indices);
+    }
+  }
+}
+
+TEST_CASE("BATCH - errors do not abort the batch") {
+  auto files = TempFiles{};
+  const auto paths = std::vector<std::string>{
+      files.Add(MakeStrip(0, 2)),
+      files.Add("v 1 2 3\nf 1 2\n"),
+      "batch_read_test_missing.obj",
+      files.Add(MakeStrip(3, 2)),
+  };
+
+  auto meshes = std::vector<Mesh>(paths.size());
+  auto options = thinks::ObjReadOptions{};
+  options.thread_count = 2;
+  const auto results =
+      thinks::ReadObjFiles(paths, MakeSinkFactory(&meshes), options);
+
+  REQUIRE(results.size() == 4);
+  REQUIRE(results[0].ok);
+  REQUIRE(results[0].result.face_count == 4);
+  REQUIRE(!results[1].ok);
+  REQUIRE(results[1].error == "expected 3 face indices (found 2)");
+  REQUIRE(!results[2].ok);
+  REQUIRE(results[2].error ==
+          "failed to open file 'batch_read_test_missing.obj'");
+  REQUIRE(results[3].ok);
+  REQUIRE(results[3].result.face_count == 4);
+  REQUIRE(meshes[3].positions.size() == 18);
+}
+
+TEST_CASE("BATCH - exceptions not derived from std::exception") {
+  auto files = TempFiles{};
+  const auto paths = std::vector<std::string>{files.Add(MakeStrip(0, 2)),
+                                              files.Add(MakeStrip(1, 2))};
+  const auto results = thinks::ReadObjFiles(paths, [](const std::size_t i) {
+    return thinks::MakeObjReadSink(
+        thinks::MakeObjAddFunc<ObjPositionType>([i](const auto&) {
+          if (i == 0) {
+            throw 42;
+          }
+        }),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+  });
+
+  REQUIRE(!results[0].ok);
+  REQUIRE(results[0].error == "unknown exception");
+  REQUIRE(results[1].ok);
+  REQUIRE(results[1].result.face_count == 4);
+}
+
+TEST_CASE("BATCH - parser state is reset between files") {
+  // The same positions in every file, read by a single worker. Welding
+  // must not merge positions with those of previous files, and a failed
+  // read must not leave anything behind for the next file.
+  auto files = TempFiles{};
+  const auto paths = std::vector<std::string>{
+      files.Add(MakeStrip(0, 2)), files.Add("v 0 0 0\nv 0 0 1\nf 1 2\n"),
+      files.Add(MakeStrip(0, 2)), files.Add(MakeStrip(0, 2))};
+  auto options = thinks::ObjReadOptions{};
+  options.thread_count = 1;
+  options.weld_positions = true;
+
+  auto meshes = std::vector<Mesh>(paths.size());
+  const auto results =
+      thinks::ReadObjFiles(paths, MakeSinkFactory(&meshes), options);
+  REQUIRE(!results[1].ok);
+  for (const auto i : {0, 2, 3}) {
+    REQUIRE(results[i].ok);
+    REQUIRE(results[i].result.position_count == 6);
+    REQUIRE(results[i].result.face_count == 4);
+    REQUIRE(meshes[i].positions == meshes[0].positions);
+    REQUIRE(meshes[i].indices == meshes[0].indices);
+  }
+}
+
+TEST_CASE("BATCH - cancelled") {
+  auto files = TempFiles{};
+  const auto paths = std::vector<std::string>{files.Add(MakeStrip(0, 2)),
+                                              files.Add(MakeStrip(1, 2))};
+  thinks::ObjCancellationToken token;
+  token.Cancel();
+  auto options = thinks::ObjReadOptions{};
+  options.cancellation = &token;
+
+  auto meshes = std::vector<Mesh>(paths.size());
+  const auto results =
+      thinks::ReadObjFiles(paths, MakeSinkFactory(&meshes), options);
+  for (const auto& result : results) {
+    REQUIRE(!result.ok);
+    REQUIRE(result.result.cancelled);
+    REQUIRE(result.error == "read cancelled");
+  }
+}
+
+TEST_CASE("BATCH - no files") {
+  auto meshes = std::vector<Mesh>{};
+  const auto results = thinks::ReadObjFiles(std::vector<std::string>{},
+                                            MakeSinkFactory(&meshes));
+  REQUIRE(results.empty());
+}
+
+TEST_CASE("BATCH - weld map not supported") {
+  auto meshes = std::vector<Mesh>{};
+  auto weld_map = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.weld_map = &weld_map;
+  REQUIRE_THROWS_WITH(
+      thinks::ReadObjFiles(std::vector<std::string>{},
+                           MakeSinkFactory(&meshes), options),
+      "weld map is not supported for several files");
+}
+
+}  // namespace
@@ -0,0 +1,157 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "read_write_utils.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexGroupType>;
+
+// Flattened record of all callbacks, in call order, and the threads that
+// made them.
+struct Record {
+  std::vector<float> values;
+  std::vector<std::uint32_t> indices;
+  std::vector<std::thread::id> threads;
+};
+
+thinks::ObjReadResult Read(const std::string& input,
+                           const thinks::ObjReadOptions& options,
+                           Record* const record) {
+  auto iss = std::istringstream(input);
+  return thinks::ReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>([record](const auto& pos) {
+        record->values.insert(record->values.end(), pos.values.begin(),
+                              pos.values.end());
+        record->threads.push_back(std::this_thread::get_id());
+      }),
+      thinks::MakeObjAddFunc<ObjFaceType>([record](const auto& face) {
+        if (face.values.size() == 5) {
+          throw std::runtime_error("pentagons are not welcome");
+        }
+        record->indices.push_back(
+            static_cast<std::uint32_t>(face.values.size()));
+        for (const auto& index : face.values) {
+          record->indices.push_back(index.position_index.value);
+          record->indices.push_back(index.tex_coord_index.first.value);
+          record->indices.push_back(index.normal_index.first.value);
+        }
+        record->threads.push_back(std::this_thread::get_id());
+      }),
+      thinks::MakeObjAddFunc<ObjTexCoordType>([record](const auto& tex) {
+        record->values.insert(record->values.end(), tex.values.begin(),
+                              tex.values.end());
+        record->threads.push_back(std::this_thread::get_id());
+      }),
+      thinks::MakeObjAddFunc<ObjNormalType>([record](const auto& normal) {
+        record->values.insert(record->values.end(), normal.values.begin(),
+                              normal.values.end());
+        record->threads.push_back(std::this_thread::get_id());
+      }),
+      options);
+}
+
+// Interleaved elements of all kinds.
+std::string MakeInput(const std::size_t quad_count) {
+  auto options = QuadStripOptions{};
+  options.tex_coords = true;
+  options.normals = true;
+  options.interleaved = true;
+  return MakeQuadStrip(quad_count, options);
+}
+
+TEST_CASE("CALLBACK THREAD - same as direct") {
+  const auto input = MakeInput(20000);
+  auto expected = Record{};
+  const auto expected_result = Read(input, thinks::ObjReadOptions{}, &expected);
+
+  auto options = thinks::ObjReadOptions{};
+  options.callback_thread = true;
+  SECTION("default batches") {}
+  SECTION("small batches and queue") {
+    options.callback_batch_size = 7;
+    options.callback_queue_size = 2;
+  }
+  SECTION("pipelined") { options.pipelined = true; }
+
+  auto record = Record{};
+  const auto result = Read(input, options, &record);
+  REQUIRE(result.position_count == expected_result.position_count);
+  REQUIRE(result.face_count == expected_result.face_count);
+  REQUIRE(result.tex_coord_count == expected_result.tex_coord_count);
+  REQUIRE(result.normal_count == expected_result.normal_count);
+  REQUIRE(record.values == expected.values);
+  REQUIRE(record.indices == expected.indices);
+
+  // All callbacks from one thread, which is not the calling thread.
+  REQUIRE(!record.threads.empty());
+  for (const auto& id : record.threads) {
+    REQUIRE(id == record.threads.front());
+  }
+  REQUIRE(record.threads.front() != std::this_thread::get_id());
+}
+
+TEST_CASE("CALLBACK THREAD - parse error") {
+  const auto input = MakeInput(1000) + "vn 0 0\n" + MakeInput(1000);
+  for (const auto callback_thread : {false, true}) {
+    auto options = thinks::ObjReadOptions{};
+    options.callback_thread = callback_thread;
+    options.callback_batch_size = 64;
+    auto record = Record{};
+    REQUIRE_THROWS_WITH(Read(input, options, &record),
+                        "normals must have 3 values (found 2)");
+
+    // Elements before the error are delivered either way.
+    REQUIRE(record.values.size() == 1001 * (6 + 2 + 3));
+  }
+}
+
+TEST_CASE("CALLBACK THREAD - callback error") {
+  const auto input =
+      MakeInput(1000) + "f 1/1/1 2/2/2 3/3/3 4/4/4 5/5/5\n" + MakeInput(1000);
+  for (const auto callback_thread : {false, true}) {
+    auto options = thinks::ObjReadOptions{};
+    options.callback_thread = callback_thread;
+    options.callback_batch_size = 64;
+    auto record = Record{};
+    REQUIRE_THROWS_WITH(Read(input, options, &record),
+                        "pentagons are not welcome");
+    REQUIRE(record.values.size() == 1001 * (6 + 2 + 3));
+  }
+}
+
+TEST_CASE("CALLBACK THREAD - null callbacks") {
+  auto positions = std::vector<float>{};
+  auto face_count = 0;
+  auto iss = std::istringstream(MakeInput(100));
+  auto options = thinks::ObjReadOptions{};
+  options.callback_thread = true;
+  const auto result = thinks::ReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>([&positions](const auto& pos) {
+        positions.push_back(pos.values[0]);
+      }),
+      thinks::MakeObjAddFunc<ObjFaceType>(
+          [&face_count](const auto&) { ++face_count; }),
+      nullptr, nullptr, options);
+  REQUIRE(result.position_count == 202);
+  REQUIRE(positions.size() == 202);
+  REQUIRE(face_count == 100);
+}
+
+}  // namespace
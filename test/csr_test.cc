@@ -0,0 +1,157 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using IndexType = std::uint32_t;
+
+const auto kInput = std::string(
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "v 2 0 0\n"
+    "vt 0 0\n"
+    "vt 1 1\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/2/1 3/1/1 4/2/1\n"
+    "f 2/2/1 5/1/1 3/2/1\n");
+
+TEST_CASE("CSR - read") {
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+
+  SECTION("index groups") {
+    auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+    auto add_face =
+        thinks::MakeObjCsrAddFunc<thinks::ObjIndexGroup<IndexType>>(&builder);
+    auto iss = std::istringstream(kInput);
+    const auto result = thinks::ReadObj(iss, add_position, add_face);
+    REQUIRE(result.face_count == 2);
+
+    const auto faces = builder.Release();
+    REQUIRE(faces.face_offsets == std::vector<std::uint32_t>{0, 4, 7});
+    REQUIRE(faces.position_indices ==
+            std::vector<IndexType>{0, 1, 2, 3, 1, 4, 2});
+    REQUIRE(faces.tex_coord_indices ==
+            std::vector<IndexType>{0, 1, 0, 1, 1, 0, 1});
+    REQUIRE(faces.normal_indices == std::vector<IndexType>(7, 0));
+    REQUIRE(faces.face_offsets.capacity() == faces.face_offsets.size());
+    REQUIRE(faces.position_indices.capacity() ==
+            faces.position_indices.size());
+    REQUIRE(builder.faces().face_offsets == std::vector<std::uint32_t>{0});
+    REQUIRE(builder.faces().position_indices.empty());
+  }
+
+  SECTION("indices") {
+    auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+    auto add_face =
+        thinks::MakeObjCsrAddFunc<thinks::ObjIndex<IndexType>>(&builder);
+    auto iss = std::istringstream("v 0 0 0\nf 1 1 1 1 1\nf 1 1 1\n");
+    thinks::ReadObj(iss, add_position, add_face);
+
+    const auto faces = builder.Release();
+    REQUIRE(faces.face_offsets == std::vector<std::uint32_t>{0, 5, 8});
+    REQUIRE(faces.position_indices == std::vector<IndexType>(8, 0));
+    REQUIRE(faces.tex_coord_indices.empty());
+    REQUIRE(faces.normal_indices.empty());
+  }
+
+  SECTION("welded") {
+    auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+    auto add_face =
+        thinks::MakeObjCsrAddFunc<thinks::ObjIndex<IndexType>>(&builder);
+    auto options = thinks::ObjReadOptions{};
+    options.weld_positions = true;
+    auto iss = std::istringstream("v 0 0 0\nv 1 0 0\nv 0 0 0\nf 1 2 3\n");
+    thinks::ReadObj(iss, add_position, add_face, nullptr, nullptr, options);
+
+    REQUIRE(builder.faces().position_indices ==
+            std::vector<IndexType>{0, 1, 0});
+  }
+
+  SECTION("generated normals") {
+    auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+    auto add_face =
+        thinks::MakeObjCsrAddFunc<thinks::ObjIndexGroup<IndexType>>(&builder);
+    auto add_normal = thinks::MakeObjAddFunc<thinks::ObjNormal<float>>(
+        [](const auto&) {});
+    auto options = thinks::ObjReadOptions{};
+    options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+    auto iss = std::istringstream(
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+    thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                    options);
+
+    REQUIRE(builder.faces().face_offsets == std::vector<std::uint32_t>{0, 4});
+    REQUIRE(builder.faces().normal_indices ==
+            std::vector<IndexType>{0, 0, 0, 0});
+  }
+}
+
+TEST_CASE("CSR - matches polygon faces") {
+  auto oss = std::ostringstream{};
+  oss << "v 0 0 0\n";
+  for (auto i = 0; i < 1000; ++i) {
+    oss << "f";
+    for (auto j = 0; j < 3 + i % 5; ++j) {
+      oss << " 1";
+    }
+    oss << "\n";
+  }
+  const auto input = oss.str();
+
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+  auto expected = thinks::ObjCsrFaceBuilder<IndexType>{};
+  auto add_polygon = thinks::MakeObjAddFunc<
+      thinks::ObjPolygonFace<thinks::ObjIndex<IndexType>>>(
+      [&expected](const auto& face) { expected.AddFace(face); });
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(iss, add_position, add_polygon);
+
+  auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+  auto add_face =
+      thinks::MakeObjCsrAddFunc<thinks::ObjIndex<IndexType>>(&builder);
+  auto csr_iss = std::istringstream(input);
+  thinks::ReadObj(csr_iss, add_position, add_face);
+
+  REQUIRE(builder.faces().face_offsets == expected.faces().face_offsets);
+  REQUIRE(builder.faces().position_indices ==
+          expected.faces().position_indices);
+}
+
+TEST_CASE("CSR - errors") {
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+  auto builder = thinks::ObjCsrFaceBuilder<IndexType>{};
+  auto add_face =
+      thinks::MakeObjCsrAddFunc<thinks::ObjIndexGroup<IndexType>>(&builder);
+
+  SECTION("too few indices") {
+    auto iss = std::istringstream("f 1 2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face), std::runtime_error,
+        ExceptionContentMatcher{"faces must have at least 3 indices (found 2)"});
+  }
+
+  SECTION("mixed layout") {
+    auto iss = std::istringstream("f 1/1 2/1 3/1\nf 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face), std::runtime_error,
+        ExceptionContentMatcher{
+            "all face corners must have the same index group layout"});
+  }
+}
+
+}  // namespace
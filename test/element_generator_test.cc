@@ -0,0 +1,52 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+#if defined(THINKS_OBJ_IO_HAS_COROUTINES)
+
+TEST_CASE("ELEMENTS - coroutine generator") {
+  const auto input =
+      std::string("v 1 2 3\ng group\nvn 0 0 1\nf 1//1 1//1 1//1");
+  auto types = std::vector<thinks::ObjElementType>{};
+  for (auto gen = thinks::GenerateObjElements(input.data(), input.size());
+       gen.Next();) {
+    types.push_back(gen.value().type);
+  }
+  REQUIRE(types == std::vector<thinks::ObjElementType>{
+                       thinks::ObjElementType::kPosition,
+                       thinks::ObjElementType::kGroup,
+                       thinks::ObjElementType::kNormal,
+                       thinks::ObjElementType::kFace});
+}
+
+TEST_CASE("ELEMENTS - coroutine generator after end") {
+  const auto input = std::string("v 1 2 3\n");
+  auto gen = thinks::GenerateObjElements(input.data(), input.size());
+  REQUIRE(gen.Next());
+  REQUIRE_FALSE(gen.Next());
+  REQUIRE_FALSE(gen.Next());
+  REQUIRE_FALSE(gen.Next());
+}
+
+TEST_CASE("ELEMENTS - coroutine generator errors") {
+  const auto input = std::string("v 1 2 3\nv 1 2\n");
+  auto gen = thinks::GenerateObjElements(input.data(), input.size());
+  REQUIRE(gen.Next());
+  REQUIRE_THROWS_MATCHES(
+      gen.Next(), std::runtime_error,
+      ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+  REQUIRE_FALSE(gen.Next());
+}
+
+#endif  // THINKS_OBJ_IO_HAS_COROUTINES
+
+}  // namespace
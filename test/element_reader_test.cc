@@ -0,0 +1,131 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+const auto kInput = std::string(
+    "# Comment\n"
+    "o cube\n"
+    "v 0 0 0\n"
+    "v 1 0 0 0.5\r\n"
+    "vt 0.25 0.75\n"
+    "vn 0 0 1\n"
+    "\n"
+    "g  side one \n"
+    "s 1\n"
+    "f 1/1/1 2//1 1/1\n"
+    "g\n"
+    "f 2 1 2 1");  // No final newline.
+
+TEST_CASE("ELEMENTS - reader") {
+  thinks::ObjElementReader reader(kInput.data(), kInput.size());
+  auto element = thinks::ObjElement{};
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kGroup);
+  REQUIRE(std::string(element.name, element.name_size) == "cube");
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kPosition);
+  REQUIRE(element.value_count == 3);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kPosition);
+  REQUIRE(element.value_count == 4);
+  REQUIRE(element.values[0] == 1.0);
+  REQUIRE(element.values[3] == 0.5);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kTexCoord);
+  REQUIRE(element.value_count == 2);
+  REQUIRE(element.values[1] == 0.75);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kNormal);
+  REQUIRE(element.values[2] == 1.0);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kGroup);
+  REQUIRE(std::string(element.name, element.name_size) == "side one");
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kFace);
+  REQUIRE(element.corner_count == 3);
+  REQUIRE(element.corners[1].position_index.value == 1);
+  REQUIRE(!element.corners[1].tex_coord_index.second);
+  REQUIRE(element.corners[1].normal_index.second);
+  REQUIRE(element.corners[2].tex_coord_index.second);
+  REQUIRE(!element.corners[2].normal_index.second);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kGroup);
+  REQUIRE(element.name_size == 0);
+
+  REQUIRE(reader.Next(&element));
+  REQUIRE(element.type == thinks::ObjElementType::kFace);
+  REQUIRE(element.corner_count == 4);
+
+  REQUIRE(!reader.Next(&element));
+  REQUIRE(!reader.Next(&element));
+}
+
+TEST_CASE("ELEMENTS - iterator") {
+  auto types = std::vector<thinks::ObjElementType>{};
+  auto corner_count = std::size_t{0};
+  auto elements = thinks::ObjElements(kInput.data(), kInput.size());
+  for (const auto& element : elements) {
+    types.push_back(element.type);
+    if (element.type == thinks::ObjElementType::kFace) {
+      corner_count += element.corner_count;
+    }
+  }
+  REQUIRE(types.size() == 9);
+  REQUIRE(types.back() == thinks::ObjElementType::kFace);
+  REQUIRE(corner_count == 7);
+
+  auto empty = thinks::ObjElements(nullptr, 0);
+  REQUIRE(empty.begin() == empty.end());
+}
+
+TEST_CASE("ELEMENTS - interleaving two inputs") {
+  // Pulling from two readers in lock step, which callbacks cannot do
+  // without buffering.
+  const auto a = std::string("v 1 1 1\nv 2 2 2\n");
+  const auto b = std::string("vn 0 0 1\nvn 0 1 0\n");
+  auto elements_a = thinks::ObjElements(a.data(), a.size());
+  auto elements_b = thinks::ObjElements(b.data(), b.size());
+  auto it_a = elements_a.begin();
+  auto it_b = elements_b.begin();
+  auto sums = std::vector<double>{};
+  for (; it_a != elements_a.end() && it_b != elements_b.end(); ++it_a, ++it_b) {
+    sums.push_back(it_a->values[0] + it_b->values[1]);
+  }
+  REQUIRE(sums == std::vector<double>{1.0, 3.0});
+}
+
+TEST_CASE("ELEMENTS - errors") {
+  const auto input = std::string("v 1 2 3\nbad\n");
+  thinks::ObjElementReader reader(input.data(), input.size());
+  auto element = thinks::ObjElement{};
+  REQUIRE(reader.Next(&element));
+  REQUIRE_THROWS_MATCHES(
+      reader.Next(&element), std::runtime_error,
+      ExceptionContentMatcher{"unrecognized line prefix 'bad'"});
+
+  const auto face = std::string("f 1 0 2\n");
+  thinks::ObjElementReader face_reader(face.data(), face.size());
+  REQUIRE_THROWS_MATCHES(
+      face_reader.Next(&element), std::runtime_error,
+      ExceptionContentMatcher{"parsed index must be greater than zero"});
+}
+
+}  // namespace
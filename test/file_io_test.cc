@@ -0,0 +1,165 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "read_write_utils.h"
+#include "thinks/obj_io/obj_io_file.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjFaceType = thinks::ObjPolygonFace<thinks::ObjIndex<std::uint32_t>>;
+
+// A file in the working directory, removed when going out of scope.
+class TempFile {
+ public:
+  TempFile(const std::string& path, const std::string& content)
+      : path_(path) {
+    std::ofstream(path_, std::ios::binary) << content;
+  }
+
+  ~TempFile() { std::remove(path_.c_str()); }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// A few MiB of quads, so that reads span many blocks. The final line has
+// no newline.
+std::string MakeInput() {
+  auto input = MakeQuadStrip(60000);
+  input.pop_back();
+  return input;
+}
+
+struct Mesh {
+  std::vector<float> positions;
+  std::vector<std::uint32_t> indices;
+};
+
+auto MakeAddPosition(Mesh* const mesh) {
+  return thinks::MakeObjAddFunc<ObjPositionType>([mesh](const auto& pos) {
+    mesh->positions.insert(mesh->positions.end(), pos.values.begin(),
+                           pos.values.end());
+  });
+}
+
+auto MakeAddFace(Mesh* const mesh) {
+  return thinks::MakeObjAddFunc<ObjFaceType>([mesh](const auto& face) {
+    mesh->indices.push_back(static_cast<std::uint32_t>(face.values.size()));
+    for (const auto& index : face.values) {
+      mesh->indices.push_back(index.value);
+    }
+  });
+}
+
+void CheckReadObjFile(const thinks::ObjFileIo file_io) {
+  const auto input = MakeInput();
+  const auto file = TempFile("file_io_test.obj", input);
+
+  auto expected = Mesh{};
+  auto iss = std::istringstream(input);
+  const auto expected_result =
+      thinks::ReadObj(iss, MakeAddPosition(&expected), MakeAddFace(&expected));
+
+  auto mesh = Mesh{};
+  auto options = thinks::ObjReadOptions{};
+  options.file_io = file_io;
+  const auto result =
+      thinks::ReadObjFile(file.path(), MakeAddPosition(&mesh),
+                          MakeAddFace(&mesh), nullptr, nullptr, options);
+
+  REQUIRE(result.position_count == expected_result.position_count);
+  REQUIRE(result.face_count == expected_result.face_count);
+  REQUIRE(mesh.positions == expected.positions);
+  REQUIRE(mesh.indices == expected.indices);
+}
+
+TEST_CASE("FILE IO - pread") { CheckReadObjFile(thinks::ObjFileIo::kPread); }
+
+TEST_CASE("FILE IO - auto") { CheckReadObjFile(thinks::ObjFileIo::kAuto); }
+
+TEST_CASE("FILE IO - io_uring") {
+  if (thinks::ObjIoUringAvailable()) {
+    CheckReadObjFile(thinks::ObjFileIo::kIoUring);
+  } else {
+    auto mesh = Mesh{};
+    auto options = thinks::ObjReadOptions{};
+    options.file_io = thinks::ObjFileIo::kIoUring;
+    REQUIRE_THROWS_WITH(
+        thinks::ReadObjFile("file_io_test.obj", MakeAddPosition(&mesh),
+                            MakeAddFace(&mesh), nullptr, nullptr, options),
+        "io_uring is not available");
+  }
+}
+
+TEST_CASE("FILE IO - cancelled read delivers weld map") {
+  const auto file = TempFile("file_io_weld_test.obj", MakeInput());
+  thinks::ObjCancellationToken token;
+  auto weld_map = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.file_io = thinks::ObjFileIo::kPread;
+  options.progress = [&token](const thinks::ObjProgress&) { token.Cancel(); };
+  options.progress_interval = 1 << 16;
+  options.cancellation = &token;
+  options.weld_positions = true;
+  options.weld_map = &weld_map;
+
+  auto mesh = Mesh{};
+  const auto result =
+      thinks::ReadObjFile(file.path(), MakeAddPosition(&mesh),
+                          MakeAddFace(&mesh), nullptr, nullptr, options);
+  REQUIRE(result.cancelled);
+  REQUIRE(result.position_count > 0);
+  REQUIRE(weld_map.size() == mesh.positions.size() / 3);
+  REQUIRE(result.position_count == mesh.positions.size() / 3);
+}
+
+TEST_CASE("FILE IO - empty file") {
+  const auto file = TempFile("file_io_test_empty.obj", "");
+  for (const auto file_io :
+       {thinks::ObjFileIo::kPread, thinks::ObjFileIo::kAuto}) {
+    auto mesh = Mesh{};
+    auto options = thinks::ObjReadOptions{};
+    options.file_io = file_io;
+    const auto result =
+        thinks::ReadObjFile(file.path(), MakeAddPosition(&mesh),
+                            MakeAddFace(&mesh), nullptr, nullptr, options);
+    REQUIRE(result.position_count == 0);
+    REQUIRE(result.face_count == 0);
+  }
+}
+
+TEST_CASE("FILE IO - parse error") {
+  const auto file = TempFile("file_io_test_error.obj", MakeInput() + "\nx 1");
+  for (const auto file_io :
+       {thinks::ObjFileIo::kPread, thinks::ObjFileIo::kAuto}) {
+    auto mesh = Mesh{};
+    auto options = thinks::ObjReadOptions{};
+    options.file_io = file_io;
+    REQUIRE_THROWS_WITH(
+        thinks::ReadObjFile(file.path(), MakeAddPosition(&mesh),
+                            MakeAddFace(&mesh), nullptr, nullptr, options),
+        "unrecognized line prefix 'x'");
+  }
+}
+
+TEST_CASE("FILE IO - missing file") {
+  auto mesh = Mesh{};
+  REQUIRE_THROWS_WITH(
+      thinks::ReadObjFile("file_io_test_missing.obj", MakeAddPosition(&mesh),
+                          MakeAddFace(&mesh)),
+      "failed to open file 'file_io_test_missing.obj'");
+}
+
+}  // namespace
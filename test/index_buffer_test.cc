@@ -0,0 +1,99 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+TEST_CASE("INDEX_BUFFER - width") {
+  REQUIRE(thinks::ObjIndexWidth(0) == 1);
+  REQUIRE(thinks::ObjIndexWidth(255) == 1);
+  REQUIRE(thinks::ObjIndexWidth(256) == 2);
+  REQUIRE(thinks::ObjIndexWidth(65535) == 2);
+  REQUIRE(thinks::ObjIndexWidth(65536) == 4);
+  REQUIRE_THROWS_AS(thinks::ObjIndexWidth(std::uint64_t{1} << 32),
+                    std::runtime_error);
+
+  REQUIRE(thinks::ObjIndexBuffer(256).width() == 1);
+  REQUIRE(thinks::ObjIndexBuffer(257).width() == 2);
+  REQUIRE(thinks::ObjIndexBuffer(65537).width() == 4);
+}
+
+TEST_CASE("INDEX_BUFFER - adaptive") {
+  auto buffer = thinks::ObjIndexBuffer{};
+  REQUIRE(buffer.width() == 1);
+
+  buffer.push_back(1);
+  buffer.push_back(200);
+  REQUIRE(buffer.width() == 1);
+  REQUIRE(buffer.size() == 2);
+
+  buffer.push_back(1000);
+  REQUIRE(buffer.width() == 2);
+
+  buffer.push_back(70000);
+  REQUIRE(buffer.width() == 4);
+  REQUIRE(buffer.ToVector<std::uint32_t>() ==
+          std::vector<std::uint32_t>{1, 200, 1000, 70000});
+  REQUIRE_THROWS_AS(buffer.ToVector<std::uint16_t>(), std::runtime_error);
+
+  auto raw = std::vector<std::uint32_t>(buffer.size());
+  std::memcpy(raw.data(), buffer.data(), buffer.size() * buffer.width());
+  REQUIRE(raw == std::vector<std::uint32_t>{1, 200, 1000, 70000});
+}
+
+TEST_CASE("INDEX_BUFFER - read") {
+  const auto input = std::string(
+      "v 0 0 0\n"
+      "v 1 0 0\n"
+      "v 0 1 0\n"
+      "f 1 2 3\n"
+      "f 3 2 1\n");
+  auto iss = std::istringstream(input);
+
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+  const auto probe = thinks::ProbeObj(iss);
+  auto buffer = thinks::ObjIndexBuffer(probe.position_count);
+  buffer.reserve(probe.face_index_count);
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+  auto add_face = thinks::MakeObjIndexBufferAddFunc<ObjFaceType>(&buffer);
+
+  const auto result = thinks::ReadObj(iss, add_position, add_face);
+
+  REQUIRE(result.face_count == 2);
+  REQUIRE(buffer.width() == 1);
+  REQUIRE(buffer.ToVector<std::uint8_t>() ==
+          std::vector<std::uint8_t>{0, 1, 2, 2, 1, 0});
+}
+
+TEST_CASE("INDEX_BUFFER - read wide indices") {
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint64_t>>;
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+  auto buffer = thinks::ObjIndexBuffer{};
+  auto add_face = thinks::MakeObjIndexBufferAddFunc<ObjFaceType>(&buffer);
+
+  auto iss = std::istringstream("f 1 2 4294967296\n");
+  thinks::ReadObj(iss, add_position, add_face);
+  REQUIRE(buffer.ToVector<std::uint32_t>() ==
+          std::vector<std::uint32_t>{0, 1, 4294967295});
+
+  // Would wrap to zero.
+  iss = std::istringstream("f 1 2 4294967297\n");
+  REQUIRE_THROWS_MATCHES(thinks::ReadObj(iss, add_position, add_face),
+                         std::runtime_error,
+                         ExceptionContentMatcher{
+                             "index does not fit in 32 bits"});
+}
+
+}  // namespace
@@ -0,0 +1,400 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+// Position (3 x float), normal (3 x snorm16), padding, tex coord
+// (2 x half).
+struct Vertex {
+  float position[3];
+  std::int16_t normal[3];
+  std::uint16_t padding;
+  std::uint16_t tex_coord[2];
+};
+
+thinks::ObjVertexLayout MakeLayout(std::vector<Vertex>* const vertices) {
+  auto layout = thinks::ObjVertexLayout{};
+  layout.data = vertices->data();
+  layout.stride = sizeof(Vertex);
+  layout.vertex_capacity = vertices->size();
+  layout.position.enabled = true;
+  layout.position.offset = offsetof(Vertex, position);
+  layout.normal.enabled = true;
+  layout.normal.offset = offsetof(Vertex, normal);
+  layout.normal.type = thinks::ObjComponentType::kSnorm16;
+  layout.tex_coord.enabled = true;
+  layout.tex_coord.offset = offsetof(Vertex, tex_coord);
+  layout.tex_coord.type = thinks::ObjComponentType::kFloat16;
+  return layout;
+}
+
+float HalfToFloat(const std::uint16_t half) {
+  return thinks::obj_io_internal::convert::HalfToFloat(half);
+}
+
+TEST_CASE("INTERLEAVED - read") {
+  const auto input = std::string(
+      "v 0 0 0\n"
+      "v 1 0 0\n"
+      "v 1 1 0\n"
+      "v 0 1 0\n"
+      "vt 0 0\n"
+      "vt 1 0.5\n"
+      "vn 0 0 1\n"
+      "vn 0 -1 0\n"
+      "f 1/1/1 2/2/1 3/2/1 4/1/1\n"
+      "f 1/1/2 2/2/1 3/2/1\n");
+
+  auto vertices = std::vector<Vertex>(16);
+  std::memset(vertices.data(), 0xff, vertices.size() * sizeof(Vertex));
+  const auto layout = MakeLayout(&vertices);
+  auto indices = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream(input);
+  const auto result = thinks::ReadObjInterleaved(iss, layout, &indices);
+
+  REQUIRE(result.position_count == 4);
+  REQUIRE(result.tex_coord_count == 2);
+  REQUIRE(result.normal_count == 2);
+  REQUIRE(result.face_count == 3);
+  REQUIRE(result.vertex_count == 5);
+  REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3, 4, 1, 2});
+
+  REQUIRE(vertices[2].position[0] == 1.f);
+  REQUIRE(vertices[2].position[1] == 1.f);
+  REQUIRE(vertices[2].position[2] == 0.f);
+  REQUIRE(vertices[2].normal[2] == 32767);
+  REQUIRE(HalfToFloat(vertices[2].tex_coord[0]) == 1.f);
+  REQUIRE(HalfToFloat(vertices[2].tex_coord[1]) == 0.5f);
+  REQUIRE(vertices[4].normal[0] == 0);
+  REQUIRE(vertices[4].normal[1] == -32767);
+
+  // Padding is left untouched.
+  REQUIRE(vertices[0].padding == 0xffff);
+  // Vertices beyond the vertex count are left untouched.
+  REQUIRE(vertices[5].normal[0] == -1);
+}
+
+TEST_CASE("INTERLEAVED - disabled attributes are shared") {
+  auto vertices = std::vector<Vertex>(8);
+  auto layout = MakeLayout(&vertices);
+  layout.normal.enabled = false;
+  layout.tex_coord.enabled = false;
+
+  auto indices = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream(
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nvn 0 0 -1\n"
+      "f 1//1 2//1 3//1\nf 1//2 3//2 2//2\n");
+  const auto result = thinks::ReadObjInterleaved(iss, layout, &indices);
+  REQUIRE(result.vertex_count == 3);
+  REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2, 0, 2, 1});
+}
+
+TEST_CASE("INTERLEAVED - errors") {
+  auto vertices = std::vector<Vertex>(2);
+  const auto layout = MakeLayout(&vertices);
+  auto indices = std::vector<std::uint32_t>{};
+
+  SECTION("capacity") {
+    auto iss = std::istringstream("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+        ExceptionContentMatcher{
+            "vertex count exceeds vertex layout capacity (2)"});
+  }
+
+  SECTION("index out of range") {
+    auto iss = std::istringstream("v 0 0 0\nf 1/2 1/2 1/2\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+        ExceptionContentMatcher{"texture coordinate index 2 out of range "
+                                "(found 0 texture coordinates)"});
+  }
+}
+
+TEST_CASE("INTERLEAVED - half float conversion") {
+  using thinks::obj_io_internal::convert::FloatToHalf;
+
+  REQUIRE(FloatToHalf(0.f) == 0x0000);
+  REQUIRE(FloatToHalf(-0.f) == 0x8000);
+  REQUIRE(FloatToHalf(1.f) == 0x3c00);
+  REQUIRE(FloatToHalf(-2.f) == 0xc000);
+  REQUIRE(FloatToHalf(65504.f) == 0x7bff);
+  REQUIRE(FloatToHalf(65520.f) == 0x7c00);  // Rounds up to infinity.
+  REQUIRE(FloatToHalf(std::numeric_limits<float>::infinity()) == 0x7c00);
+  REQUIRE((FloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) >
+          0x7c00);
+  REQUIRE(FloatToHalf(std::ldexp(1.f, -24)) == 0x0001);  // Smallest.
+  REQUIRE(FloatToHalf(std::ldexp(1.f, -25)) == 0x0000);  // Tie to even.
+  REQUIRE(FloatToHalf(1.f + std::ldexp(1.f, -11)) == 0x3c00);  // Tie to even.
+  REQUIRE(FloatToHalf(1.f + 3 * std::ldexp(1.f, -11)) == 0x3c02);
+
+  // Round trip of every finite half, and relative error bound of 2^-11 for
+  // normal values.
+  for (auto bits = 0u; bits < 0x10000u; ++bits) {
+    const auto half = static_cast<std::uint16_t>(bits);
+    if ((half & 0x7c00u) == 0x7c00u) {
+      continue;
+    }
+    REQUIRE(FloatToHalf(HalfToFloat(half)) == half);
+  }
+  for (auto value = 6.2e-5f; value < 6e4f; value *= 1.01f) {
+    const auto converted = HalfToFloat(FloatToHalf(value));
+    REQUIRE(std::abs(converted - value) <= value * std::ldexp(1.f, -11));
+  }
+}
+
+TEST_CASE("INTERLEAVED - quantized") {
+  // Points on a sphere (Fibonacci spiral) scaled into a box, used as both
+  // positions and normals.
+  constexpr auto kCount = 20000;
+  constexpr auto kPi = 3.14159265358979323846;
+  auto oss = std::ostringstream{};
+  oss.precision(9);
+  auto directions = std::vector<std::array<double, 3>>{};
+  for (auto i = 0; i < kCount; ++i) {
+    const auto z = 1.0 - (2.0 * i + 1.0) / kCount;
+    const auto r = std::sqrt(1.0 - z * z);
+    const auto phi = i * kPi * (3.0 - std::sqrt(5.0));
+    directions.push_back({{r * std::cos(phi), r * std::sin(phi), z}});
+    const auto& d = directions.back();
+    oss << "v " << 10 * d[0] << " " << 2 * d[1] - 3 << " " << d[2] << "\n";
+    oss << "vt " << 0.5 + 0.5 * d[0] << " " << 0.5 + 0.5 * d[1] << "\n";
+    oss << "vn " << d[0] << " " << d[1] << " " << d[2] << "\n";
+  }
+  for (auto i = 1; i + 2 <= kCount; i += 3) {
+    oss << "f " << i << "/" << i << "/" << i << " " << i + 1 << "/" << i + 1
+        << "/" << i + 1 << " " << i + 2 << "/" << i + 2 << "/" << i + 2
+        << "\n";
+  }
+
+  // Position (3 x fixed16), tex coord (2 x unorm16), normal (octahedral).
+  struct QuantizedVertex {
+    std::uint16_t position[3];
+    std::uint16_t tex_coord[2];
+    std::int16_t normal[2];
+  };
+  auto vertices = std::vector<QuantizedVertex>(kCount);
+  auto layout = thinks::ObjVertexLayout{};
+  layout.data = vertices.data();
+  layout.stride = sizeof(QuantizedVertex);
+  layout.vertex_capacity = vertices.size();
+  layout.position = {true, offsetof(QuantizedVertex, position),
+                     thinks::ObjComponentType::kFixed16};
+  layout.tex_coord = {true, offsetof(QuantizedVertex, tex_coord),
+                      thinks::ObjComponentType::kUnorm16};
+  layout.normal = {true, offsetof(QuantizedVertex, normal),
+                   thinks::ObjComponentType::kOctahedral16};
+
+  auto iss = std::istringstream(oss.str());
+  layout.position_bounds = thinks::ProbeObjPositionBounds(iss);
+  REQUIRE(layout.position_bounds.min[0] < -9.99f);
+  REQUIRE(layout.position_bounds.max[1] > -1.01f);
+
+  auto indices = std::vector<std::uint32_t>{};
+  const auto result = thinks::ReadObjInterleaved(iss, layout, &indices);
+  REQUIRE(result.vertex_count == kCount / 3 * 3);
+
+  const auto& bounds = layout.position_bounds;
+  auto max_angle = 0.0;
+  for (auto i = std::size_t{0}; i < result.vertex_count; ++i) {
+    const auto& d = directions[i];
+    const auto& vertex = vertices[i];
+
+    // Fixed point positions are within half a step of the input.
+    const auto expected =
+        std::array<double, 3>{{10 * d[0], 2 * d[1] - 3, d[2]}};
+    for (auto k = 0; k < 3; ++k) {
+      const auto extent = double{bounds.max[k]} - bounds.min[k];
+      const auto decoded =
+          bounds.min[k] + vertex.position[k] / 65535.0 * extent;
+      REQUIRE(std::abs(decoded - expected[k]) <=
+              0.5 * extent / 65535 + 1e-6 * extent);
+    }
+
+    // Unorm16 texture coordinates are within half a step.
+    REQUIRE(std::abs(vertex.tex_coord[0] / 65535.0 - (0.5 + 0.5 * d[0])) <=
+            0.5 / 65535 + 1e-7);
+    REQUIRE(std::abs(vertex.tex_coord[1] / 65535.0 - (0.5 + 0.5 * d[1])) <=
+            0.5 / 65535 + 1e-7);
+
+    const auto decoded = thinks::obj_io_internal::convert::OctahedralDecode(
+        {{vertex.normal[0], vertex.normal[1]}});
+    const auto dot = decoded[0] * d[0] + decoded[1] * d[1] + decoded[2] * d[2];
+    max_angle = std::max(max_angle, std::acos(std::min(1.0, dot)));
+  }
+
+  // Octahedral 2x16 bits keeps normals within 0.005 degrees.
+  REQUIRE(max_angle < 0.005 * kPi / 180);
+}
+
+TEST_CASE("INTERLEAVED - position bounds") {
+  struct FixedVertex {
+    std::uint16_t position[3];
+    std::uint16_t padding;
+  };
+  auto vertices = std::vector<FixedVertex>(3);
+  auto layout = thinks::ObjVertexLayout{};
+  layout.data = vertices.data();
+  layout.stride = sizeof(FixedVertex);
+  layout.vertex_capacity = vertices.size();
+  layout.position = {true, offsetof(FixedVertex, position),
+                     thinks::ObjComponentType::kFixed16};
+  auto indices = std::vector<std::uint32_t>{};
+
+  SECTION("empty input") {
+    auto iss = std::istringstream("# no positions\n");
+    layout.position_bounds = thinks::ProbeObjPositionBounds(iss);
+    REQUIRE(layout.position_bounds.min[0] > layout.position_bounds.max[0]);
+    const auto result = thinks::ReadObjInterleaved(iss, layout, &indices);
+    REQUIRE(result.vertex_count == 0);
+  }
+
+  SECTION("empty bounds") {
+    layout.position_bounds.min.fill(1.f);
+    layout.position_bounds.max.fill(-1.f);
+    auto iss = std::istringstream("v 0.5 0.5 0.5\nf 1 1 1\n");
+    const auto result = thinks::ReadObjInterleaved(iss, layout, &indices);
+    REQUIRE(result.vertex_count == 1);
+    REQUIRE(vertices[0].position[0] == 0);
+  }
+
+  SECTION("ignored for other position types") {
+    layout.position.type = thinks::ObjComponentType::kFloat16;
+    layout.position_bounds.min[0] = std::numeric_limits<float>::quiet_NaN();
+    auto iss = std::istringstream("v 0 0 0\n");
+    REQUIRE(thinks::ReadObjInterleaved(iss, layout, &indices)
+                .position_count == 1);
+  }
+
+  SECTION("NaN") {
+    layout.position_bounds.max[2] = std::numeric_limits<float>::quiet_NaN();
+    auto iss = std::istringstream("v 0 0 0\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+        ExceptionContentMatcher{"position bounds must not be NaN"});
+  }
+}
+
+TEST_CASE("INTERLEAVED - half positions") {
+  struct HalfVertex {
+    std::uint16_t position[3];
+    std::uint16_t padding;
+  };
+  auto vertices = std::vector<HalfVertex>(3);
+  auto layout = thinks::ObjVertexLayout{};
+  layout.data = vertices.data();
+  layout.stride = sizeof(HalfVertex);
+  layout.vertex_capacity = vertices.size();
+  layout.position = {true, offsetof(HalfVertex, position),
+                     thinks::ObjComponentType::kFloat16};
+
+  const auto values = std::vector<float>{0.1f, -123.456f, 7777.f,
+                                         1e-3f, 1.f,      -0.3333f,
+                                         42.42f, 5e3f,    -9e-2f};
+  auto oss = std::ostringstream{};
+  oss.precision(9);
+  for (auto i = 0; i < 3; ++i) {
+    oss << "v " << values[3 * i] << " " << values[3 * i + 1] << " "
+        << values[3 * i + 2] << "\n";
+  }
+  oss << "f 1 2 3\n";
+  auto iss = std::istringstream(oss.str());
+  auto indices = std::vector<std::uint32_t>{};
+  thinks::ReadObjInterleaved(iss, layout, &indices);
+
+  for (auto i = 0; i < 9; ++i) {
+    const auto decoded = HalfToFloat(vertices[i / 3].position[i % 3]);
+    REQUIRE(std::abs(decoded - values[i]) <=
+            std::abs(values[i]) * std::ldexp(1.f, -11));
+  }
+}
+
+TEST_CASE("INTERLEAVED - octahedral round trip") {
+  using thinks::obj_io_internal::convert::OctahedralDecode;
+  using thinks::obj_io_internal::convert::OctahedralEncode;
+
+  // Axes and diagonals are exact (or nearly so).
+  for (const auto& n : std::vector<std::array<double, 3>>{
+           {{1, 0, 0}}, {{-1, 0, 0}}, {{0, 1, 0}}, {{0, -1, 0}},
+           {{0, 0, 1}}, {{0, 0, -1}}}) {
+    const auto decoded = OctahedralDecode(OctahedralEncode(n));
+    for (auto k = 0; k < 3; ++k) {
+      REQUIRE(std::abs(decoded[k] - n[k]) < 1e-4);
+    }
+  }
+
+  // Unnormalized input is normalized, a zero vector does not produce NaN.
+  const auto decoded = OctahedralDecode(OctahedralEncode({{0, 0, -5}}));
+  REQUIRE(std::abs(decoded[2] + 1) < 1e-4);
+  const auto zero = OctahedralDecode(OctahedralEncode({{0, 0, 0}}));
+  REQUIRE(zero[2] == 1.0);
+}
+
+TEST_CASE("INTERLEAVED - invalid layout") {
+  auto vertices = std::vector<Vertex>(1);
+  auto layout = MakeLayout(&vertices);
+  auto indices = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream("v 0 0 0\n");
+
+  layout.tex_coord.type = thinks::ObjComponentType::kOctahedral16;
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+      ExceptionContentMatcher{"octahedral encoding only applies to normals"});
+
+  layout = MakeLayout(&vertices);
+  layout.normal.type = thinks::ObjComponentType::kFixed16;
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+      ExceptionContentMatcher{
+          "fixed point encoding only applies to positions"});
+
+  layout = MakeLayout(&vertices);
+  layout.stride = 0;
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+      ExceptionContentMatcher{"vertex layout stride must not be zero"});
+
+  // The half float texture coordinate ends exactly at the stride.
+  layout = MakeLayout(&vertices);
+  layout.tex_coord.type = thinks::ObjComponentType::kFloat32;
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+      ExceptionContentMatcher{"texture coordinate attribute (offset 20, "
+                              "size 8) does not fit vertex stride 24"});
+
+  layout = MakeLayout(&vertices);
+  layout.normal.offset = std::numeric_limits<std::size_t>::max();
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, &indices), std::runtime_error,
+      ExceptionContentMatcher{"normal attribute (offset " +
+                              std::to_string(layout.normal.offset) +
+                              ", size 6) does not fit vertex stride 24"});
+
+  // Disabled attributes are not placed.
+  layout.normal.enabled = false;
+  auto empty = std::istringstream("v 0 0 0\n");
+  REQUIRE(thinks::ReadObjInterleaved(empty, layout, &indices)
+              .position_count == 1);
+
+  layout = MakeLayout(&vertices);
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObjInterleaved(iss, layout, nullptr), std::runtime_error,
+      ExceptionContentMatcher{"indices must not be null"});
+}
+
+}  // namespace
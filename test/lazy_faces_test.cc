@@ -0,0 +1,169 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "read_write_utils.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexGroupType>;
+using ObjTriangleType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+// Quad strip with texture coordinate indices and CRLF line endings.
+std::string MakeInput(const std::size_t quad_count) {
+  auto options = QuadStripOptions{};
+  options.tex_coords = true;
+  options.line_end = "\r\n";
+  return MakeQuadStrip(quad_count, options);
+}
+
+template <typename FaceT>
+auto MakeAddFace(std::vector<std::uint32_t>* const indices) {
+  return thinks::MakeObjAddFunc<FaceT>([indices](const auto& face) {
+    for (const auto& index : face.values) {
+      indices->push_back(index.position_index.value);
+      indices->push_back(index.tex_coord_index.first.value);
+    }
+    indices->push_back(~0u);
+  });
+}
+
+thinks::ObjLazyFaces ReadLazy(const std::string& input,
+                              const thinks::ObjReadOptions& options =
+                                  thinks::ObjReadOptions{}) {
+  auto faces = thinks::ObjLazyFaces{};
+  auto position_count = std::uint32_t{0};
+  auto iss = std::istringstream(input);
+  const auto result = thinks::ReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>(
+          [&position_count](const auto&) { ++position_count; }),
+      thinks::MakeObjLazyFaceAddFunc(&faces), nullptr, nullptr, options);
+  REQUIRE(result.position_count == position_count);
+  REQUIRE(result.face_count == faces.size());
+  return faces;
+}
+
+TEST_CASE("LAZY FACES - decode matches eager read") {
+  const auto input = MakeInput(40000) + "f 1/1 3/2 4/2\t2/1\r\n";
+  auto expected = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(iss,
+                  thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+                  MakeAddFace<ObjFaceType>(&expected));
+
+  auto options = thinks::ObjReadOptions{};
+  SECTION("sequential") {}
+  SECTION("callback thread") { options.callback_thread = true; }
+  const auto faces = ReadLazy(input, options);
+  REQUIRE(faces.size() == 40001);
+  REQUIRE(faces.FaceText(0) == " 1/1 3/2 4/2 2/1\r");
+  REQUIRE(faces.FaceText(40000) == " 1/1 3/2 4/2\t2/1\r");
+
+  for (const auto thread_count : {1u, 3u, 8u}) {
+    auto decode_options = thinks::ObjReadOptions{};
+    decode_options.thread_count = thread_count;
+    auto indices = std::vector<std::uint32_t>{};
+    const auto count = thinks::DecodeObjFaces(
+        faces, 0, faces.size(), MakeAddFace<ObjFaceType>(&indices),
+        decode_options);
+    REQUIRE(count == faces.size());
+    REQUIRE(indices == expected);
+  }
+}
+
+TEST_CASE("LAZY FACES - decode into CSR") {
+  // More faces than a decode chunk, so that several threads are used.
+  const auto input = MakeInput(40000);
+  auto expected_builder = thinks::ObjCsrFaceBuilder<std::uint32_t>{};
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(iss,
+                  thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+                  thinks::MakeObjCsrAddFunc<ObjIndexGroupType>(
+                      &expected_builder));
+  const auto expected = expected_builder.Release();
+
+  const auto faces = ReadLazy(input);
+  for (const auto thread_count : {1u, 3u, 8u}) {
+    auto options = thinks::ObjReadOptions{};
+    options.thread_count = thread_count;
+    auto builder = thinks::ObjCsrFaceBuilder<std::uint32_t>{};
+    const auto count = thinks::DecodeObjFaces(
+        faces, 0, faces.size(),
+        thinks::MakeObjCsrAddFunc<ObjIndexGroupType>(&builder), options);
+    REQUIRE(count == faces.size());
+    const auto csr = builder.Release();
+    REQUIRE(csr.face_offsets == expected.face_offsets);
+    REQUIRE(csr.position_indices == expected.position_indices);
+    REQUIRE(csr.tex_coord_indices == expected.tex_coord_indices);
+    REQUIRE(csr.normal_indices.empty());
+  }
+}
+
+TEST_CASE("LAZY FACES - decode range") {
+  const auto faces = ReadLazy(MakeInput(10));
+  auto indices = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.triangulation = thinks::ObjTriangulation::kFan;
+  const auto count = thinks::DecodeObjFaces(
+      faces, 2, 3, MakeAddFace<ObjTriangleType>(&indices), options);
+  REQUIRE(count == 2);
+  REQUIRE(indices == std::vector<std::uint32_t>{4, 2, 6, 3, 7, 3, ~0u,
+                                                4, 2, 7, 3, 5, 2, ~0u});
+
+  REQUIRE_THROWS_MATCHES(
+      thinks::DecodeObjFaces(faces, 5, 11,
+                             MakeAddFace<ObjFaceType>(&indices)),
+      std::runtime_error,
+      ExceptionContentMatcher{"invalid face range [5, 11) (found 10 faces)"});
+}
+
+TEST_CASE("LAZY FACES - decode error") {
+  auto input = MakeInput(50000);
+  input += "f 1 2 x\n";
+  input += MakeInput(10);
+  const auto faces = ReadLazy(input);
+
+  for (const auto thread_count : {1u, 4u}) {
+    auto options = thinks::ObjReadOptions{};
+    options.thread_count = thread_count;
+    auto indices = std::vector<std::uint32_t>{};
+    REQUIRE_THROWS_MATCHES(
+        thinks::DecodeObjFaces(faces, 0, faces.size(),
+                               MakeAddFace<ObjFaceType>(&indices), options),
+        std::runtime_error, ExceptionContentMatcher{"failed parsing 'x'"});
+
+    // Faces before the error are passed on.
+    REQUIRE(indices.size() == 50000 * 9);
+  }
+}
+
+TEST_CASE("LAZY FACES - unsupported options") {
+  auto options = thinks::ObjReadOptions{};
+  SECTION("triangulation") {
+    options.triangulation = thinks::ObjTriangulation::kFan;
+    REQUIRE_THROWS_MATCHES(
+        ReadLazy("f 1 2 3\n", options), std::runtime_error,
+        ExceptionContentMatcher{"lazy faces are triangulated when decoded"});
+  }
+  SECTION("welding") {
+    options.weld_positions = true;
+    REQUIRE_THROWS_MATCHES(
+        ReadLazy("f 1 2 3\n", options), std::runtime_error,
+        ExceptionContentMatcher{
+            "lazy faces do not support welding or normal generation"});
+  }
+}
+
+}  // namespace
@@ -0,0 +1,99 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <clocale>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+// Sets LC_NUMERIC to a locale with a comma as decimal point, if one is
+// installed, and restores the previous locale when going out of scope.
+class CommaDecimalLocale {
+ public:
+  CommaDecimalLocale() : previous_(std::setlocale(LC_NUMERIC, nullptr)) {
+    for (const auto* const name :
+         {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8",
+          "fr_FR", "German_Germany.1252", "French_France.1252"}) {
+      if (std::setlocale(LC_NUMERIC, name) != nullptr) {
+        if (*std::localeconv()->decimal_point == ',') {
+          active_ = true;
+          return;
+        }
+        std::setlocale(LC_NUMERIC, previous_.c_str());
+      }
+    }
+  }
+
+  ~CommaDecimalLocale() { std::setlocale(LC_NUMERIC, previous_.c_str()); }
+
+  bool active() const noexcept { return active_; }
+
+ private:
+  std::string previous_;
+  bool active_ = false;
+};
+
+const auto kInput = std::string(
+    "v 0.5 1.25 -2.75\n"
+    "v 1e-1 .5 3.\n"
+    "vn 0.25 0.5 0.75\n"
+    "f 1//1 2//1 1//1\n");
+
+TEST_CASE("LOCALE - reals are parsed with a '.' decimal point") {
+  const auto locale = CommaDecimalLocale{};
+  if (!locale.active()) {
+    WARN("no comma decimal locale installed, skipping");
+    return;
+  }
+
+  SECTION("ReadObj") {
+    auto positions = std::vector<double>{};
+    auto normals = std::vector<float>{};
+    auto iss = std::istringstream(kInput);
+    thinks::ReadObj(
+        iss,
+        thinks::MakeObjAddFunc<thinks::ObjPosition<double, 3>>(
+            [&positions](const auto& pos) {
+              positions.insert(positions.end(), pos.values.begin(),
+                               pos.values.end());
+            }),
+        thinks::MakeObjAddFunc<thinks::ObjTriangleFace<
+            thinks::ObjIndexGroup<std::uint32_t>>>([](const auto&) {}),
+        nullptr,
+        thinks::MakeObjAddFunc<thinks::ObjNormal<float>>(
+            [&normals](const auto& normal) {
+              normals.insert(normals.end(), normal.values.begin(),
+                             normal.values.end());
+            }));
+    REQUIRE(positions == std::vector<double>{0.5, 1.25, -2.75, 0.1, 0.5, 3.0});
+    REQUIRE(normals == std::vector<float>{0.25f, 0.5f, 0.75f});
+  }
+
+  SECTION("ReadObjToSoA") {
+    auto iss = std::istringstream(kInput);
+    const auto mesh = thinks::ReadObjToSoA(iss);
+    REQUIRE(std::vector<float>(mesh.x.begin(), mesh.x.end()) ==
+            std::vector<float>{0.5f, 0.1f});
+    REQUIRE(std::vector<float>(mesh.y.begin(), mesh.y.end()) ==
+            std::vector<float>{1.25f, 0.5f});
+    REQUIRE(std::vector<float>(mesh.z.begin(), mesh.z.end()) ==
+            std::vector<float>{-2.75f, 3.0f});
+  }
+
+  SECTION("ProbeObjPositionBounds") {
+    auto iss = std::istringstream(kInput);
+    const auto bounds = thinks::ProbeObjPositionBounds(iss);
+    REQUIRE(bounds.min[0] == 0.1f);
+    REQUIRE(bounds.max[1] == 1.25f);
+    REQUIRE(bounds.min[2] == -2.75f);
+  }
+}
+
+}  // namespace
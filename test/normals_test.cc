@@ -0,0 +1,316 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+
+struct NormalMesh {
+  std::vector<std::array<float, 3>> normals;
+  std::vector<std::uint32_t> position_indices;
+  std::vector<std::uint32_t> normal_indices;
+  std::vector<std::uint32_t> face_sizes;
+};
+
+template <typename FaceT>
+NormalMesh ReadNormalMesh(const std::string& input,
+                          const thinks::ObjReadOptions& options,
+                          thinks::ObjReadResult* const result = nullptr) {
+  auto mesh = NormalMesh{};
+  auto add_position =
+      thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {});
+  auto add_face = thinks::MakeObjAddFunc<FaceT>([&mesh](const auto& face) {
+    for (const auto& index : face.values) {
+      REQUIRE(index.normal_index.second);
+      mesh.position_indices.push_back(index.position_index.value);
+      mesh.normal_indices.push_back(index.normal_index.first.value);
+    }
+    mesh.face_sizes.push_back(static_cast<std::uint32_t>(face.values.size()));
+  });
+  auto add_normal =
+      thinks::MakeObjAddFunc<ObjNormalType>([&mesh](const auto& normal) {
+        mesh.normals.push_back(normal.values);
+      });
+
+  auto iss = std::istringstream(input);
+  const auto read_result = thinks::ReadObj(iss, add_position, add_face,
+                                           nullptr, add_normal, options);
+  if (result != nullptr) {
+    *result = read_result;
+  }
+  return mesh;
+}
+
+bool Near(const std::array<float, 3>& normal, const double x, const double y,
+          const double z) {
+  constexpr auto kEps = 1e-6;
+  return std::abs(normal[0] - x) < kEps && std::abs(normal[1] - y) < kEps &&
+         std::abs(normal[2] - z) < kEps;
+}
+
+// Two triangles folded at a right angle along the edge (1, 2). The second
+// triangle has twice the area of the first.
+const auto kFoldPositions = std::string(
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 0 1 0\n"
+    "v 0 0 2\n");
+
+TEST_CASE("NORMALS - smoothing groups") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+
+  SECTION("smooth") {
+    auto result = thinks::ObjReadResult{};
+    const auto mesh = ReadNormalMesh<ObjFaceType>(
+        kFoldPositions + "s 1\nf 1 2 3\nf 1 4 2\n", options, &result);
+
+    REQUIRE(result.normal_count == 4);
+    REQUIRE(result.face_count == 2);
+    REQUIRE(mesh.normals.size() == 4);
+    REQUIRE(Near(mesh.normals[0], 0, 2 / std::sqrt(5.0), 1 / std::sqrt(5.0)));
+    REQUIRE(Near(mesh.normals[1], 0, 2 / std::sqrt(5.0), 1 / std::sqrt(5.0)));
+    REQUIRE(Near(mesh.normals[2], 0, 0, 1));
+    REQUIRE(Near(mesh.normals[3], 0, 1, 0));
+    REQUIRE(mesh.position_indices ==
+            std::vector<std::uint32_t>{0, 1, 2, 0, 3, 1});
+    REQUIRE(mesh.normal_indices == std::vector<std::uint32_t>{0, 1, 2, 0, 3, 1});
+  }
+
+  SECTION("angle weighted") {
+    options.generate_normals = thinks::ObjNormalGeneration::kAngleWeighted;
+    const auto mesh = ReadNormalMesh<ObjFaceType>(
+        kFoldPositions + "s 1\nf 1 2 3\nf 1 4 2\n", options);
+
+    // Both faces have a right angle at position 1.
+    REQUIRE(mesh.normals.size() == 4);
+    REQUIRE(Near(mesh.normals[0], 0, 1 / std::sqrt(2.0), 1 / std::sqrt(2.0)));
+    REQUIRE(Near(mesh.normals[2], 0, 0, 1));
+  }
+
+  SECTION("flat") {
+    for (const auto& group : {std::string("s off\n"), std::string("s 0\n"),
+                              std::string()}) {
+      const auto mesh = ReadNormalMesh<ObjFaceType>(
+          kFoldPositions + group + "f 1 2 3\nf 1 4 2\n", options);
+
+      REQUIRE(mesh.normals.size() == 2);
+      REQUIRE(Near(mesh.normals[0], 0, 0, 1));
+      REQUIRE(Near(mesh.normals[1], 0, 1, 0));
+      REQUIRE(mesh.normal_indices ==
+              std::vector<std::uint32_t>{0, 0, 0, 1, 1, 1});
+    }
+  }
+
+  SECTION("different groups") {
+    const auto mesh = ReadNormalMesh<ObjFaceType>(
+        kFoldPositions + "s 1\nf 1 2 3\ns 2\nf 1 4 2\n", options);
+
+    REQUIRE(mesh.normals.size() == 6);
+    REQUIRE(mesh.normal_indices == std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5});
+  }
+
+  SECTION("triangulated polygon") {
+    options.triangulation = thinks::ObjTriangulation::kFan;
+    const auto mesh = ReadNormalMesh<ObjFaceType>(
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\ns 1\nf 1 2 3 4\n", options);
+
+    REQUIRE(mesh.normals.size() == 4);
+    for (const auto& normal : mesh.normals) {
+      REQUIRE(Near(normal, 0, 0, 1));
+    }
+    REQUIRE(mesh.normal_indices == std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3});
+  }
+}
+
+TEST_CASE("NORMALS - polygon faces") {
+  using ObjFaceType = thinks::ObjPolygonFace<ObjIndexGroupType>;
+
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+  const auto mesh = ReadNormalMesh<ObjFaceType>(
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\n"
+      "s 1\nf 1 2 3 4\nf 1 5 2\n",
+      options);
+
+  REQUIRE(mesh.face_sizes == std::vector<std::uint32_t>{4, 3});
+  REQUIRE(mesh.normals.size() == 5);
+  REQUIRE(Near(mesh.normals[0], 0, 1 / std::sqrt(5.0), 2 / std::sqrt(5.0)));
+  REQUIRE(Near(mesh.normals[2], 0, 0, 1));
+  REQUIRE(mesh.normal_indices ==
+          std::vector<std::uint32_t>{0, 1, 2, 3, 0, 4, 1});
+}
+
+TEST_CASE("NORMALS - file normals are kept") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+  auto result = thinks::ObjReadResult{};
+  const auto mesh = ReadNormalMesh<ObjFaceType>(
+      kFoldPositions + "vn 1 0 0\ns 1\nf 1//1 2//1 3//1\n", options, &result);
+
+  REQUIRE(result.normal_count == 1);
+  REQUIRE(result.face_count == 1);
+  REQUIRE(mesh.normals.size() == 1);
+  REQUIRE(Near(mesh.normals[0], 1, 0, 0));
+  REQUIRE(mesh.normal_indices == std::vector<std::uint32_t>{0, 0, 0});
+}
+
+TEST_CASE("NORMALS - faces are not held back once file normals are found") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+  SECTION("direct") {}
+  SECTION("callback thread") { options.callback_thread = true; }
+
+  // Elements in the order they reach the callbacks.
+  auto events = std::string{};
+  auto iss = std::istringstream(kFoldPositions +
+                                "f 1//1 2//1 3//1\n"
+                                "vn 1 0 0\n"
+                                "f 1//1 2//1 4//1\n"
+                                "vn 0 1 0\n"
+                                "f 1//2 3//2 4//2\n");
+  const auto result = thinks::ReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjAddFunc<ObjFaceType>([&events](const auto& face) {
+        REQUIRE(face.values[0].normal_index.second);
+        events += 'f';
+      }),
+      nullptr,
+      thinks::MakeObjAddFunc<ObjNormalType>(
+          [&events](const auto&) { events += 'n'; }),
+      options);
+
+  REQUIRE(events == "fnfnf");
+  REQUIRE(result.face_count == 3);
+  REQUIRE(result.normal_count == 2);
+}
+
+TEST_CASE("NORMALS - thread count does not change result") {
+  using ObjFaceType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+  // Bumpy grid of quads split into triangles.
+  constexpr auto kSize = 64;
+  auto oss = std::ostringstream{};
+  for (auto y = 0; y <= kSize; ++y) {
+    for (auto x = 0; x <= kSize; ++x) {
+      oss << "v " << x << " " << y << " " << ((x * 7 + y * 13) % 5) * 0.1
+          << "\n";
+    }
+  }
+  oss << "s 1\n";
+  for (auto y = 0; y < kSize; ++y) {
+    for (auto x = 0; x < kSize; ++x) {
+      const auto i = y * (kSize + 1) + x + 1;
+      oss << "f " << i << " " << i + 1 << " " << i + kSize + 2 << "\n";
+      oss << "f " << i << " " << i + kSize + 2 << " " << i + kSize + 1
+          << "\n";
+    }
+  }
+
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAngleWeighted;
+  const auto expected = ReadNormalMesh<ObjFaceType>(oss.str(), options);
+  REQUIRE(expected.normals.size() == (kSize + 1) * (kSize + 1));
+
+  for (const auto thread_count : {2u, 3u, 8u}) {
+    options.thread_count = thread_count;
+    const auto mesh = ReadNormalMesh<ObjFaceType>(oss.str(), options);
+    REQUIRE(mesh.normals == expected.normals);
+    REQUIRE(mesh.normal_indices == expected.normal_indices);
+  }
+}
+
+TEST_CASE("NORMALS - errors") {
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+  auto add_position =
+      thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {});
+  auto add_normal = thinks::MakeObjAddFunc<ObjNormalType>([](const auto&) {});
+
+  SECTION("index faces") {
+    auto add_face = thinks::MakeObjAddFunc<
+        thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>>(
+        [](const auto&) {});
+    auto iss = std::istringstream(kFoldPositions + "f 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "normal generation requires index group faces"});
+  }
+
+  auto add_face =
+      thinks::MakeObjAddFunc<thinks::ObjTriangleFace<ObjIndexGroupType>>(
+          [](const auto&) {});
+
+  SECTION("no normal callback") {
+    auto iss = std::istringstream(kFoldPositions + "f 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, nullptr,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "normal generation requires a normal callback"});
+  }
+
+  SECTION("bad smoothing group") {
+    auto iss = std::istringstream(kFoldPositions + "s x\nf 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{"failed parsing smoothing group 'x'"});
+  }
+
+  SECTION("negative smoothing group") {
+    auto iss = std::istringstream(kFoldPositions + "s -1\nf 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{"failed parsing smoothing group '-1'"});
+  }
+
+  SECTION("smoothing group out of range") {
+    auto iss = std::istringstream(kFoldPositions + "s 4294967296\nf 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "failed parsing smoothing group '4294967296'"});
+  }
+
+  SECTION("position index out of range") {
+    auto iss = std::istringstream(kFoldPositions + "f 1 2 9\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, add_normal,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "position index 9 out of range (found 4 positions)"});
+  }
+}
+
+}  // namespace
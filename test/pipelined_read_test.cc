@@ -0,0 +1,174 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjFaceType = thinks::ObjPolygonFace<thinks::ObjIndex<std::uint32_t>>;
+
+// Hands out |data| in small chunks, like a decompressor would, and throws
+// once |fail_at| bytes have been handed out.
+class ChunkedStreamBuf : public std::streambuf {
+ public:
+  ChunkedStreamBuf(const std::string& data, const std::size_t fail_at)
+      : data_(data), fail_at_(fail_at) {}
+
+ protected:
+  int_type underflow() override {
+    if (pos_ >= fail_at_) {
+      throw std::runtime_error("device error");
+    }
+    if (pos_ >= data_.size()) {
+      return traits_type::eof();
+    }
+    const auto n = std::min<std::size_t>(977, data_.size() - pos_);
+    auto* const first = &data_[pos_];
+    setg(first, first, first + n);
+    pos_ += n;
+    return traits_type::to_int_type(*first);
+  }
+
+ private:
+  std::string data_;
+  std::size_t fail_at_;
+  std::size_t pos_ = 0;
+};
+
+std::string MakeInput() {
+  auto oss = std::ostringstream{};
+  const auto kCount = 50000;
+  for (auto i = 0; i < kCount; ++i) {
+    oss << "v " << i << " " << 0.5 * i << " 0.125\n";
+  }
+  for (auto i = 0; i + 3 < kCount; ++i) {
+    oss << "f " << i + 1 << " " << i + 2 << " " << i + 3 << " " << i + 4
+        << "\n";
+  }
+  return oss.str();
+}
+
+struct Mesh {
+  std::vector<float> positions;
+  std::vector<std::uint32_t> indices;
+};
+
+thinks::ObjReadResult Read(std::istream& is, const bool pipelined,
+                           Mesh* const mesh,
+                           thinks::ObjReadOptions options = {}) {
+  options.pipelined = pipelined;
+  return thinks::ReadObj(
+      is,
+      thinks::MakeObjAddFunc<ObjPositionType>([mesh](const auto& pos) {
+        mesh->positions.insert(mesh->positions.end(), pos.values.begin(),
+                               pos.values.end());
+      }),
+      thinks::MakeObjAddFunc<ObjFaceType>([mesh](const auto& face) {
+        mesh->indices.push_back(
+            static_cast<std::uint32_t>(face.values.size()));
+        for (const auto& index : face.values) {
+          mesh->indices.push_back(index.value);
+        }
+      }),
+      nullptr, nullptr, options);
+}
+
+TEST_CASE("PIPELINED - same as sequential") {
+  const auto input = MakeInput();
+  auto expected = Mesh{};
+  auto expected_iss = std::istringstream(input);
+  const auto expected_result = Read(expected_iss, false, &expected);
+
+  SECTION("large blocks") {
+    auto mesh = Mesh{};
+    auto iss = std::istringstream(input);
+    const auto result = Read(iss, true, &mesh);
+    REQUIRE(result.position_count == expected_result.position_count);
+    REQUIRE(result.face_count == expected_result.face_count);
+    REQUIRE(mesh.positions == expected.positions);
+    REQUIRE(mesh.indices == expected.indices);
+    REQUIRE(iss.eof());
+  }
+
+  SECTION("small blocks, lines straddling blocks") {
+    // A progress callback limits the block size to the progress interval.
+    auto options = thinks::ObjReadOptions{};
+    auto report_count = 0;
+    options.progress = [&report_count](const thinks::ObjProgress&) {
+      ++report_count;
+    };
+    options.progress_interval = 4099;
+
+    auto mesh = Mesh{};
+    auto buf = ChunkedStreamBuf(input, input.size() + 1);
+    std::istream is(&buf);
+    const auto result = Read(is, true, &mesh, options);
+    REQUIRE(result.face_count == expected_result.face_count);
+    REQUIRE(mesh.positions == expected.positions);
+    REQUIRE(mesh.indices == expected.indices);
+    REQUIRE(report_count > 100);
+  }
+}
+
+TEST_CASE("PIPELINED - parse error") {
+  const auto input = MakeInput() + "x 1 2 3\n" + MakeInput();
+  auto mesh = Mesh{};
+  auto iss = std::istringstream(input);
+  REQUIRE_THROWS_WITH(Read(iss, true, &mesh), "unrecognized line prefix 'x'");
+}
+
+TEST_CASE("PIPELINED - read error") {
+  const auto input = MakeInput();
+  for (const auto pipelined : {false, true}) {
+    auto mesh = Mesh{};
+    auto buf = ChunkedStreamBuf(input, input.size() / 2);
+    std::istream is(&buf);
+    REQUIRE_THROWS_WITH(Read(is, pipelined, &mesh), "device error");
+  }
+}
+
+TEST_CASE("PIPELINED - callback error") {
+  auto iss = std::istringstream(MakeInput());
+  auto options = thinks::ObjReadOptions{};
+  options.pipelined = true;
+  auto count = 0;
+  REQUIRE_THROWS_WITH(
+      thinks::ReadObj(iss,
+                      thinks::MakeObjAddFunc<ObjPositionType>(
+                          [&count](const auto&) {
+                            if (++count == 1000) {
+                              throw std::runtime_error("callback error");
+                            }
+                          }),
+                      thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}),
+                      nullptr, nullptr, options),
+      "callback error");
+}
+
+TEST_CASE("PIPELINED - cancelled") {
+  thinks::ObjCancellationToken token;
+  token.Cancel();
+  auto options = thinks::ObjReadOptions{};
+  options.cancellation = &token;
+  options.progress_interval = 1 << 12;
+
+  auto mesh = Mesh{};
+  auto iss = std::istringstream(MakeInput());
+  const auto result = Read(iss, true, &mesh, options);
+  REQUIRE(result.cancelled);
+  REQUIRE(result.position_count > 0);
+  REQUIRE(result.face_count == 0);
+}
+
+}  // namespace
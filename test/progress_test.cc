@@ -0,0 +1,209 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjIndexType = thinks::ObjIndex<std::uint32_t>;
+using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+
+constexpr auto kPositionCount = std::uint32_t{100000};
+
+// Positions followed by faces, about 3 MB.
+std::string MakeInput() {
+  auto oss = std::ostringstream{};
+  for (auto i = std::uint32_t{0}; i < kPositionCount; ++i) {
+    oss << "v " << i << " 0.5 0.25\n";
+  }
+  for (auto i = std::uint32_t{0}; i + 2 < kPositionCount; ++i) {
+    oss << "f " << i + 1 << " " << i + 2 << " " << i + 3 << "\n";
+  }
+  return oss.str();
+}
+
+struct Counts {
+  std::uint64_t positions = 0;
+  std::uint64_t faces = 0;
+};
+
+thinks::ObjReadResult Read(const std::string& input,
+                           const thinks::ObjReadOptions& options,
+                           Counts* const counts) {
+  auto iss = std::istringstream(input);
+  return thinks::ReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>(
+          [counts](const auto&) { ++counts->positions; }),
+      thinks::MakeObjAddFunc<ObjFaceType>(
+          [counts](const auto&) { ++counts->faces; }),
+      nullptr, nullptr, options);
+}
+
+TEST_CASE("PROGRESS - read") {
+  const auto input = MakeInput();
+  auto reports = std::vector<thinks::ObjProgress>{};
+  auto options = thinks::ObjReadOptions{};
+  options.progress = [&reports](const thinks::ObjProgress& progress) {
+    reports.push_back(progress);
+  };
+  options.progress_interval = 1 << 16;
+
+  auto counts = Counts{};
+  const auto result = Read(input, options, &counts);
+
+  REQUIRE(!result.cancelled);
+  REQUIRE(result.position_count == kPositionCount);
+  REQUIRE(result.face_count == kPositionCount - 2);
+
+  // One report per interval and a final one.
+  REQUIRE(reports.size() == input.size() / options.progress_interval + 1);
+  for (auto i = std::size_t{1}; i < reports.size(); ++i) {
+    REQUIRE(reports[i].bytes_done > reports[i - 1].bytes_done);
+    REQUIRE(reports[i].elements_done >= reports[i - 1].elements_done);
+    REQUIRE(reports[i].bytes_total == input.size());
+  }
+  const auto& last = reports.back();
+  REQUIRE(last.bytes_done == input.size());
+  REQUIRE(last.elements_done == 2 * kPositionCount - 2);
+  REQUIRE(last.elements_total == last.elements_done);
+
+  // The estimate extrapolates from the bytes read so far.
+  const auto& first = reports.front();
+  REQUIRE(first.elements_total > first.elements_done);
+}
+
+TEST_CASE("PROGRESS - read cancelled") {
+  const auto input = MakeInput();
+  thinks::ObjCancellationToken token;
+  auto report_count = 0;
+  auto options = thinks::ObjReadOptions{};
+  options.progress = [&](const thinks::ObjProgress&) {
+    if (++report_count == 2) {
+      token.Cancel();
+    }
+  };
+  options.progress_interval = 1 << 16;
+  options.cancellation = &token;
+
+  auto counts = Counts{};
+  const auto result = Read(input, options, &counts);
+
+  REQUIRE(result.cancelled);
+  REQUIRE(report_count == 2);
+  REQUIRE(result.position_count > 0);
+  REQUIRE(result.position_count < kPositionCount);
+  REQUIRE(result.face_count == 0);
+  REQUIRE(counts.positions == result.position_count);
+}
+
+TEST_CASE("PROGRESS - read cancelled without progress callback") {
+  thinks::ObjCancellationToken token;
+  token.Cancel();
+  auto options = thinks::ObjReadOptions{};
+  options.progress_interval = 1 << 16;
+  options.cancellation = &token;
+
+  // Cancellation is polled after the first interval.
+  auto counts = Counts{};
+  const auto result = Read(MakeInput(), options, &counts);
+  REQUIRE(result.cancelled);
+  REQUIRE(result.position_count > 0);
+  REQUIRE(result.position_count < kPositionCount);
+
+  // Small inputs are read before cancellation is polled.
+  const auto small_result = Read("v 1 2 3\n", options, &counts);
+  REQUIRE(!small_result.cancelled);
+  REQUIRE(small_result.position_count == 1);
+}
+
+TEST_CASE("PROGRESS - read cancelled delivers weld map") {
+  const auto input = MakeInput();
+  thinks::ObjCancellationToken token;
+  auto weld_map = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.progress = [&token](const thinks::ObjProgress&) { token.Cancel(); };
+  options.progress_interval = 1 << 16;
+  options.cancellation = &token;
+  options.weld_positions = true;
+  options.weld_map = &weld_map;
+  SECTION("direct") {}
+  SECTION("pipelined") { options.pipelined = true; }
+
+  // All positions are distinct, so the map is the identity.
+  auto counts = Counts{};
+  const auto result = Read(input, options, &counts);
+  REQUIRE(result.cancelled);
+  REQUIRE(result.position_count > 0);
+  REQUIRE(weld_map.size() == result.position_count);
+  for (auto i = std::uint32_t{0}; i < weld_map.size(); ++i) {
+    REQUIRE(weld_map[i] == i);
+  }
+}
+
+TEST_CASE("PROGRESS - write") {
+  auto position_index = std::uint32_t{0};
+  const auto position_mapper = [&position_index]() {
+    return position_index < kPositionCount
+               ? thinks::ObjMap(ObjPositionType(
+                     static_cast<float>(position_index++), 0.f, 0.f))
+               : thinks::ObjEnd<ObjPositionType>();
+  };
+  auto face_index = std::uint32_t{0};
+  const auto face_mapper = [&face_index]() {
+    return face_index < 10
+               ? thinks::ObjMap(ObjFaceType(ObjIndexType(0), ObjIndexType(1),
+                                            ObjIndexType(face_index++)))
+               : thinks::ObjEnd<ObjFaceType>();
+  };
+
+  SECTION("progress") {
+    auto reports = std::vector<thinks::ObjProgress>{};
+    auto options = thinks::ObjWriteOptions{};
+    options.progress = [&reports](const thinks::ObjProgress& progress) {
+      reports.push_back(progress);
+    };
+    options.progress_interval = 1000;
+
+    auto oss = std::ostringstream{};
+    const auto result = thinks::WriteObj(oss, position_mapper, face_mapper,
+                                         nullptr, nullptr, "\n", options);
+
+    REQUIRE(!result.cancelled);
+    REQUIRE(result.position_count == kPositionCount);
+    REQUIRE(result.face_count == 10);
+    REQUIRE(reports.size() == kPositionCount / 1000 + 1);
+    REQUIRE(reports.front().elements_done == 1000);
+    REQUIRE(reports.back().elements_done == kPositionCount + 10);
+    REQUIRE(reports.back().bytes_done == oss.str().size());
+  }
+
+  SECTION("cancelled") {
+    thinks::ObjCancellationToken token;
+    auto options = thinks::ObjWriteOptions{};
+    options.progress = [&token](const thinks::ObjProgress&) {
+      token.Cancel();
+    };
+    options.progress_interval = 1000;
+    options.cancellation = &token;
+
+    auto oss = std::ostringstream{};
+    const auto result = thinks::WriteObj(oss, position_mapper, face_mapper,
+                                         nullptr, nullptr, "\n", options);
+
+    REQUIRE(result.cancelled);
+    REQUIRE(result.position_count == 1000);
+    REQUIRE(result.face_count == 0);
+    REQUIRE(face_index == 0);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,158 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+using ObjIndexType = thinks::ObjIndex<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexType>;
+
+TEST_CASE("PROJECTION - unused lines are skipped") {
+  // Attribute lines are not parsed without callbacks.
+  const auto input = std::string(
+      "v 0 0 0\n"
+      "vt 0 0\n"
+      "vn 0 0 1\n"
+      "vt\tx\n"
+      "vn x\n"
+      "vt\n"
+      "v 1 0 0\n"
+      "v 0 1 0\n"
+      "f 1 2 3\n");
+  auto positions = std::vector<float>{};
+  auto indices = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream(input);
+  const auto result = thinks::ReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>([&positions](const auto& pos) {
+        positions.insert(positions.end(), pos.values.begin(),
+                         pos.values.end());
+      }),
+      thinks::MakeObjAddFunc<ObjFaceType>([&indices](const auto& face) {
+        for (const auto& index : face.values) {
+          indices.push_back(index.value);
+        }
+      }));
+
+  REQUIRE(result.position_count == 3);
+  REQUIRE(result.tex_coord_count == 0);
+  REQUIRE(result.normal_count == 0);
+  REQUIRE(result.face_count == 1);
+  REQUIRE(positions == std::vector<float>{0, 0, 0, 1, 0, 0, 0, 1, 0});
+  REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2});
+}
+
+TEST_CASE("PROJECTION - used lines are parsed") {
+  auto iss = std::istringstream("vt\tx\n");
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObj(
+          iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+          thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}),
+          thinks::MakeObjAddFunc<ObjTexCoordType>([](const auto&) {})),
+      std::runtime_error, ExceptionContentMatcher{"failed parsing 'x'"});
+}
+
+TEST_CASE("PROJECTION - plain indices skip index group fields") {
+  const auto input = std::string(
+      "f 1/2/3 2/3/4 3/4/5\n"
+      "f 4//1 5//1 6//1\n"
+      "f 7/1 8/1 9/1 10\n");
+  auto indices = std::vector<std::uint32_t>{};
+  auto iss = std::istringstream(input);
+  const auto result = thinks::ReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjAddFunc<ObjFaceType>([&indices](const auto& face) {
+        for (const auto& index : face.values) {
+          indices.push_back(index.value);
+        }
+      }));
+
+  REQUIRE(result.face_count == 3);
+  REQUIRE(indices ==
+          std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+}
+
+TEST_CASE("PROJECTION - skipped index group fields are validated") {
+  const auto read = [](const std::string& input) {
+    auto iss = std::istringstream(input);
+    return thinks::ReadObj(
+        iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}));
+  };
+
+  REQUIRE_THROWS_MATCHES(read("f 1/x/y 2 3\n"), std::runtime_error,
+                         ExceptionContentMatcher{"failed parsing 'x'"});
+  REQUIRE_THROWS_MATCHES(read("f 1 2/zz 3\n"), std::runtime_error,
+                         ExceptionContentMatcher{"failed parsing 'zz'"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 3/1/1/1/1\n"), std::runtime_error,
+      ExceptionContentMatcher{
+          "index group can have at most 3 tokens ('3/1/1/1/1')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 /3\n"), std::runtime_error,
+      ExceptionContentMatcher{"empty position index ('/3')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 3/1/\n"), std::runtime_error,
+      ExceptionContentMatcher{"empty normal index ('3/1/')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 3/0\n"), std::runtime_error,
+      ExceptionContentMatcher{"parsed index must be greater than zero"});
+  REQUIRE_THROWS_MATCHES(read("f 1 2 3x\n"), std::runtime_error,
+                         ExceptionContentMatcher{"failed parsing '3x'"});
+}
+
+TEST_CASE("PROJECTION - drop extra values") {
+  auto positions = std::vector<float>{};
+  auto tex_coords = std::vector<float>{};
+  const auto read = [&](const std::string& input) {
+    auto options = thinks::ObjReadOptions{};
+    options.drop_extra_values = true;
+    auto iss = std::istringstream(input);
+    return thinks::ReadObj(
+        iss,
+        thinks::MakeObjAddFunc<ObjPositionType>([&positions](const auto& pos) {
+          positions.insert(positions.end(), pos.values.begin(),
+                           pos.values.end());
+        }),
+        thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjTexCoordType>([&tex_coords](const auto& tex) {
+          tex_coords.insert(tex_coords.end(), tex.values.begin(),
+                            tex.values.end());
+        }),
+        nullptr, options);
+  };
+
+  SECTION("dropped") {
+    const auto result = read("v 1 2 3 0.5\nv 4 5 6\nvt 0.25 0.5 1\n");
+    REQUIRE(result.position_count == 2);
+    REQUIRE(result.tex_coord_count == 1);
+    REQUIRE(positions == std::vector<float>{1, 2, 3, 4, 5, 6});
+    REQUIRE(tex_coords == std::vector<float>{0.25f, 0.5f});
+  }
+
+  SECTION("too many positions values") {
+    REQUIRE_THROWS_MATCHES(
+        read("v 1 2 3 4 5\n"), std::runtime_error,
+        ExceptionContentMatcher{"expected to parse at most 4 values"});
+  }
+
+  SECTION("too many texture coordinate values") {
+    REQUIRE_THROWS_MATCHES(
+        read("vt 0 0 1 1\n"), std::runtime_error,
+        ExceptionContentMatcher{"expected to parse at most 3 values"});
+  }
+}
+
+}  // namespace
@@ -0,0 +1,195 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "read_write_utils.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexGroupType>;
+
+struct Mesh {
+  std::vector<float> positions;
+  std::vector<float> tex_coords;
+  std::vector<std::uint32_t> indices;
+};
+
+thinks::ObjRangeReadResult ReadRange(std::istream& is,
+                                     const std::uint64_t begin,
+                                     const std::uint64_t end, Mesh* const mesh,
+                                     const thinks::ObjReadOptions& options =
+                                         thinks::ObjReadOptions{}) {
+  return thinks::ReadObjRange(
+      is, begin, end,
+      thinks::MakeObjAddFunc<ObjPositionType>([mesh](const auto& pos) {
+        mesh->positions.insert(mesh->positions.end(), pos.values.begin(),
+                               pos.values.end());
+      }),
+      thinks::MakeObjAddFunc<ObjFaceType>([mesh](const auto& face) {
+        for (const auto& index : face.values) {
+          mesh->indices.push_back(index.position_index.value);
+          mesh->indices.push_back(index.tex_coord_index.first.value);
+        }
+      }),
+      thinks::MakeObjAddFunc<ObjTexCoordType>([mesh](const auto& tex) {
+        mesh->tex_coords.insert(mesh->tex_coords.end(), tex.values.begin(),
+                                tex.values.end());
+      }),
+      nullptr, options);
+}
+
+// Comments, blank lines and CRLF line endings, without a final newline.
+std::string MakeInput(const std::size_t quad_count) {
+  auto options = QuadStripOptions{};
+  options.tex_coords = true;
+  options.interleaved = true;
+  options.line_end = "\r\n\n";
+  return "# range test\r\n" + MakeQuadStrip(quad_count, options) + "v 0 0 1";
+}
+
+TEST_CASE("RANGE - ranges tile the stream") {
+  const auto input = MakeInput(500);
+  auto iss = std::istringstream(input);
+  auto expected = Mesh{};
+  const auto expected_result =
+      ReadRange(iss, 0, input.size(), &expected).result;
+  REQUIRE(expected_result.position_count == 1003);
+
+  // Range ends on line starts, on newlines and inside lines.
+  for (const auto range_size : {std::size_t{1}, std::size_t{7},
+                                std::size_t{64}, std::size_t{1000},
+                                input.size()}) {
+    auto mesh = Mesh{};
+    auto counts = thinks::ObjReadResult{};
+    auto lines_end = std::uint64_t{0};
+    for (auto begin = std::size_t{0}; begin < input.size();
+         begin += range_size) {
+      const auto end = std::min(begin + range_size, input.size());
+      const auto range = ReadRange(iss, begin, end, &mesh);
+      if (range.lines_begin < range.lines_end) {
+        REQUIRE(range.lines_begin == lines_end);
+        REQUIRE(range.lines_begin >= begin);
+        REQUIRE(range.lines_begin < end);
+        lines_end = range.lines_end;
+      }
+      counts.position_count += range.result.position_count;
+      counts.face_count += range.result.face_count;
+      counts.tex_coord_count += range.result.tex_coord_count;
+    }
+    REQUIRE(lines_end == input.size());
+    REQUIRE(counts.position_count == expected_result.position_count);
+    REQUIRE(counts.face_count == expected_result.face_count);
+    REQUIRE(counts.tex_coord_count == expected_result.tex_coord_count);
+    REQUIRE(mesh.positions == expected.positions);
+    REQUIRE(mesh.tex_coords == expected.tex_coords);
+    REQUIRE(mesh.indices == expected.indices);
+  }
+}
+
+TEST_CASE("RANGE - line ownership") {
+  const auto input = std::string("v 1 0 0\nv 2 0 0\nv 3 0 0\n");
+
+  // A line belongs to the range holding its first byte.
+  auto iss = std::istringstream(input);
+  auto mesh = Mesh{};
+  auto range = ReadRange(iss, 8, 9, &mesh);
+  REQUIRE(range.lines_begin == 8);
+  REQUIRE(range.lines_end == 16);
+  REQUIRE(mesh.positions == std::vector<float>{2, 0, 0});
+
+  mesh = Mesh{};
+  range = ReadRange(iss, 1, 8, &mesh);
+  REQUIRE(range.lines_begin == 8);
+  REQUIRE(range.lines_end == 8);
+  REQUIRE(range.result.position_count == 0);
+
+  mesh = Mesh{};
+  range = ReadRange(iss, 7, 8, &mesh);
+  REQUIRE(range.lines_begin == 8);
+  REQUIRE(range.result.position_count == 0);
+
+  mesh = Mesh{};
+  range = ReadRange(iss, 0, 1, &mesh);
+  REQUIRE(range.lines_begin == 0);
+  REQUIRE(range.lines_end == 8);
+  REQUIRE(mesh.positions == std::vector<float>{1, 0, 0});
+}
+
+TEST_CASE("RANGE - index bases") {
+  const auto input = MakeInput(300);
+  auto iss = std::istringstream(input);
+  const auto range_count = std::size_t{5};
+  auto ranges = std::vector<thinks::ObjRangeReadResult>{};
+  for (auto i = std::size_t{0}; i < range_count; ++i) {
+    ranges.push_back(thinks::CountObjRange(
+        iss, i * input.size() / range_count,
+        (i + 1) * input.size() / range_count));
+  }
+  const auto bases = thinks::ObjRangeIndexBases(ranges);
+  REQUIRE(bases.size() == range_count);
+  REQUIRE(bases[0].position_count == 0);
+
+  auto positions = std::vector<float>{};
+  auto indices = std::vector<std::uint32_t>{};
+  for (auto i = std::size_t{0}; i < range_count; ++i) {
+    auto mesh = Mesh{};
+    const auto range =
+        ReadRange(iss, i * input.size() / range_count,
+                  (i + 1) * input.size() / range_count, &mesh);
+    REQUIRE(range.lines_begin == ranges[i].lines_begin);
+    REQUIRE(range.lines_end == ranges[i].lines_end);
+    REQUIRE(range.result.position_count == ranges[i].result.position_count);
+    REQUIRE(range.result.face_count == ranges[i].result.face_count);
+    REQUIRE(range.result.tex_coord_count ==
+            ranges[i].result.tex_coord_count);
+    if (i + 1 < range_count) {
+      REQUIRE(bases[i + 1].position_count ==
+              bases[i].position_count + range.result.position_count);
+    }
+
+    // Positions stored at their global index line up with face indices.
+    REQUIRE(positions.size() == 3 * bases[i].position_count);
+    positions.insert(positions.end(), mesh.positions.begin(),
+                     mesh.positions.end());
+    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+  }
+
+  auto expected = Mesh{};
+  ReadRange(iss, 0, input.size(), &expected);
+  REQUIRE(positions == expected.positions);
+  REQUIRE(indices == expected.indices);
+}
+
+TEST_CASE("RANGE - unsupported options") {
+  auto iss = std::istringstream("v 0 0 0\n");
+  auto mesh = Mesh{};
+  auto options = thinks::ObjReadOptions{};
+  SECTION("welding") {
+    options.weld_positions = true;
+    REQUIRE_THROWS_WITH(ReadRange(iss, 0, 8, &mesh, options),
+                        "welding is not supported for byte ranges");
+  }
+  SECTION("ear clipping") {
+    options.triangulation = thinks::ObjTriangulation::kEarClip;
+    REQUIRE_THROWS_WITH(ReadRange(iss, 0, 8, &mesh, options),
+                        "ear clipping is not supported for byte ranges");
+  }
+  SECTION("invalid range") {
+    REQUIRE_THROWS_WITH(ReadRange(iss, 4, 2, &mesh),
+                        "invalid byte range [4, 2)");
+  }
+}
+
+}  // namespace
@@ -2,8 +2,10 @@
 // This file is subject to the license terms in the LICENSE file
 // found in the top-level directory of this distribution.
 
+#include <cstdint>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "catch2/catch.hpp"
 #include "catch_mesh_matcher.h"
@@ -525,6 +527,39 @@ TEST_CASE("READ - parse value error") {
       ExceptionContentMatcher{"failed parsing 'xxx'"});
 }
 
+TEST_CASE("READ - real value formats") {
+  const auto input = std::string(
+      "v 1 -2 +3\n"
+      "v .5 -.25 5.\n"
+      "v 1e3 -2.5E-2 +1.25e+1\n"
+      "v 0.1234567890123456789012345678901234567890123456789012345678901234567"
+      " 0 0\n"
+      "v 1 2 3");
+  auto values = std::vector<double>{};
+  const auto add_position =
+      thinks::MakeObjAddFunc<thinks::ObjPosition<double, 3>>(
+          [&values](const auto& position) {
+            values.insert(values.end(), position.values.begin(),
+                          position.values.end());
+          });
+  const auto add_face = thinks::MakeObjAddFunc<
+      thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>>(
+      [](const auto&) {});
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(iss, add_position, add_face);
+
+  REQUIRE(values == std::vector<double>{1, -2, 3, 0.5, -0.25, 5, 1000,
+                                        -0.025, 12.5, 0.12345678901234568,
+                                        0, 0, 1, 2, 3});
+
+  for (const auto& line : {"v 1 2 3x\n", "v 1 2 1e3e\n", "v 1 2 --1\n",
+                           "v 1 2 1e999\n"}) {
+    auto error_iss = std::istringstream(line);
+    REQUIRE_THROWS_AS(thinks::ReadObj(error_iss, add_position, add_face),
+                      std::runtime_error);
+  }
+}
+
 TEST_CASE("READ - index range", "[container]") {
   using PositionType = Vec3<float>;
   using TexCoordType = Vec2<float>;
@@ -547,6 +582,98 @@ TEST_CASE("READ - index range", "[container]") {
         ExceptionContentMatcher{
             "parsed index must be greater than zero"});
   }
+
+  SECTION("negative index") {
+    const auto input = std::string("f 1 2 -3\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "parsed index must be greater than zero"});
+  }
+
+  SECTION("index overflow") {
+    const auto input = std::string("f 1 2 40000\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "parsed index 40000 does not fit index type (max 32767)"});
+  }
+
+  SECTION("largest index") {
+    const auto input = std::string("f 1 2 32767\n");
+    auto iss = std::istringstream(input);
+
+    const auto read_result =
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals);
+
+    REQUIRE(read_result.mesh.indices ==
+            std::vector<IndexType>{0, 1, 32766});
+  }
+}
+
+TEST_CASE("READ - 8-bit index", "[container]") {
+  using MeshType = Mesh<Vertex<>, std::uint8_t>;
+
+  constexpr auto use_tex_coords = false;
+  constexpr auto use_normals = false;
+
+  SECTION("values") {
+    const auto input = std::string("f 1 20 255\n");
+    auto iss = std::istringstream(input);
+
+    const auto read_result =
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals);
+
+    REQUIRE(read_result.mesh.indices ==
+            std::vector<std::uint8_t>{0, 19, 254});
+  }
+
+  SECTION("overflow") {
+    const auto input = std::string("f 1 2 256\n");
+    auto iss = std::istringstream(input);
+
+    REQUIRE_THROWS_MATCHES(
+        ReadMesh<MeshType>(iss, use_tex_coords, use_normals),
+        std::runtime_error,
+        ExceptionContentMatcher{
+            "parsed index 256 does not fit index type (max 255)"});
+  }
+}
+
+TEST_CASE("READ - probe") {
+  const auto input = std::string(
+      "# comment\n"
+      "\n"
+      "v 1 2 3\n"
+      "  v 4 5 6\n"
+      "v\t7 8 9\r\n"
+      "vt 0 0\n"
+      "vn 1 0 0\n"
+      "vp 1 0 0\n"
+      "f 1/1/1 2/1/1 3/1/1\n"
+      "f  1 2\t3   1\n"
+      "f 3 2 1");
+  auto iss = std::istringstream(input);
+  iss.seekg(0);
+
+  const auto probe = thinks::ProbeObj(iss);
+
+  REQUIRE(probe.position_count == 3);
+  REQUIRE(probe.tex_coord_count == 1);
+  REQUIRE(probe.normal_count == 1);
+  REQUIRE(probe.face_count == 3);
+  REQUIRE(probe.face_index_count == 10);
+
+  // Stream is restored.
+  auto line = std::string{};
+  REQUIRE(std::getline(iss, line));
+  REQUIRE(line == "# comment");
 }
 
 TEST_CASE("READ - index group errors", "[container]") {
@@ -587,4 +714,120 @@ TEST_CASE("READ - index group errors", "[container]") {
   }
 }
 
+TEST_CASE("READ - triangulation") {
+  using ObjPositionType = thinks::ObjPosition<float, 3>;
+  using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>;
+
+  auto positions = std::vector<Vec3<float>>{};
+  auto add_position =
+      thinks::MakeObjAddFunc<ObjPositionType>([&positions](const auto& pos) {
+        positions.push_back(
+            Vec3<float>{pos.values[0], pos.values[1], pos.values[2]});
+      });
+  auto indices = std::vector<std::uint32_t>{};
+  auto add_face =
+      thinks::MakeObjAddFunc<ObjFaceType>([&indices](const auto& face) {
+        for (const auto idx : face.values) {
+          indices.push_back(idx.value);
+        }
+      });
+
+  // Signed area of a triangle in the xy-plane.
+  const auto area = [&positions, &indices](const std::size_t t) {
+    const auto a = positions[indices[3 * t + 0]];
+    const auto b = positions[indices[3 * t + 1]];
+    const auto c = positions[indices[3 * t + 2]];
+    return 0.5f * ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x));
+  };
+
+  SECTION("fan") {
+    const auto input = std::string(
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "v -1 0.5 0\n"
+        "f 1 2 3\n"
+        "f 1 2 3 4\n"
+        "f 1 2 3 4 5\n");
+    auto iss = std::istringstream(input);
+    auto options = thinks::ObjReadOptions{};
+    options.triangulation = thinks::ObjTriangulation::kFan;
+
+    const auto result = thinks::ReadObj(iss, add_position, add_face, nullptr,
+                                        nullptr, options);
+
+    REQUIRE(result.face_count == 1 + 2 + 3);
+    REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2,
+                                                  0, 1, 2, 0, 2, 3,
+                                                  0, 1, 2, 0, 2, 3, 0, 3, 4});
+  }
+
+  SECTION("ear clipping") {
+    // L-shaped (non-convex) face, starting at a corner that cannot see the
+    // whole polygon, so that fan triangulation would be wrong.
+    const auto input = std::string(
+        "v 2 1 0\n"
+        "v 1 1 0\n"
+        "v 1 2 0\n"
+        "v 0 2 0\n"
+        "v 0 0 0\n"
+        "v 2 0 0\n"
+        "f 1 2 3 4 5 6\n");
+    auto iss = std::istringstream(input);
+    auto options = thinks::ObjReadOptions{};
+    options.triangulation = thinks::ObjTriangulation::kEarClip;
+
+    const auto result = thinks::ReadObj(iss, add_position, add_face, nullptr,
+                                        nullptr, options);
+
+    REQUIRE(result.face_count == 4);
+    auto total_area = 0.f;
+    for (std::size_t t = 0; t < result.face_count; ++t) {
+      REQUIRE(area(t) > 0.f);
+      total_area += area(t);
+    }
+    REQUIRE(total_area == Approx(3.f));
+  }
+
+  SECTION("ear clipping, clockwise") {
+    const auto input = std::string(
+        "v 2 1 0\n"
+        "v 2 0 0\n"
+        "v 0 0 0\n"
+        "v 0 2 0\n"
+        "v 1 2 0\n"
+        "v 1 1 0\n"
+        "f 1 2 3 4 5 6\n");
+    auto iss = std::istringstream(input);
+    auto options = thinks::ObjReadOptions{};
+    options.triangulation = thinks::ObjTriangulation::kEarClip;
+
+    const auto result = thinks::ReadObj(iss, add_position, add_face, nullptr,
+                                        nullptr, options);
+
+    REQUIRE(result.face_count == 4);
+    auto total_area = 0.f;
+    for (std::size_t t = 0; t < result.face_count; ++t) {
+      REQUIRE(area(t) < 0.f);
+      total_area += area(t);
+    }
+    REQUIRE(total_area == Approx(-3.f));
+  }
+
+  SECTION("non-triangle face type") {
+    using ObjQuadFaceType = thinks::ObjQuadFace<thinks::ObjIndex<std::uint32_t>>;
+    auto add_quad = thinks::MakeObjAddFunc<ObjQuadFaceType>([](const auto&) {});
+    auto iss = std::istringstream("f 1 2 3 4\n");
+    auto options = thinks::ObjReadOptions{};
+    options.triangulation = thinks::ObjTriangulation::kFan;
+
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_quad, nullptr, nullptr,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{"triangulation requires triangle faces"});
+  }
+}
+
 } // namespace
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <exception>
 #include <iostream>
 #include <sstream>
@@ -190,7 +191,7 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
   using thinks::MakeObjAddFunc;
 
   using MeshType = MeshT;
-  using VertexType = MeshType::VertexType;
+  using VertexType = typename MeshType::VertexType;
 
   auto mesh = MeshType{};
   auto pos_count = uint32_t{0};
@@ -198,8 +199,8 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
   auto nml_count = uint32_t{0};
 
   // Positions.
-  using PositionType = VertexType::PositionType;
-  using ObjPositionType = thinks::ObjPosition<PositionType::ValueType,
+  using PositionType = typename VertexType::PositionType;
+  using ObjPositionType = thinks::ObjPosition<typename PositionType::ValueType,
                                               VecSize<PositionType>::value>;
 
   auto add_position =
@@ -212,8 +213,8 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
       });
 
   // Faces.
-  using ObjFaceType = read_write_utils_internal::FaceSelector<
-      MeshType::IndicesPerFace, thinks::ObjIndex<MeshType::IndexType>>::Type;
+  using ObjFaceType = typename read_write_utils_internal::FaceSelector<
+      MeshType::IndicesPerFace, thinks::ObjIndex<typename MeshType::IndexType>>::Type;
 
   auto add_face = MakeObjAddFunc<ObjFaceType>([&mesh](const auto& face) {
     if (face.values.size() != MeshType::IndicesPerFace) {
@@ -225,8 +226,8 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
   });
 
   // Texture coordinates [optional].
-  using TexCoordType = VertexType::TexCoordType;
-  using ObjTexCoordType = thinks::ObjTexCoord<TexCoordType::ValueType,
+  using TexCoordType = typename VertexType::TexCoordType;
+  using ObjTexCoordType = thinks::ObjTexCoord<typename TexCoordType::ValueType,
                                               VecSize<TexCoordType>::value>;
 
   auto add_tex_coord =
@@ -239,8 +240,8 @@ ReadResult<MeshT> ReadMesh(std::istream& is, const bool read_tex_coords,
       });
 
   // Normals [optional].
-  using NormalType = VertexType::NormalType;
-  using ObjNormalType = thinks::ObjNormal<NormalType::ValueType>;
+  using NormalType = typename VertexType::NormalType;
+  using ObjNormalType = thinks::ObjNormal<typename NormalType::ValueType>;
 
   auto add_normal =
       MakeObjAddFunc<ObjNormalType>([&mesh, &nml_count](const auto& nml) {
@@ -289,8 +290,8 @@ ReadResult<IndexedMeshT> ReadIndexGroupMesh(std::istream& is,
   auto mesh = MeshType{};
 
   // Positions.
-  using PositionType = MeshType::PositionType;
-  using ObjPositionType = thinks::ObjPosition<PositionType::ValueType,
+  using PositionType = typename MeshType::PositionType;
+  using ObjPositionType = thinks::ObjPosition<typename PositionType::ValueType,
                                               VecSize<PositionType>::value>;
 
   auto add_position = MakeObjAddFunc<ObjPositionType>([&mesh](const auto& pos) {
@@ -298,9 +299,9 @@ ReadResult<IndexedMeshT> ReadIndexGroupMesh(std::istream& is,
   });
 
   // Faces.
-  using ObjFaceType = read_write_utils_internal::FaceSelector<
+  using ObjFaceType = typename read_write_utils_internal::FaceSelector<
       MeshType::IndicesPerFace,
-      thinks::ObjIndexGroup<MeshType::IndexType>>::Type;
+      thinks::ObjIndexGroup<typename MeshType::IndexType>>::Type;
 
   auto add_face = MakeObjAddFunc<ObjFaceType>(
       [&mesh, read_tex_coords, read_normals](const auto& face) {
@@ -320,8 +321,8 @@ ReadResult<IndexedMeshT> ReadIndexGroupMesh(std::istream& is,
       });
 
   // Texture coordinates [optional.
-  using TexCoordType = MeshType::TexCoordType;
-  using ObjTexCoordType = thinks::ObjTexCoord<TexCoordType::ValueType,
+  using TexCoordType = typename MeshType::TexCoordType;
+  using ObjTexCoordType = thinks::ObjTexCoord<typename TexCoordType::ValueType,
                                               VecSize<TexCoordType>::value>;
 
   auto add_tex_coord =
@@ -330,8 +331,8 @@ ReadResult<IndexedMeshT> ReadIndexGroupMesh(std::istream& is,
       });
 
   // Normals [optional].
-  using NormalType = MeshType::NormalType;
-  using ObjNormalType = thinks::ObjNormal<NormalType::ValueType>;
+  using NormalType = typename MeshType::NormalType;
+  using ObjNormalType = thinks::ObjNormal<typename NormalType::ValueType>;
 
   auto add_normal = MakeObjAddFunc<ObjNormalType>([&mesh](const auto& nml) {
     mesh.normals.push_back(VecMaker<NormalType>::Make(nml.values));
@@ -377,15 +378,15 @@ WriteResult WriteMesh(const MeshT& mesh, const bool write_tex_coords,
   using read_write_utils_internal::WriteHelper;
 
   using MeshType = MeshT;
-  using VertexType = MeshType::VertexType;
+  using VertexType = typename MeshType::VertexType;
 
   const auto vtx_iend = std::end(mesh.vertices);
 
   // Positions.
   auto pos_vtx_iter = begin(mesh.vertices);
   auto pos_mapper = [&pos_vtx_iter, vtx_iend]() {
-    using PositionType = VertexType::PositionType;
-    using ObjPositionType = thinks::ObjPosition<PositionType::ValueType,
+    using PositionType = typename VertexType::PositionType;
+    using ObjPositionType = thinks::ObjPosition<typename PositionType::ValueType,
                                                 VecSize<PositionType>::value>;
 
     return pos_vtx_iter == vtx_iend
@@ -397,8 +398,8 @@ WriteResult WriteMesh(const MeshT& mesh, const bool write_tex_coords,
   // Texture coordinates.
   auto tex_vtx_iter = begin(mesh.vertices);
   auto tex_mapper = [&tex_vtx_iter, vtx_iend]() {
-    using TexCoordType = VertexType::TexCoordType;
-    using ObjTexCoordType = thinks::ObjTexCoord<TexCoordType::ValueType,
+    using TexCoordType = typename VertexType::TexCoordType;
+    using ObjTexCoordType = thinks::ObjTexCoord<typename TexCoordType::ValueType,
                                                 VecSize<TexCoordType>::value>;
 
     return tex_vtx_iter == vtx_iend
@@ -410,8 +411,8 @@ WriteResult WriteMesh(const MeshT& mesh, const bool write_tex_coords,
   // Normals.
   auto nml_vtx_iter = begin(mesh.vertices);
   auto nml_mapper = [&nml_vtx_iter, vtx_iend]() {
-    using NormalType = VertexType::NormalType;
-    using ObjNormalType = thinks::ObjNormal<NormalType::ValueType>;
+    using NormalType = typename VertexType::NormalType;
+    using ObjNormalType = thinks::ObjNormal<typename NormalType::ValueType>;
 
     return nml_vtx_iter == vtx_iend ? ObjEnd<ObjNormalType>()
                                     : ObjMap(ObjTypeMaker<ObjNormalType>::Make(
@@ -422,10 +423,10 @@ WriteResult WriteMesh(const MeshT& mesh, const bool write_tex_coords,
   auto idx_iter = mesh.indices.begin();
   const auto idx_iend = mesh.indices.end();
   auto face_mapper = [&idx_iter, idx_iend]() {
-    using MeshIndexType = MeshType::IndexType;
+    using MeshIndexType = typename MeshType::IndexType;
     using ObjIndexType = thinks::ObjIndex<MeshIndexType>;
     using ObjFaceType =
-        FaceSelector<MeshType::IndicesPerFace, ObjIndexType>::Type;
+        typename FaceSelector<MeshType::IndicesPerFace, ObjIndexType>::Type;
 
     if (std::distance(idx_iter, idx_iend) < MeshType::IndicesPerFace) {
       return ObjEnd<ObjFaceType>();
@@ -476,8 +477,8 @@ WriteResult WriteIndexGroupMesh(const IndexedMeshT& imesh,
   auto pos_iter = std::begin(imesh.positions);
   const auto pos_iend = std::end(imesh.positions);
   auto pos_mapper = [&pos_iter, pos_iend]() {
-    using PositionType = MeshType::PositionType;
-    using ObjPositionType = thinks::ObjPosition<PositionType::ValueType,
+    using PositionType = typename MeshType::PositionType;
+    using ObjPositionType = thinks::ObjPosition<typename PositionType::ValueType,
                                                 VecSize<PositionType>::value>;
 
     return pos_iter == pos_iend
@@ -489,8 +490,8 @@ WriteResult WriteIndexGroupMesh(const IndexedMeshT& imesh,
   auto tex_iter = std::begin(imesh.tex_coords);
   const auto tex_iend = std::end(imesh.tex_coords);
   auto tex_mapper = [&tex_iter, tex_iend]() {
-    using TexCoordType = MeshType::TexCoordType;
-    using ObjTexCoordType = thinks::ObjTexCoord<TexCoordType::ValueType,
+    using TexCoordType = typename MeshType::TexCoordType;
+    using ObjTexCoordType = thinks::ObjTexCoord<typename TexCoordType::ValueType,
                                                 VecSize<TexCoordType>::value>;
 
     return tex_iter == tex_iend
@@ -502,8 +503,8 @@ WriteResult WriteIndexGroupMesh(const IndexedMeshT& imesh,
   auto nml_iter = std::begin(imesh.normals);
   const auto nml_iend = std::end(imesh.normals);
   auto nml_mapper = [&nml_iter, nml_iend]() {
-    using NormalType = MeshType::NormalType;
-    using ObjNormalType = thinks::ObjNormal<NormalType::ValueType>;
+    using NormalType = typename MeshType::NormalType;
+    using ObjNormalType = thinks::ObjNormal<typename NormalType::ValueType>;
 
     return nml_iter == nml_iend
                ? ObjEnd<ObjNormalType>()
@@ -520,10 +521,10 @@ WriteResult WriteIndexGroupMesh(const IndexedMeshT& imesh,
   auto face_mapper = [&pos_idx_iter, &tex_idx_iter, &nml_idx_iter, pos_idx_iend,
                       tex_idx_iend, nml_idx_iend, write_tex_coords,
                       write_normals]() {
-    using MeshIndexType = MeshType::IndexType;
+    using MeshIndexType = typename MeshType::IndexType;
     using ObjIndexGroupType = thinks::ObjIndexGroup<MeshIndexType>;
     using ObjFaceType =
-        FaceSelector<MeshType::IndicesPerFace, ObjIndexGroupType>::Type;
+        typename FaceSelector<MeshType::IndicesPerFace, ObjIndexGroupType>::Type;
 
     if (std::distance(pos_idx_iter, pos_idx_iend) < MeshType::IndicesPerFace ||
         std::distance(tex_idx_iter, tex_idx_iend) < MeshType::IndicesPerFace ||
@@ -572,3 +573,78 @@ WriteResult WriteIndexGroupMesh(const IndexedMeshT& imesh,
 
   return result;
 }
+
+// Layout of the input written by MakeQuadStrip.
+struct QuadStripOptions {
+  // One texture coordinate per column, faces use "p/t" index groups.
+  bool tex_coords = false;
+
+  // One normal per column, faces use "p/t/n" or "p//n" index groups.
+  bool normals = false;
+
+  // Each quad follows the column that completes it, instead of all
+  // vertices coming before all faces.
+  bool interleaved = false;
+
+  // Ends every line, e.g. "\r\n", or "\n\n" for blank lines.
+  std::string line_end = "\n";
+};
+
+// A strip of |quad_count| quads over quad_count + 1 columns of two vertices,
+// (i, 0, 0) and (i, 1, 0) for column i. Quad i has the (one-based) vertices
+// 2i + 1, 2i + 3, 2i + 4 and 2i + 2, and index group fields refer to the
+// texture coordinate and normal of the column of each vertex.
+inline std::string MakeQuadStrip(
+    const std::size_t quad_count,
+    const QuadStripOptions& options = QuadStripOptions{}) {
+  const auto& line_end = options.line_end;
+  auto oss = std::ostringstream{};
+  const auto add_column = [&](const std::size_t i) {
+    oss << "v " << i << " 0 0" << line_end << "v " << i << " 1 0" << line_end;
+    if (options.tex_coords) {
+      oss << "vt 0." << i % 10 << " 0.5" << line_end;
+    }
+    if (options.normals) {
+      oss << "vn 0 0 1" << line_end;
+    }
+  };
+  const auto add_corner = [&](const std::size_t vertex,
+                              const std::size_t column) {
+    oss << " " << vertex;
+    if (options.tex_coords || options.normals) {
+      oss << "/";
+    }
+    if (options.tex_coords) {
+      oss << column + 1;
+    }
+    if (options.normals) {
+      oss << "/" << column + 1;
+    }
+  };
+  const auto add_quad = [&](const std::size_t i) {
+    const auto a = 2 * i + 1;
+    oss << "f";
+    add_corner(a, i);
+    add_corner(a + 2, i + 1);
+    add_corner(a + 3, i + 1);
+    add_corner(a + 1, i);
+    oss << line_end;
+  };
+
+  if (options.interleaved) {
+    for (auto i = std::size_t{0}; i <= quad_count; ++i) {
+      add_column(i);
+      if (i > 0) {
+        add_quad(i - 1);
+      }
+    }
+  } else {
+    for (auto i = std::size_t{0}; i <= quad_count; ++i) {
+      add_column(i);
+    }
+    for (auto i = std::size_t{0}; i < quad_count; ++i) {
+      add_quad(i);
+    }
+  }
+  return oss.str();
+}
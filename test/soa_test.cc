@@ -0,0 +1,228 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+// Stream buffer that cannot seek, like a pipe.
+class PipeBuf : public std::streambuf {
+ public:
+  explicit PipeBuf(const std::string& data) : data_(data) {
+    setg(&data_[0], &data_[0], &data_[0] + data_.size());
+  }
+
+ private:
+  std::string data_;
+};
+
+template <typename VectorT>
+bool IsAligned(const VectorT& values) {
+  return reinterpret_cast<std::uintptr_t>(values.data()) % 64 == 0;
+}
+
+const auto kInput = std::string(
+    "# Quad and triangle.\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0 1\n"
+    "v\t0 1 0\n"
+    "vt 0 0\n"
+    "vt 1 0\n"
+    "vt 1 1 1\n"
+    "vn 0 0 1\r\n"
+    "\n"
+    "s 1\n"
+    "f 1/1/1 2/2/1 3/3/1 4/3/1\n"
+    "f 1/1/1 3/3/1 4/2/1");
+
+void CheckMesh(const thinks::ObjSoAMesh& mesh) {
+  REQUIRE(mesh.x == thinks::ObjAlignedVector<float>{0, 1, 1, 0});
+  REQUIRE(mesh.y == thinks::ObjAlignedVector<float>{0, 0, 1, 1});
+  REQUIRE(mesh.z == thinks::ObjAlignedVector<float>{0, 0, 0, 0});
+  REQUIRE(mesh.u == thinks::ObjAlignedVector<float>{0, 1, 1});
+  REQUIRE(mesh.v == thinks::ObjAlignedVector<float>{0, 0, 1});
+  REQUIRE(mesh.nx == thinks::ObjAlignedVector<float>{0});
+  REQUIRE(mesh.ny == thinks::ObjAlignedVector<float>{0});
+  REQUIRE(mesh.nz == thinks::ObjAlignedVector<float>{1});
+  REQUIRE(mesh.position_indices ==
+          thinks::ObjAlignedVector<std::uint32_t>{0, 1, 2, 0, 2, 3, 0, 2, 3});
+  REQUIRE(mesh.tex_coord_indices ==
+          thinks::ObjAlignedVector<std::uint32_t>{0, 1, 2, 0, 2, 2, 0, 2, 1});
+  REQUIRE(mesh.normal_indices ==
+          thinks::ObjAlignedVector<std::uint32_t>(9, 0));
+}
+
+TEST_CASE("SOA - read") {
+  SECTION("seekable") {
+    auto iss = std::istringstream(kInput);
+    const auto mesh = thinks::ReadObjToSoA(iss);
+    CheckMesh(mesh);
+    REQUIRE(IsAligned(mesh.x));
+    REQUIRE(IsAligned(mesh.nz));
+    REQUIRE(IsAligned(mesh.position_indices));
+
+    // Presized from the probe.
+    REQUIRE(mesh.x.capacity() == 4);
+    REQUIRE(mesh.position_indices.capacity() == 9);
+  }
+
+  SECTION("not seekable") {
+    auto buf = PipeBuf(kInput);
+    std::istream is(&buf);
+    CheckMesh(thinks::ReadObjToSoA(is));
+  }
+}
+
+TEST_CASE("SOA - matches ReadObj") {
+  // Large enough to span several read blocks.
+  auto oss = std::ostringstream{};
+  constexpr auto kSize = 300;
+  for (auto y = 0; y <= kSize; ++y) {
+    for (auto x = 0; x <= kSize; ++x) {
+      oss << "v " << x * 0.1 << " " << y * 0.37 << " " << -1.25e-3 * x * y
+          << "\n";
+    }
+  }
+  for (auto y = 0; y < kSize; ++y) {
+    for (auto x = 0; x < kSize; ++x) {
+      const auto i = y * (kSize + 1) + x + 1;
+      oss << "f " << i << " " << i + 1 << " " << i + kSize + 2 << " "
+          << i + kSize + 1 << "\n";
+    }
+  }
+  const auto input = oss.str();
+  REQUIRE(input.size() > (std::size_t{1} << 21));
+
+  auto positions = std::vector<thinks::ObjPosition<float, 3>>{};
+  auto indices = std::vector<std::uint32_t>{};
+  auto add_position =
+      thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+          [&positions](const auto& pos) { positions.push_back(pos); });
+  auto add_face = thinks::MakeObjAddFunc<
+      thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>>(
+      [&indices](const auto& face) {
+        for (const auto& index : face.values) {
+          indices.push_back(index.value);
+        }
+      });
+  auto options = thinks::ObjReadOptions{};
+  options.triangulation = thinks::ObjTriangulation::kFan;
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(iss, add_position, add_face, nullptr, nullptr, options);
+
+  auto soa_iss = std::istringstream(input);
+  const auto mesh = thinks::ReadObjToSoA(soa_iss);
+  REQUIRE(mesh.x.size() == positions.size());
+  for (auto i = std::size_t{0}; i < positions.size(); ++i) {
+    REQUIRE(mesh.x[i] == positions[i].values[0]);
+    REQUIRE(mesh.y[i] == positions[i].values[1]);
+    REQUIRE(mesh.z[i] == positions[i].values[2]);
+  }
+  REQUIRE(std::vector<std::uint32_t>(mesh.position_indices.begin(),
+                                     mesh.position_indices.end()) == indices);
+  REQUIRE(mesh.tex_coord_indices.empty());
+  REQUIRE(mesh.normal_indices.empty());
+}
+
+TEST_CASE("SOA - rejects what ReadObj rejects") {
+  const auto read_obj = [](const std::string& input) {
+    auto add_position =
+        thinks::MakeObjAddFunc<thinks::ObjPosition<double, 3>>(
+            [](const auto&) {});
+    auto add_face = thinks::MakeObjAddFunc<
+        thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>>(
+        [](const auto&) {});
+    auto iss = std::istringstream(input);
+    thinks::ReadObj(iss, add_position, add_face, nullptr, nullptr);
+  };
+  const auto read_soa = [](const std::string& input) {
+    auto iss = std::istringstream(input);
+    thinks::ReadObjToSoA(iss);
+  };
+
+  for (const auto& input :
+       {"v inf 0 0\n", "v nan 0 0\n", "v 0x1p3 0 0\n", "v 1e999 0 0\n",
+        "v -1e999 0 0\n", "v 1.0abc 0 0\n", "v 1e 0 0\n",
+        "f 1 2 99999999999999999999\n", "f 1 2 3x\n"}) {
+    INFO(input);
+    REQUIRE_THROWS_AS(read_obj(input), std::runtime_error);
+    REQUIRE_THROWS_AS(read_soa(input), std::runtime_error);
+  }
+
+  // Accepted by both.
+  for (const auto& input : {"v 1e2 -.5 +3.\n", "v 1E-2 0 0\n"}) {
+    INFO(input);
+    REQUIRE_NOTHROW(read_obj(input));
+    REQUIRE_NOTHROW(read_soa(input));
+  }
+}
+
+TEST_CASE("SOA - long line") {
+  constexpr auto kCorners = 300000;
+  auto oss = std::ostringstream{};
+  oss << "v 0 0 0\nf";
+  for (auto i = 0; i < kCorners; ++i) {
+    oss << " 1";
+  }
+  oss << "\nv 1 1 1\n";
+
+  auto iss = std::istringstream(oss.str());
+  const auto mesh = thinks::ReadObjToSoA(iss);
+  REQUIRE(mesh.x.size() == 2);
+  REQUIRE(mesh.position_indices.size() == 3 * (kCorners - 2));
+}
+
+TEST_CASE("SOA - errors") {
+  const auto read = [](const std::string& input) {
+    auto iss = std::istringstream(input);
+    thinks::ReadObjToSoA(iss);
+  };
+
+  REQUIRE_THROWS_MATCHES(
+      read("v 1 2 3\nbad 1\n"), std::runtime_error,
+      ExceptionContentMatcher{"unrecognized line prefix 'bad'"});
+  REQUIRE_THROWS_MATCHES(
+      read("v 1 2\n"), std::runtime_error,
+      ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+  REQUIRE_THROWS_MATCHES(read("v 1 2 x\n"), std::runtime_error,
+                         ExceptionContentMatcher{"failed parsing 'x'"});
+  REQUIRE_THROWS_MATCHES(read("vn 1 2 3 4\n"), std::runtime_error,
+                         ExceptionContentMatcher{
+                             "expected to parse at most 3 values"});
+  REQUIRE_THROWS_MATCHES(
+      read("vt 0 2\n"), std::runtime_error,
+      ExceptionContentMatcher{
+          "texture coordinate values must be in range [0, 1] (found 2)"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2\n"), std::runtime_error,
+      ExceptionContentMatcher{"faces must have at least 3 indices (found 2)"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 0 2\n"), std::runtime_error,
+      ExceptionContentMatcher{"parsed index must be greater than zero"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 /3\n"), std::runtime_error,
+      ExceptionContentMatcher{"empty position index ('/3')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 3//\n"), std::runtime_error,
+      ExceptionContentMatcher{"empty normal index ('3//')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1 2 3/1/1/1\n"), std::runtime_error,
+      ExceptionContentMatcher{
+          "index group can have at most 3 tokens ('3/1/1/1')"});
+  REQUIRE_THROWS_MATCHES(
+      read("f 1/1 2/1 3\n"), std::runtime_error,
+      ExceptionContentMatcher{
+          "all face corners must have the same index group layout"});
+}
+
+}  // namespace
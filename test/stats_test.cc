@@ -0,0 +1,138 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexType = thinks::ObjIndex<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexType>;
+using ObjTriangleType = thinks::ObjTriangleFace<ObjIndexType>;
+
+const auto kInput = std::string(
+    "# stats\n"
+    "\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "  v 0 1 0\n"
+    "vt 0 0\n"
+    "vn 0 0 1\n"
+    "s 1\n"
+    "\t\n"
+    "f 1 2 3\n"
+    "f   1   3   2\n"
+    "v 1 1 1");
+
+TEST_CASE("STATS - read") {
+  auto options = thinks::ObjReadOptions{};
+  SECTION("direct") {}
+  SECTION("pipelined") { options.pipelined = true; }
+  SECTION("callback thread") { options.callback_thread = true; }
+
+  auto position_count = 0;
+  auto normal_count = 0;
+  const auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&position_count](const auto&) {
+        if (position_count++ == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+      });
+  const auto add_face =
+      thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+  const auto add_normal = thinks::MakeObjAddFunc<ObjNormalType>(
+      [&normal_count](const auto&) { ++normal_count; });
+
+  auto stats = thinks::ObjReadStats{};
+  auto iss = std::istringstream(kInput);
+  const auto result = thinks::ReadObj(iss, add_position, add_face, nullptr,
+                                      add_normal, options, &stats);
+
+  REQUIRE(result.position_count == 4);
+  REQUIRE(result.face_count == 2);
+  REQUIRE(result.normal_count == 1);
+  REQUIRE(position_count == 4);
+  REQUIRE(normal_count == 1);
+
+  REQUIRE(stats.bytes == kInput.size());
+  REQUIRE(stats.position_lines == 4);
+  REQUIRE(stats.face_lines == 2);
+  REQUIRE(stats.tex_coord_lines == 1);  // Skipped, but counted.
+  REQUIRE(stats.normal_lines == 1);
+  REQUIRE(stats.smoothing_group_lines == 1);
+  REQUIRE(stats.comment_lines == 1);
+  REQUIRE(stats.blank_lines == 2);
+  REQUIRE(stats.longest_line == 13);
+  REQUIRE(stats.buffer_growths > 0);
+  if (!options.callback_thread) {
+    REQUIRE(stats.callback_ns >= 5000000);
+  }
+}
+
+TEST_CASE("STATS - read matches read without stats") {
+  auto input = std::string{};
+  for (auto i = 0; i < 10000; ++i) {
+    input += "v 1 2 3\nf 1 1 1\n";
+  }
+  const auto add_position =
+      thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {});
+  const auto add_face =
+      thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+
+  auto iss = std::istringstream(input);
+  const auto expected = thinks::ReadObj(iss, add_position, add_face);
+  auto stats = thinks::ObjReadStats{};
+  auto stats_iss = std::istringstream(input);
+  const auto result =
+      thinks::ReadObj(stats_iss, add_position, add_face, nullptr, nullptr,
+                      thinks::ObjReadOptions{}, &stats);
+
+  REQUIRE(result.position_count == expected.position_count);
+  REQUIRE(result.face_count == expected.face_count);
+  REQUIRE(stats.bytes == input.size());
+  REQUIRE(stats.position_lines == 10000);
+  REQUIRE(stats.face_lines == 10000);
+  REQUIRE(stats.parse_ns > 0);
+}
+
+TEST_CASE("STATS - write") {
+  auto position_index = 0;
+  const auto position_mapper = [&position_index]() {
+    if (position_index == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return position_index < 3
+               ? thinks::ObjMap(ObjPositionType(
+                     static_cast<float>(position_index++), 0.f, 0.f))
+               : thinks::ObjEnd<ObjPositionType>();
+  };
+  auto face_index = 0;
+  const auto face_mapper = [&face_index]() {
+    return face_index++ < 1
+               ? thinks::ObjMap(ObjTriangleType(
+                     ObjIndexType(0), ObjIndexType(1), ObjIndexType(2)))
+               : thinks::ObjEnd<ObjTriangleType>();
+  };
+
+  auto stats = thinks::ObjWriteStats{};
+  auto oss = std::ostringstream{};
+  const auto result =
+      thinks::WriteObj(oss, position_mapper, face_mapper, nullptr, nullptr,
+                       "\n", thinks::ObjWriteOptions{}, &stats);
+
+  REQUIRE(result.position_count == 3);
+  REQUIRE(result.face_count == 1);
+  REQUIRE(stats.bytes == oss.str().size());
+  REQUIRE(stats.mapper_ns >= 5000000);
+}
+
+}  // namespace
@@ -0,0 +1,177 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjTexCoordType = thinks::ObjTexCoord<float, 2>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+using ObjFaceType = thinks::ObjPolygonFace<ObjIndexGroupType>;
+
+// Flattened record of all callbacks, in call order.
+struct Record {
+  std::vector<float> values;
+  std::vector<std::uint32_t> indices;
+};
+
+auto MakeCallbacks(Record* const record) {
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [record](const auto& pos) {
+        record->values.insert(record->values.end(), pos.values.begin(),
+                              pos.values.end());
+      });
+  auto add_face =
+      thinks::MakeObjAddFunc<ObjFaceType>([record](const auto& face) {
+        record->indices.push_back(
+            static_cast<std::uint32_t>(face.values.size()));
+        for (const auto& index : face.values) {
+          record->indices.push_back(index.position_index.value);
+          record->indices.push_back(index.tex_coord_index.first.value);
+          record->indices.push_back(index.normal_index.first.value);
+        }
+      });
+  auto add_tex_coord = thinks::MakeObjAddFunc<ObjTexCoordType>(
+      [record](const auto& tex) {
+        record->values.insert(record->values.end(), tex.values.begin(),
+                              tex.values.end());
+      });
+  auto add_normal =
+      thinks::MakeObjAddFunc<ObjNormalType>([record](const auto& normal) {
+        record->values.insert(record->values.end(), normal.values.begin(),
+                              normal.values.end());
+      });
+  return std::make_tuple(add_position, add_face, add_tex_coord, add_normal);
+}
+
+const auto kInput = std::string(
+    "# Comment\n"
+    "v 0 0 0\n"
+    "v 1 0 0\r\n"
+    "v 1 1 0\n"
+    "\n"
+    "  v 0 1 0\n"
+    "vt 0 0\n"
+    "vt 1 1\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/2/1 3/1/1 4/2/1\n"
+    "f 1//1 3//1 4//1");  // No final newline.
+
+TEST_CASE("STREAM PARSER - matches ReadObj") {
+  auto expected = Record{};
+  auto expected_callbacks = MakeCallbacks(&expected);
+  auto iss = std::istringstream(kInput);
+  const auto expected_result = thinks::ReadObj(
+      iss, std::get<0>(expected_callbacks), std::get<1>(expected_callbacks),
+      std::get<2>(expected_callbacks), std::get<3>(expected_callbacks));
+
+  for (const auto chunk_size : {std::size_t{1}, std::size_t{3},
+                                std::size_t{8}, kInput.size()}) {
+    auto record = Record{};
+    auto callbacks = MakeCallbacks(&record);
+    auto parser = thinks::MakeObjStreamParser(
+        std::get<0>(callbacks), std::get<1>(callbacks),
+        std::get<2>(callbacks), std::get<3>(callbacks));
+    for (auto i = std::size_t{0}; i < kInput.size(); i += chunk_size) {
+      parser.Feed(kInput.data() + i,
+                  std::min(chunk_size, kInput.size() - i));
+      REQUIRE(parser.pending_size() < 32);
+    }
+    const auto result = parser.Finish();
+
+    REQUIRE(result.position_count == expected_result.position_count);
+    REQUIRE(result.face_count == expected_result.face_count);
+    REQUIRE(result.tex_coord_count == expected_result.tex_coord_count);
+    REQUIRE(result.normal_count == expected_result.normal_count);
+    REQUIRE(record.values == expected.values);
+    REQUIRE(record.indices == expected.indices);
+  }
+}
+
+TEST_CASE("STREAM PARSER - elements are delivered as lines complete") {
+  auto position_count = 0;
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&position_count](const auto&) { ++position_count; });
+  auto add_face = thinks::MakeObjAddFunc<
+      thinks::ObjTriangleFace<thinks::ObjIndex<std::uint32_t>>>(
+      [](const auto&) {});
+  auto parser = thinks::MakeObjStreamParser(add_position, add_face);
+
+  const auto chunk = std::string("v 1 2 3\nv 4 5");
+  parser.Feed(chunk.data(), chunk.size());
+  REQUIRE(position_count == 1);
+  REQUIRE(parser.pending_size() == 5);
+
+  const auto rest = std::string(" 6\n");
+  parser.Feed(rest.data(), rest.size());
+  REQUIRE(position_count == 2);
+  REQUIRE(parser.pending_size() == 0);
+
+  const auto result = parser.Finish();
+  REQUIRE(result.position_count == 2);
+}
+
+TEST_CASE("STREAM PARSER - options") {
+  // Options apply as for ReadObj, including work done in Finish.
+  auto record = Record{};
+  auto callbacks = MakeCallbacks(&record);
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+  auto parser = thinks::MakeObjStreamParser(
+      std::get<0>(callbacks), std::get<1>(callbacks), nullptr,
+      std::get<3>(callbacks), options);
+
+  const auto input = std::string("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  parser.Feed(input.data(), input.size());
+  REQUIRE(record.indices.empty());  // Faces are held back.
+  const auto result = parser.Finish();
+  REQUIRE(result.normal_count == 1);
+  REQUIRE(result.face_count == 1);
+  REQUIRE(record.indices ==
+          std::vector<std::uint32_t>{3, 0, 0, 0, 1, 0, 0, 2, 0, 0});
+}
+
+TEST_CASE("STREAM PARSER - errors") {
+  auto record = Record{};
+  auto callbacks = MakeCallbacks(&record);
+  auto parser =
+      thinks::MakeObjStreamParser(std::get<0>(callbacks),
+                                  std::get<1>(callbacks));
+
+  SECTION("parse error") {
+    const auto input = std::string("v 1 2 3\nv 1 x 3\nv 1");
+    REQUIRE_THROWS_MATCHES(parser.Feed(input.data(), input.size()),
+                           std::runtime_error,
+                           ExceptionContentMatcher{"failed parsing 'x'"});
+  }
+
+  SECTION("parse error in final line") {
+    const auto input = std::string("v 1 2");
+    parser.Feed(input.data(), input.size());
+    REQUIRE_THROWS_MATCHES(
+        parser.Finish(), std::runtime_error,
+        ExceptionContentMatcher{"positions must have 3 or 4 values (found 2)"});
+  }
+
+  SECTION("feed after finish") {
+    parser.Finish();
+    REQUIRE_THROWS_MATCHES(parser.Feed("v", 1), std::runtime_error,
+                           ExceptionContentMatcher{"stream parser is finished"});
+    REQUIRE_THROWS_MATCHES(parser.Finish(), std::runtime_error,
+                           ExceptionContentMatcher{"stream parser is finished"});
+  }
+}
+
+}  // namespace
@@ -0,0 +1,153 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// Built as a separate executable with THINKS_OBJ_IO_TRACE defined.
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjIndexType = thinks::ObjIndex<std::uint32_t>;
+using ObjFaceType = thinks::ObjTriangleFace<ObjIndexType>;
+
+const auto kEmptyTrace =
+    std::string("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\"}\n");
+
+std::string MakeInput() {
+  auto input = std::string{};
+  for (auto i = 0; i < 1000; ++i) {
+    input += "v 1 2 3\nf 1 1 1\n";
+  }
+  return input;
+}
+
+std::size_t CountOccurrences(const std::string& str, const std::string& sub) {
+  auto count = std::size_t{0};
+  for (auto pos = str.find(sub); pos != std::string::npos;
+       pos = str.find(sub, pos + sub.size())) {
+    ++count;
+  }
+  return count;
+}
+
+ObjFaceType MakeFace() {
+  return ObjFaceType(ObjIndexType(0), ObjIndexType(0), ObjIndexType(0));
+}
+
+TEST_CASE("TRACE - read writes trace at end of call") {
+  auto options = thinks::ObjReadOptions{};
+  auto trace = std::ostringstream{};
+  options.trace = &trace;
+  options.pipelined = true;
+  options.callback_thread = true;
+  options.callback_batch_size = 100;
+
+  auto iss = std::istringstream(MakeInput());
+  const auto result = thinks::ReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}), nullptr,
+      nullptr, options);
+  REQUIRE(result.face_count == 1000);
+
+  const auto json = trace.str();
+  REQUIRE(json.find("{\"traceEvents\":[") == 0);
+  REQUIRE(json.find("\"name\":\"read block\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"parse block\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"finish lines\"") != std::string::npos);
+  REQUIRE(CountOccurrences(json, "\"name\":\"deliver batch\"") == 20);
+  REQUIRE(json.find("\"args\":{\"elements\":100}") != std::string::npos);
+
+  // Events were written and dropped, and recording stopped.
+  auto after = std::ostringstream{};
+  thinks::WriteObjTrace(after);
+  REQUIRE(after.str() == kEmptyTrace);
+}
+
+TEST_CASE("TRACE - trace is written when the read fails") {
+  auto options = thinks::ObjReadOptions{};
+  auto trace = std::ostringstream{};
+  options.trace = &trace;
+
+  auto iss = std::istringstream("v 1 2 3\nv x\n");
+  REQUIRE_THROWS_MATCHES(
+      thinks::ReadObj(
+          iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+          thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}), nullptr,
+          nullptr, options),
+      std::runtime_error, ExceptionContentMatcher{"failed parsing 'x'"});
+  REQUIRE(trace.str().find("\"name\":\"parse block\"") != std::string::npos);
+}
+
+TEST_CASE("TRACE - write on demand") {
+  auto count = 0;
+  const auto position_mapper = [&count]() {
+    return count++ < 10 ? thinks::ObjMap(ObjPositionType(1.f, 2.f, 3.f))
+                        : thinks::ObjEnd<ObjPositionType>();
+  };
+  auto face_count = 0;
+  const auto face_mapper = [&face_count]() {
+    return face_count++ < 10 ? thinks::ObjMap(MakeFace())
+                             : thinks::ObjEnd<ObjFaceType>();
+  };
+
+  // Nothing is recorded unless enabled.
+  auto oss = std::ostringstream{};
+  thinks::WriteObj(oss, position_mapper, face_mapper);
+  auto trace = std::ostringstream{};
+  thinks::WriteObjTrace(trace);
+  REQUIRE(trace.str() == kEmptyTrace);
+
+  thinks::EnableObjTrace(true);
+  count = 0;
+  face_count = 0;
+  thinks::WriteObj(oss, position_mapper, face_mapper);
+  thinks::EnableObjTrace(false);
+
+  trace.str("");
+  thinks::WriteObjTrace(trace);
+  const auto json = trace.str();
+  REQUIRE(json.find("\"name\":\"write positions\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"write faces\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"write normals\"") == std::string::npos);
+
+  trace.str("");
+  thinks::WriteObjTrace(trace);
+  REQUIRE(trace.str() == kEmptyTrace);
+}
+
+TEST_CASE("TRACE - lazy faces") {
+  auto faces = thinks::ObjLazyFaces{};
+  auto input = std::string{"v 0 0 0\n"};
+  for (auto i = 0; i < 40000; ++i) {
+    input += "f 1 1 1\n";
+  }
+  auto iss = std::istringstream(input);
+  thinks::ReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjLazyFaceAddFunc(&faces));
+
+  auto options = thinks::ObjReadOptions{};
+  auto trace = std::ostringstream{};
+  options.trace = &trace;
+  options.thread_count = 2;
+  const auto count = thinks::DecodeObjFaces(
+      faces, 0, faces.size(),
+      thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {}), options);
+  REQUIRE(count == 40000);
+
+  const auto json = trace.str();
+  REQUIRE(CountOccurrences(json, "\"name\":\"decode faces\"") == 4);
+  REQUIRE(CountOccurrences(json, "\"name\":\"deliver faces\"") == 4);
+}
+
+}  // namespace
@@ -0,0 +1,200 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjNormalType = thinks::ObjNormal<float>;
+using ObjIndexType = thinks::ObjIndex<std::uint32_t>;
+using ObjIndexGroupType = thinks::ObjIndexGroup<std::uint32_t>;
+using ObjTriangleType = thinks::ObjTriangleFace<ObjIndexType>;
+using ObjGroupTriangleType = thinks::ObjTriangleFace<ObjIndexGroupType>;
+
+thinks::ObjTryReadResult TryRead(
+    const std::string& input,
+    const thinks::ObjReadOptions& options = thinks::ObjReadOptions{}) {
+  auto iss = std::istringstream(input);
+  return thinks::TryReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjAddFunc<ObjGroupTriangleType>([](const auto&) {}),
+      nullptr, thinks::MakeObjAddFunc<ObjNormalType>([](const auto&) {}),
+      options);
+}
+
+// Returns the message thrown by ReadObj for the same input.
+std::string ReadMessage(
+    const std::string& input,
+    const thinks::ObjReadOptions& options = thinks::ObjReadOptions{}) {
+  auto iss = std::istringstream(input);
+  try {
+    thinks::ReadObj(
+        iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+        thinks::MakeObjAddFunc<ObjGroupTriangleType>([](const auto&) {}),
+        nullptr, thinks::MakeObjAddFunc<ObjNormalType>([](const auto&) {}),
+        options);
+  } catch (const std::runtime_error& ex) {
+    return ex.what();
+  }
+  return std::string{};
+}
+
+void RequireError(const std::string& input,
+                  const thinks::ObjReadErrorKind kind,
+                  const std::uint64_t line, const std::uint64_t byte_offset,
+                  const std::string& excerpt, const std::string& message) {
+  const auto outcome = TryRead(input);
+  REQUIRE(!outcome.ok());
+  REQUIRE(outcome.error.kind == kind);
+  REQUIRE(outcome.error.line == line);
+  REQUIRE(outcome.error.byte_offset == byte_offset);
+  REQUIRE(outcome.error.excerpt == excerpt);
+  REQUIRE(outcome.error.message == message);
+  REQUIRE(ReadMessage(input) == message);
+}
+
+TEST_CASE("TRY READ - no error") {
+  const auto outcome = TryRead("v 0 0 0\nvn 0 0 1\nf 1//1 1//1 1//1\n");
+  REQUIRE(outcome.ok());
+  REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kNone);
+  REQUIRE(outcome.error.line == 0);
+  REQUIRE(outcome.error.byte_offset == 0);
+  REQUIRE(outcome.result.position_count == 1);
+  REQUIRE(outcome.result.face_count == 1);
+}
+
+TEST_CASE("TRY READ - invalid value") {
+  RequireError("v 1 2 3\nv 1 abc 3\n",
+               thinks::ObjReadErrorKind::kInvalidValue, 2, 12, "abc",
+               "failed parsing 'abc'");
+}
+
+TEST_CASE("TRY READ - value count") {
+  RequireError("v 1 2 3\r\nv 1 2\r\n", thinks::ObjReadErrorKind::kValueCount,
+               2, 9, "v 1 2",
+               "positions must have 3 or 4 values (found 2)");
+  RequireError("v 1 2 3 4\n", thinks::ObjReadErrorKind::kValueCount, 1, 8,
+               "4", "expected to parse at most 3 values");
+}
+
+TEST_CASE("TRY READ - index range") {
+  RequireError("v 0 0 0\nf 1/1/1 0/1/1 1/1/1\n",
+               thinks::ObjReadErrorKind::kIndexRange, 2, 16, "0/1/1",
+               "parsed index must be greater than zero");
+}
+
+TEST_CASE("TRY READ - index group") {
+  RequireError("\n\nf 1/2/3/4 1 1\n", thinks::ObjReadErrorKind::kIndexGroup,
+               3, 4, "1/2/3/4",
+               "index group can have at most 3 tokens ('1/2/3/4')");
+}
+
+TEST_CASE("TRY READ - unrecognized prefix") {
+  RequireError("v 0 0 0\n  xyz 1 2\n",
+               thinks::ObjReadErrorKind::kUnrecognizedPrefix, 2, 10, "xyz",
+               "unrecognized line prefix 'xyz'");
+}
+
+TEST_CASE("TRY READ - long lines are excerpted") {
+  const auto long_value = std::string(100, 'x');
+  const auto outcome = TryRead("v 1 " + long_value + " 3\n");
+  REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kInvalidValue);
+  REQUIRE(outcome.error.byte_offset == 4);
+  REQUIRE(outcome.error.excerpt == std::string(32, 'x'));
+  REQUIRE(outcome.error.message == "failed parsing '" + long_value + "'");
+}
+
+TEST_CASE("TRY READ - error in final line without newline") {
+  RequireError("v 0 0 0\nv 1 2 3\n\nf 1",
+               thinks::ObjReadErrorKind::kValueCount, 4, 17, "f 1",
+               "expected 3 face indices (found 1)");
+}
+
+TEST_CASE("TRY READ - error in later block") {
+  auto input = std::string{};
+  auto offset = std::uint64_t{0};
+  for (auto i = 0; i < 200000; ++i) {
+    input += "v 1 2 3\n";
+    offset += 8;
+  }
+  input += "f 1 2\n";
+
+  auto options = thinks::ObjReadOptions{};
+  SECTION("direct") {}
+  SECTION("pipelined") { options.pipelined = true; }
+  SECTION("callback thread") { options.callback_thread = true; }
+
+  auto position_count = std::uint32_t{0};
+  auto iss = std::istringstream(input);
+  const auto outcome = thinks::TryReadObj(
+      iss,
+      thinks::MakeObjAddFunc<ObjPositionType>(
+          [&position_count](const auto&) { ++position_count; }),
+      thinks::MakeObjAddFunc<ObjTriangleType>([](const auto&) {}), nullptr,
+      nullptr, options);
+  REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kValueCount);
+  REQUIRE(outcome.error.line == 200001);
+  REQUIRE(outcome.error.byte_offset == offset);
+  REQUIRE(outcome.result.position_count == 200000);
+  REQUIRE(position_count == 200000);
+}
+
+TEST_CASE("TRY READ - invalid options") {
+  auto options = thinks::ObjReadOptions{};
+  options.generate_normals = thinks::ObjNormalGeneration::kAreaWeighted;
+
+  auto iss = std::istringstream("v 0 0 0\n");
+  const auto outcome = thinks::TryReadObj(
+      iss, thinks::MakeObjAddFunc<ObjPositionType>([](const auto&) {}),
+      thinks::MakeObjAddFunc<ObjTriangleType>([](const auto&) {}), nullptr,
+      nullptr, options);
+  REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kInvalidOptions);
+  REQUIRE(outcome.error.line == 0);
+  REQUIRE(outcome.error.message ==
+          "normal generation requires index group faces");
+  REQUIRE(outcome.result.position_count == 0);
+}
+
+TEST_CASE("TRY READ - callback exception") {
+  const auto input = std::string("v 0 0 0\nv 1 1 1\nv 2 2 2\n");
+  const auto add_position = [](const auto& position) {
+    if (position.values[0] > 0.5f) {
+      throw std::runtime_error("callback failed");
+    }
+  };
+
+  SECTION("direct") {
+    auto iss = std::istringstream(input);
+    const auto outcome = thinks::TryReadObj(
+        iss, thinks::MakeObjAddFunc<ObjPositionType>(add_position),
+        thinks::MakeObjAddFunc<ObjTriangleType>([](const auto&) {}));
+    REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kException);
+    REQUIRE(outcome.error.line == 2);
+    REQUIRE(outcome.error.byte_offset == 8);
+    REQUIRE(outcome.error.excerpt.empty());
+    REQUIRE(outcome.error.message == "callback failed");
+  }
+
+  SECTION("callback thread") {
+    auto options = thinks::ObjReadOptions{};
+    options.callback_thread = true;
+    auto iss = std::istringstream(input);
+    const auto outcome = thinks::TryReadObj(
+        iss, thinks::MakeObjAddFunc<ObjPositionType>(add_position),
+        thinks::MakeObjAddFunc<ObjTriangleType>([](const auto&) {}), nullptr,
+        nullptr, options);
+    REQUIRE(outcome.error.kind == thinks::ObjReadErrorKind::kException);
+    REQUIRE(outcome.error.line == 0);
+    REQUIRE(outcome.error.message == "callback failed");
+  }
+}
+
+}  // namespace
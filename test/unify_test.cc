@@ -0,0 +1,124 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using IndexType = std::uint32_t;
+using IndexGroupType = thinks::ObjIndexGroup<IndexType>;
+
+bool Equals(const IndexGroupType& lhs, const IndexGroupType& rhs) {
+  return lhs.position_index.value == rhs.position_index.value &&
+         lhs.tex_coord_index.second == rhs.tex_coord_index.second &&
+         (!lhs.tex_coord_index.second ||
+          lhs.tex_coord_index.first.value == rhs.tex_coord_index.first.value) &&
+         lhs.normal_index.second == rhs.normal_index.second &&
+         (!lhs.normal_index.second ||
+          lhs.normal_index.first.value == rhs.normal_index.first.value);
+}
+
+TEST_CASE("UNIFY - read") {
+  const auto input = std::string(
+      "v 0 0 0\n"
+      "v 1 0 0\n"
+      "v 1 1 0\n"
+      "v 0 1 0\n"
+      "vt 0 0\n"
+      "vt 1 0\n"
+      "vt 1 1\n"
+      "vt 0 1\n"
+      "vt 0.5 0.5\n"
+      "vn 0 0 1\n"
+      "f 1/1/1 2/2/1 3/3/1\n"
+      "f 1/1/1 3/3/1 4/4/1\n"
+      "f 1/5/1 3/3/1 4/4/1\n");
+
+  using ObjFaceType = thinks::ObjTriangleFace<IndexGroupType>;
+  auto unifier = thinks::ObjIndexGroupUnifier<IndexType>{};
+  auto add_position = thinks::MakeObjAddFunc<thinks::ObjPosition<float, 3>>(
+      [](const auto&) {});
+  auto add_face = thinks::MakeObjUnifyingAddFunc<ObjFaceType>(&unifier);
+
+  auto iss = std::istringstream(input);
+  const auto result = thinks::ReadObj(iss, add_position, add_face);
+  REQUIRE(result.face_count == 3);
+
+  const auto unified = unifier.Release();
+  REQUIRE(unified.index_groups.size() == 5);
+  REQUIRE(Equals(unified.index_groups[0], IndexGroupType(0, 0, 0)));
+  REQUIRE(Equals(unified.index_groups[1], IndexGroupType(1, 1, 0)));
+  REQUIRE(Equals(unified.index_groups[2], IndexGroupType(2, 2, 0)));
+  REQUIRE(Equals(unified.index_groups[3], IndexGroupType(3, 3, 0)));
+  REQUIRE(Equals(unified.index_groups[4], IndexGroupType(0, 4, 0)));
+  REQUIRE(unified.indices == std::vector<IndexType>{0, 1, 2,
+                                                    0, 2, 3,
+                                                    4, 2, 3});
+  REQUIRE(unifier.index_groups().empty());
+  REQUIRE(unifier.indices().empty());
+}
+
+TEST_CASE("UNIFY - missing attributes are distinct") {
+  auto unifier = thinks::ObjIndexGroupUnifier<IndexType>{};
+  const auto a = unifier.Add(IndexGroupType(0));
+  const auto b = unifier.Add(IndexGroupType(0, std::make_pair(0u, true),
+                                            std::make_pair(0u, false)));
+  const auto c = unifier.Add(IndexGroupType(0, std::make_pair(0u, false),
+                                            std::make_pair(0u, true)));
+  const auto d = unifier.Add(IndexGroupType(0));
+
+  REQUIRE(a == 0);
+  REQUIRE(b == 1);
+  REQUIRE(c == 2);
+  REQUIRE(d == 0);
+}
+
+TEST_CASE("UNIFY - parallel matches sequential") {
+  // Synthetic grid-like corner stream with plenty of repetition, large
+  // enough to be split into several chunks.
+  auto corners = std::vector<IndexGroupType>{};
+  auto state = std::uint32_t{12345};
+  for (auto i = std::uint32_t{0}; i < 600000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    const auto pos = (i / 6 + (state >> 28)) % 50000;
+    corners.push_back(IndexGroupType(pos, pos % 7, (state >> 30) % 3));
+  }
+
+  auto unifier = thinks::ObjIndexGroupUnifier<IndexType>{};
+  for (const auto& corner : corners) {
+    unifier.Add(corner);
+  }
+  const auto expected = unifier.Release();
+
+  for (const auto thread_count : {1u, 2u, 3u, 8u}) {
+    const auto unified = thinks::UnifyObjIndexGroups(corners, thread_count);
+    REQUIRE(unified.indices == expected.indices);
+    REQUIRE(unified.index_groups.size() == expected.index_groups.size());
+    for (std::size_t i = 0; i < unified.index_groups.size(); ++i) {
+      REQUIRE(Equals(unified.index_groups[i], expected.index_groups[i]));
+    }
+  }
+}
+
+TEST_CASE("UNIFY - index type overflow") {
+  using SmallIndexGroupType = thinks::ObjIndexGroup<std::uint8_t>;
+
+  auto unifier = thinks::ObjIndexGroupUnifier<std::uint8_t>{};
+  for (auto i = 0; i < 255; ++i) {
+    unifier.Add(SmallIndexGroupType(static_cast<std::uint8_t>(i)));
+  }
+
+  REQUIRE_THROWS_AS(
+      unifier.Add(SmallIndexGroupType(0, std::make_pair(std::uint8_t{1}, true),
+                                      std::make_pair(std::uint8_t{0}, false))),
+      std::runtime_error);
+}
+
+}  // namespace
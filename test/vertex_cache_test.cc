@@ -0,0 +1,93 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using IndexType = std::uint32_t;
+
+// Triangulated regular grid with (n + 1) x (n + 1) vertices.
+std::vector<IndexType> GridIndices(const IndexType n) {
+  auto indices = std::vector<IndexType>{};
+  for (IndexType j = 0; j < n; ++j) {
+    for (IndexType i = 0; i < n; ++i) {
+      const auto v0 = j * (n + 1) + i;
+      const auto v1 = v0 + 1;
+      const auto v2 = v0 + (n + 1);
+      const auto v3 = v2 + 1;
+      indices.insert(indices.end(), {v0, v1, v3, v0, v3, v2});
+    }
+  }
+  return indices;
+}
+
+std::vector<std::array<IndexType, 3>> SortedTriangles(
+    const std::vector<IndexType>& indices) {
+  auto triangles = std::vector<std::array<IndexType, 3>>{};
+  for (std::size_t t = 0; t < indices.size() / 3; ++t) {
+    triangles.push_back(
+        {{indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2]}});
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+TEST_CASE("VERTEX_CACHE - acmr") {
+  // Three disjoint triangles: every vertex is a miss.
+  const auto disjoint = std::vector<IndexType>{0, 1, 2, 3, 4, 5, 6, 7, 8};
+  REQUIRE(thinks::ObjAcmr(disjoint, 9) == Approx(3.0));
+
+  // Same triangle repeated: only the first three accesses miss.
+  const auto repeated = std::vector<IndexType>{0, 1, 2, 0, 1, 2, 0, 1, 2};
+  REQUIRE(thinks::ObjAcmr(repeated, 3) == Approx(1.0));
+
+  // FIFO eviction with a cache of three vertices.
+  const auto fifo = std::vector<IndexType>{0, 1, 2, 3, 1, 2, 0, 1, 2};
+  REQUIRE(thinks::ObjAcmr(fifo, 4, 3) == Approx(7.0 / 3.0));
+}
+
+TEST_CASE("VERTEX_CACHE - optimize") {
+  constexpr auto kGridSize = IndexType{64};
+  constexpr auto kVertexCount = (kGridSize + 1) * (kGridSize + 1);
+  auto indices = GridIndices(kGridSize);
+
+  // Shuffle triangle order deterministically.
+  const auto triangle_count = indices.size() / 3;
+  auto state = std::uint32_t{1};
+  for (auto t = triangle_count - 1; t > 0; --t) {
+    state = state * 1664525u + 1013904223u;
+    const auto u = state % (t + 1);
+    for (std::size_t k = 0; k < 3; ++k) {
+      std::swap(indices[3 * t + k], indices[3 * u + k]);
+    }
+  }
+  const auto shuffled = indices;
+
+  const auto result = thinks::OptimizeObjVertexCache(&indices, kVertexCount);
+
+  REQUIRE(result.acmr_before == Approx(thinks::ObjAcmr(shuffled, kVertexCount)));
+  REQUIRE(result.acmr_after == Approx(thinks::ObjAcmr(indices, kVertexCount)));
+  REQUIRE(result.acmr_before > 2.0);
+  REQUIRE(result.acmr_after < 0.8);
+  REQUIRE(SortedTriangles(indices) == SortedTriangles(shuffled));
+}
+
+TEST_CASE("VERTEX_CACHE - errors") {
+  auto indices = std::vector<IndexType>{0, 1};
+  REQUIRE_THROWS_AS(thinks::OptimizeObjVertexCache(&indices, 2),
+                    std::runtime_error);
+
+  indices = std::vector<IndexType>{0, 1, 2};
+  REQUIRE_THROWS_AS(thinks::OptimizeObjVertexCache(&indices, 2),
+                    std::runtime_error);
+}
+
+}  // namespace
@@ -0,0 +1,163 @@
+// Copyright(C) 2018 Tommy Hinks <tommy.hinks@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "catch_mesh_matcher.h"
+#include "thinks/obj_io/obj_io.h"
+
+namespace {
+
+using ObjPositionType = thinks::ObjPosition<float, 3>;
+using ObjFaceType = thinks::ObjTriangleFace<thinks::ObjIndexGroup<std::uint32_t>>;
+
+TEST_CASE("WELD - read") {
+  // Two triangles sharing an edge, where every face has its own copy of
+  // its corners. The copies of the shared corners differ slightly.
+  const auto input = std::string(
+      "v 0 0 0\n"
+      "v 1 0 0\n"
+      "v 0 1 0\n"
+      "v 1.0001 0 0\n"
+      "v 1 1 0\n"
+      "v 0 0.9999 0\n"
+      "vt 0 0\n"
+      "f 1/1 2/1 3/1\n"
+      "f 4/1 5/1 6/1\n");
+
+  auto positions = std::vector<ObjPositionType>{};
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&positions](const auto& pos) { positions.push_back(pos); });
+  auto indices = std::vector<std::uint32_t>{};
+  auto add_face =
+      thinks::MakeObjAddFunc<ObjFaceType>([&indices](const auto& face) {
+        for (const auto& idx : face.values) {
+          REQUIRE(idx.tex_coord_index.second);
+          indices.push_back(idx.position_index.value);
+        }
+      });
+  auto add_tex_coord = thinks::MakeObjAddFunc<thinks::ObjTexCoord<float, 2>>(
+      [](const auto&) {});
+
+  auto weld_map = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.weld_positions = true;
+  options.weld_map = &weld_map;
+
+  SECTION("within epsilon") {
+    options.weld_epsilon = 0.001;
+    auto iss = std::istringstream(input);
+    const auto result = thinks::ReadObj(iss, add_position, add_face,
+                                        add_tex_coord, nullptr, options);
+
+    REQUIRE(result.position_count == 4);
+    REQUIRE(positions.size() == 4);
+    REQUIRE(positions[3].values[0] == 1.f);
+    REQUIRE(positions[3].values[1] == 1.f);
+    REQUIRE(weld_map == std::vector<std::uint32_t>{0, 1, 2, 1, 3, 2});
+    REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2, 1, 3, 2});
+  }
+
+  SECTION("exact") {
+    options.weld_epsilon = 0.0;
+    auto iss = std::istringstream(input);
+    const auto result = thinks::ReadObj(iss, add_position, add_face,
+                                        add_tex_coord, nullptr, options);
+
+    REQUIRE(result.position_count == 6);
+    REQUIRE(weld_map == std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5});
+    REQUIRE(indices == std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5});
+  }
+
+  SECTION("faces before positions") {
+    auto iss = std::istringstream("f 1 2 3\n");
+    REQUIRE_THROWS_MATCHES(
+        thinks::ReadObj(iss, add_position, add_face, nullptr, nullptr,
+                        options),
+        std::runtime_error,
+        ExceptionContentMatcher{"welding requires positions before faces "
+                                "(position index 1 not yet read)"});
+  }
+}
+
+TEST_CASE("WELD - positions") {
+  // Jittered copies of points on a coarse lattice, so that copies of the
+  // same point are within epsilon, while distinct points are not.
+  auto positions = std::vector<ObjPositionType>{};
+  auto state = std::uint32_t{7};
+  const auto jitter = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) / float{1 << 24} * 0.01f - 0.005f;
+  };
+  for (auto i = 0; i < 100000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    const auto p = static_cast<float>((state >> 16) % 4000);
+    positions.push_back(ObjPositionType(p + jitter(), p * 0.5f + jitter(),
+                                        -p + jitter()));
+  }
+  constexpr auto kEpsilon = 0.05;
+
+  // Reference: streaming welding while reading.
+  auto oss = std::ostringstream{};
+  for (const auto& p : positions) {
+    oss << "v " << p.values[0] << " " << p.values[1] << " " << p.values[2]
+        << "\n";
+  }
+  auto expected_weld_map = std::vector<std::uint32_t>{};
+  auto options = thinks::ObjReadOptions{};
+  options.weld_positions = true;
+  options.weld_epsilon = kEpsilon;
+  options.weld_map = &expected_weld_map;
+  auto read_positions = std::vector<ObjPositionType>{};
+  auto add_position = thinks::MakeObjAddFunc<ObjPositionType>(
+      [&read_positions](const auto& pos) { read_positions.push_back(pos); });
+  auto add_face = thinks::MakeObjAddFunc<ObjFaceType>([](const auto&) {});
+  auto iss = std::istringstream(oss.str());
+  const auto read_result = thinks::ReadObj(iss, add_position, add_face,
+                                           nullptr, nullptr, options);
+  REQUIRE(read_result.position_count <= 4000);
+
+  // Values may be rounded when written as text, so weld the positions that
+  // were read rather than the originals.
+  auto parsed = std::vector<ObjPositionType>{};
+  {
+    auto iss2 = std::istringstream(oss.str());
+    auto add_parsed = thinks::MakeObjAddFunc<ObjPositionType>(
+        [&parsed](const auto& pos) { parsed.push_back(pos); });
+    thinks::ReadObj(iss2, add_parsed, add_face);
+  }
+
+  for (const auto thread_count : {1u, 2u, 5u}) {
+    const auto result =
+        thinks::WeldObjPositions(parsed, kEpsilon, thread_count);
+    REQUIRE(result.weld_map == expected_weld_map);
+    REQUIRE(result.kept_indices.size() == read_result.position_count);
+    for (std::size_t i = 0; i < result.kept_indices.size(); ++i) {
+      REQUIRE(result.weld_map[result.kept_indices[i]] == i);
+    }
+  }
+}
+
+TEST_CASE("WELD - coincident positions") {
+  // Every position is within epsilon of all earlier positions.
+  auto positions =
+      std::vector<ObjPositionType>(100000, ObjPositionType(1.f, 2.f, 3.f));
+  positions.push_back(ObjPositionType(5.f, 2.f, 3.f));
+  positions.push_back(ObjPositionType(1.f, 2.f, 3.01f));
+
+  for (const auto thread_count : {1u, 4u}) {
+    const auto result = thinks::WeldObjPositions(positions, 0.1, thread_count);
+    auto expected_weld_map = std::vector<std::uint32_t>(100000, 0);
+    expected_weld_map.push_back(1);
+    expected_weld_map.push_back(0);
+    REQUIRE(result.weld_map == expected_weld_map);
+    REQUIRE(result.kept_indices == std::vector<std::uint32_t>{0, 100000});
+  }
+}
+
+}  // namespace